@@ -21,6 +21,11 @@
 
 #include "BC.h"
 
+#ifdef _XM_SSE_INTRINSICS_
+#include <intrin.h>
+#include <smmintrin.h>
+#endif
+
 using namespace DirectX::PackedVector;
 
 namespace DirectX
@@ -367,6 +372,147 @@ inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColo
 }
 
 
+//-------------------------------------------------------------------------------------
+// 8-bit decoding: palettes in integer math, texels selected with byte shuffles
+//-------------------------------------------------------------------------------------
+
+// round( 255 * n / d ). Only the 3-color midpoint (d even) can land on a half, which goes to even
+// as in XMStoreUByteN4
+inline static uint32_t ScaleToByte( _In_ uint32_t n, _In_ uint32_t d )
+{
+    uint32_t t = 510 * n + d;
+    uint32_t q = t / ( 2 * d );
+    if ( !( d & 1 ) && ( q & 1 ) && ( t % ( 2 * d ) ) == 0 )
+        --q;
+    return q;
+}
+
+inline static uint32_t PackRGBA8( _In_ uint32_t r, _In_ uint32_t g, _In_ uint32_t b, _In_ uint32_t a )
+{
+    return r | ( g << 8 ) | ( b << 16 ) | ( a << 24 );
+}
+
+// The four colors of a BC1 block as R8G8B8A8, with the alpha of opaque entries in 'alpha'
+static void BC1Palette8(_Out_writes_(4) uint32_t *pPalette, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1, _In_ uint32_t alpha)
+{
+    const uint32_t r0 = ( pBC->rgb[0] >> 11 ) & 31, g0 = ( pBC->rgb[0] >> 5 ) & 63, b0 = pBC->rgb[0] & 31;
+    const uint32_t r1 = ( pBC->rgb[1] >> 11 ) & 31, g1 = ( pBC->rgb[1] >> 5 ) & 63, b1 = pBC->rgb[1] & 31;
+
+    pPalette[0] = PackRGBA8( ScaleToByte( r0, 31 ), ScaleToByte( g0, 63 ), ScaleToByte( b0, 31 ), alpha );
+    pPalette[1] = PackRGBA8( ScaleToByte( r1, 31 ), ScaleToByte( g1, 63 ), ScaleToByte( b1, 31 ), alpha );
+
+    if ( isbc1 && (pBC->rgb[0] <= pBC->rgb[1]) )
+    {
+        pPalette[2] = PackRGBA8( ScaleToByte( r0 + r1, 62 ), ScaleToByte( g0 + g1, 126 ), ScaleToByte( b0 + b1, 62 ), alpha );
+        pPalette[3] = 0;    // Alpha of 0
+    }
+    else
+    {
+        pPalette[2] = PackRGBA8( ScaleToByte( 2 * r0 + r1, 93 ), ScaleToByte( 2 * g0 + g1, 189 ), ScaleToByte( 2 * b0 + b1, 93 ), alpha );
+        pPalette[3] = PackRGBA8( ScaleToByte( r0 + 2 * r1, 93 ), ScaleToByte( g0 + 2 * g1, 189 ), ScaleToByte( b0 + 2 * b1, 93 ), alpha );
+    }
+}
+
+#ifdef _XM_SSE_INTRINSICS_
+
+static const XMVECTORU32 g_SpreadTexels = { 0x00000000, 0x01010101, 0x02020202, 0x03030303 };
+static const XMVECTORU32 g_TexelBytes = { 0x03020100, 0x03020100, 0x03020100, 0x03020100 };
+static const XMVECTORU32 g_AlphaBytes[4] =
+{
+    { 0x00808080, 0x01808080, 0x02808080, 0x03808080 },
+    { 0x04808080, 0x05808080, 0x06808080, 0x07808080 },
+    { 0x08808080, 0x09808080, 0x0A808080, 0x0B808080 },
+    { 0x0C808080, 0x0D808080, 0x0E808080, 0x0F808080 },
+};
+
+static const XMVECTORF32 g_Divide565 = { 31.f, 63.f, 31.f, 1.f };
+static const XMVECTORF32 g_Divide565Third = { 93.f, 189.f, 93.f, 1.f };
+static const XMVECTORF32 g_Divide565Half = { 62.f, 126.f, 62.f, 1.f };
+
+// BC1Palette8 in float lanes. 255 * n is exact and the division is correctly rounded, so only a
+// true half (the 3-color midpoint) reaches the conversion as one, and goes to even like ScaleToByte
+inline static __m128i BC1PaletteSSE( _In_ const D3DX_BC1 *pBC, _In_ bool isbc1, _In_ uint32_t alpha )
+{
+    const uint32_t c0 = pBC->rgb[0], c1 = pBC->rgb[1];
+    __m128 e0 = _mm_cvtepi32_ps( _mm_setr_epi32( ( c0 >> 11 ) & 31, ( c0 >> 5 ) & 63, c0 & 31, 0 ) );
+    __m128 e1 = _mm_cvtepi32_ps( _mm_setr_epi32( ( c1 >> 11 ) & 31, ( c1 >> 5 ) & 63, c1 & 31, 0 ) );
+    e0 = _mm_mul_ps( e0, _mm_set1_ps( 255.f ) );
+    e1 = _mm_mul_ps( e1, _mm_set1_ps( 255.f ) );
+
+    __m128i p0 = _mm_cvtps_epi32( _mm_div_ps( e0, g_Divide565 ) );
+    __m128i p1 = _mm_cvtps_epi32( _mm_div_ps( e1, g_Divide565 ) );
+    __m128i p2, p3;
+    __m128i a = _mm_set1_epi32( static_cast<int>( alpha << 24 ) );
+    if ( isbc1 && (c0 <= c1) )
+    {
+        p2 = _mm_cvtps_epi32( _mm_div_ps( _mm_add_ps( e0, e1 ), g_Divide565Half ) );
+        p3 = _mm_setzero_si128();   // Alpha of 0
+        a = _mm_srli_si128( _mm_slli_si128( a, 4 ), 4 );
+    }
+    else
+    {
+        __m128 e2 = _mm_add_ps( e0, e1 );
+        p2 = _mm_cvtps_epi32( _mm_div_ps( _mm_add_ps( e2, e0 ), g_Divide565Third ) );
+        p3 = _mm_cvtps_epi32( _mm_div_ps( _mm_add_ps( e2, e1 ), g_Divide565Third ) );
+    }
+
+    __m128i v = _mm_packus_epi16( _mm_packs_epi32( p0, p1 ), _mm_packs_epi32( p2, p3 ) );
+    return _mm_or_si128( v, a );
+}
+
+// One row of a BC1 bitmap (four 2-bit indices) looked up in a 4 x R8G8B8A8 palette
+inline static __m128i SelectRow( _In_ __m128i palette, _In_ uint32_t row )
+{
+    uint32_t t = ( row & 0x3 ) | ( ( row & 0xC ) << 6 ) | ( ( row & 0x30 ) << 12 ) | ( ( row & 0xC0 ) << 18 );
+    __m128i mask = _mm_shuffle_epi8( _mm_cvtsi32_si128( static_cast<int>( t << 2 ) ), _mm_castps_si128( g_SpreadTexels ) );
+    mask = _mm_add_epi8( mask, _mm_castps_si128( g_TexelBytes ) );
+    return _mm_shuffle_epi8( palette, mask );
+}
+
+// Moves alpha bytes 4 * row .. 4 * row + 3 of a block into the alpha channel of four texels
+inline static __m128i AlphaRow( _In_ __m128i alpha, _In_ size_t row )
+{
+    return _mm_shuffle_epi8( alpha, _mm_castps_si128( g_AlphaBytes[ row ] ) );
+}
+
+#endif // _XM_SSE_INTRINSICS_
+
+// Writes a BC1-3 block as R8G8B8A8 rows 'pitch' bytes apart. pAlpha holds the 16 alpha values of BC2/3, or is null.
+static void DecodeBC1ToRGBA8( _Out_writes_bytes_(pitch * 3 + 16) uint8_t *pDest, _In_ size_t pitch, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1,
+                              _In_reads_opt_(NUM_PIXELS_PER_BLOCK) const uint8_t *pAlpha )
+{
+#ifdef _XM_SSE_INTRINSICS_
+    if ( HasSSE41() )
+    {
+        __m128i vPalette = BC1PaletteSSE( pBC, isbc1, pAlpha ? 0 : 255 );
+        __m128i vAlpha = ( pAlpha ) ? _mm_loadu_si128( reinterpret_cast<const __m128i*>( pAlpha ) ) : _mm_setzero_si128();
+
+        uint32_t dw = pBC->bitmap;
+        for( size_t row = 0; row < 4; ++row, dw >>= 8 )
+        {
+            __m128i v = SelectRow( vPalette, dw & 0xFF );
+            if ( pAlpha )
+                v = _mm_or_si128( v, AlphaRow( vAlpha, row ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + row * pitch ), v );
+        }
+        return;
+    }
+#endif
+
+    uint32_t palette[4];
+    BC1Palette8( palette, pBC, isbc1, pAlpha ? 0 : 255 );
+
+    uint32_t dw = pBC->bitmap;
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2 )
+    {
+        uint32_t c = palette[ dw & 3 ];
+        if ( pAlpha )
+            c |= uint32_t( pAlpha[i] ) << 24;
+        memcpy( pDest + ( i >> 2 ) * pitch + ( i & 3 ) * 4, &c, sizeof(c) );
+    }
+}
+
+
 //-------------------------------------------------------------------------------------
 
 static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
@@ -711,147 +857,461 @@ static void EncodeSolidBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK)
 #endif // COLOR_WEIGHTS
 
 
-//=====================================================================================
-// Entry points
-//=====================================================================================
-
 //-------------------------------------------------------------------------------------
-// BC1 Compression
+// SIMD color encoder: one block per 32-bit lane, BC_COLOR_BLOCKS blocks per call.
+// Fits endpoints on 8-bit texels and picks indices in integer math against the 565
+// endpoints as the decoder expands them, always in 4-color mode (rgb[0] > rgb[1]).
 //-------------------------------------------------------------------------------------
-_Use_decl_annotations_
-void D3DXDecodeBC1(XMVECTOR *pColor, const uint8_t *pBC)
+#ifdef _XM_SSE_INTRINSICS_
+
+static_assert( BC_COLOR_BLOCKS == 4, "SSE4.1 color encoder uses 4 lanes" );
+
+// Channel weights of the index search (squared, x1024) and of the principal axis, as g_Luminance.
+static const int32_t g_ColorWeights2[2][3] = { { 90, 1024, 10 }, { 1024, 1024, 1024 } };
+static const float g_ColorWeights[2][3] = { { 0.2125f / 0.7154f, 1.0f, 0.0721f / 0.7154f }, { 1.0f, 1.0f, 1.0f } };
+
+bool HasSSE41()
 {
-    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
-    DecodeBC1( pColor, pBC1, true );
+    static int s_sse41 = -1;
+    if ( s_sse41 < 0 )
+    {
+        int info[4];
+        __cpuid( info, 1 );
+        s_sse41 = ( info[2] & (1 << 19) ) ? 1 : 0;
+    }
+    return s_sse41 != 0;
 }
 
-_Use_decl_annotations_
-void D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float alphaRef, DWORD flags)
+// round( x * max / 255 ) for 0-255 lanes
+inline static __m128i QuantizeColor( _In_ __m128i x, _In_ int max )
 {
-    assert( pBC && pColor );
+    __m128i t = _mm_add_epi32( _mm_mullo_epi32( x, _mm_set1_epi32( max ) ), _mm_set1_epi32( 128 ) );
+    return _mm_srli_epi32( _mm_add_epi32( t, _mm_srli_epi32( t, 8 ) ), 8 );
+}
 
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+// Quantizes endpoints e0/e1 to 565, orders them for 4-color mode and picks the index of every
+// texel. Returns rgb[0] | rgb[1] << 16 per lane, the bitmap, and optionally the 0-3 step of each
+// texel from rgb[0] and the weighted squared error of the block.
+static __m128i FitColorsSSE41( _In_reads_(NUM_PIXELS_PER_BLOCK * 3) const __m128i *pTexels, _In_reads_(3) const __m128i *e0, _In_reads_(3) const __m128i *e1,
+                               _In_reads_(3) const int32_t *pWeights2, _Out_ __m128i& bitmap,
+                               _Out_writes_opt_(NUM_PIXELS_PER_BLOCK) __m128i *pSteps, _Out_opt_ __m128 *pError )
+{
+    static const int s_Max[3] = { 31, 63, 31 };
+    static const int s_Shift[3] = { 11, 5, 0 };
 
-    if (flags & BC_FLAGS_DITHER_A)
+    __m128i q0[3], q1[3];
+    __m128i w0 = _mm_setzero_si128();
+    __m128i w1 = _mm_setzero_si128();
+    for( size_t c = 0; c < 3; ++c )
     {
-        float fError[NUM_PIXELS_PER_BLOCK];
-        memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
+        q0[c] = QuantizeColor( e0[c], s_Max[c] );
+        q1[c] = QuantizeColor( e1[c], s_Max[c] );
+        w0 = _mm_or_si128( w0, _mm_slli_epi32( q0[c], s_Shift[c] ) );
+        w1 = _mm_or_si128( w1, _mm_slli_epi32( q1[c], s_Shift[c] ) );
+    }
 
-        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-        {
-            HDRColorA clr;
-            XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &clr ), pColor[i] );
+    // 4-color mode needs rgb[0] > rgb[1]; equal colors leave every index at 0
+    __m128i swap = _mm_cmpgt_epi32( w1, w0 );
+    __m128i colors = _mm_or_si128( _mm_blendv_epi8( w0, w1, swap ), _mm_slli_epi32( _mm_blendv_epi8( w1, w0, swap ), 16 ) );
 
-            float fAlph = clr.a + fError[i];
+    // Expand to 8 bits as the decoder does, then project every texel onto c0 -> c1
+    __m128i c0[3], dir[3], wdir[3];
+    __m128i len2 = _mm_setzero_si128();
+    for( size_t c = 0; c < 3; ++c )
+    {
+        __m128i a = _mm_blendv_epi8( q0[c], q1[c], swap );
+        __m128i b = _mm_blendv_epi8( q1[c], q0[c], swap );
+        if ( c == 1 )
+        {
+            a = _mm_or_si128( _mm_slli_epi32( a, 2 ), _mm_srli_epi32( a, 4 ) );
+            b = _mm_or_si128( _mm_slli_epi32( b, 2 ), _mm_srli_epi32( b, 4 ) );
+        }
+        else
+        {
+            a = _mm_or_si128( _mm_slli_epi32( a, 3 ), _mm_srli_epi32( a, 2 ) );
+            b = _mm_or_si128( _mm_slli_epi32( b, 3 ), _mm_srli_epi32( b, 2 ) );
+        }
+        c0[c] = a;
+        dir[c] = _mm_sub_epi32( b, a );
+        wdir[c] = _mm_mullo_epi32( dir[c], _mm_set1_epi32( pWeights2[c] ) );
+        len2 = _mm_add_epi32( len2, _mm_mullo_epi32( dir[c], wdir[c] ) );
+    }
 
-            Color[i].r = clr.r;
-            Color[i].g = clr.g;
-            Color[i].b = clr.b;
-            Color[i].a = (float) static_cast<int32_t>(clr.a + fError[i] + 0.5f);
+    // Step k of 0-3 is nearest when 6 * dot lies in ( (2k - 1) * len2, (2k + 1) * len2 ]
+    const __m128i len2x3 = _mm_add_epi32( len2, _mm_add_epi32( len2, len2 ) );
+    const __m128i len2x5 = _mm_add_epi32( len2x3, _mm_add_epi32( len2, len2 ) );
+    const __m128i one = _mm_set1_epi32( 1 );
+    const __m128i two = _mm_set1_epi32( 2 );
 
-            float fDiff = fAlph - Color[i].a;
+    bitmap = _mm_setzero_si128();
+    __m128 error = _mm_setzero_ps();
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+    {
+        __m128i d[3];
+        __m128i dot = _mm_setzero_si128();
+        for( size_t c = 0; c < 3; ++c )
+        {
+            d[c] = _mm_sub_epi32( pTexels[c * NUM_PIXELS_PER_BLOCK + i], c0[c] );
+            dot = _mm_add_epi32( dot, _mm_mullo_epi32( d[c], wdir[c] ) );
+        }
 
-            if(3 != (i & 3))
-            {
-                assert( i < 15 );
-                _Analysis_assume_( i < 15 );
-                fError[i + 1] += fDiff * (7.0f / 16.0f);
-            }
+        __m128i t = _mm_add_epi32( _mm_slli_epi32( dot, 2 ), _mm_slli_epi32( dot, 1 ) );
+        __m128i m1 = _mm_cmpgt_epi32( t, len2 );
+        __m128i m3 = _mm_cmpgt_epi32( t, len2x3 );
+        __m128i m5 = _mm_cmpgt_epi32( t, len2x5 );
 
-            if(i < 12)
-            {
-                if(i & 3)
-                    fError[i + 3] += fDiff * (3.0f / 16.0f);
+        // Steps 0, 1, 2, 3 are indices 0, 2, 3, 1
+        __m128i index = _mm_or_si128( _mm_and_si128( m3, one ), _mm_and_si128( _mm_andnot_si128( m5, m1 ), two ) );
+        bitmap = _mm_or_si128( bitmap, _mm_sll_epi32( index, _mm_cvtsi32_si128( static_cast<int>( i * 2 ) ) ) );
 
-                fError[i + 4] += fDiff * (5.0f / 16.0f);
+        if ( pSteps || pError )
+        {
+            __m128i step = _mm_sub_epi32( _mm_setzero_si128(), _mm_add_epi32( m1, _mm_add_epi32( m3, m5 ) ) );
+            if ( pSteps )
+                pSteps[i] = step;
 
-                if(3 != (i & 3))
+            if ( pError )
+            {
+                // 3 * (texel - palette entry) = 3 * (texel - c0) - step * (c1 - c0)
+                __m128i e = _mm_setzero_si128();
+                for( size_t c = 0; c < 3; ++c )
                 {
-                    assert( i < 11 );
-                    _Analysis_assume_( i < 11 );
-                    fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    __m128i diff = _mm_sub_epi32( _mm_add_epi32( d[c], _mm_add_epi32( d[c], d[c] ) ), _mm_mullo_epi32( step, dir[c] ) );
+                    e = _mm_add_epi32( e, _mm_mullo_epi32( _mm_mullo_epi32( diff, diff ), _mm_set1_epi32( pWeights2[c] ) ) );
                 }
+                error = _mm_add_ps( error, _mm_cvtepi32_ps( e ) );
             }
         }
     }
-    else
+
+    if ( pError )
+        *pError = error;
+
+    return colors;
+}
+
+// Least squares endpoints for the steps of the last fit; lanes where every texel got the same step keep e0/e1.
+static void RefineColorsSSE41( _In_reads_(NUM_PIXELS_PER_BLOCK * 3) const __m128i *pTexels, _In_reads_(NUM_PIXELS_PER_BLOCK) const __m128i *pSteps,
+                               _Inout_updates_(3) __m128i *e0, _Inout_updates_(3) __m128i *e1 )
+{
+    const __m128i three = _mm_set1_epi32( 3 );
+
+    __m128i saa = _mm_setzero_si128();
+    __m128i sbb = _mm_setzero_si128();
+    __m128i sab = _mm_setzero_si128();
+    __m128i sax[3], sbx[3];
+    for( size_t c = 0; c < 3; ++c )
     {
-        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        sax[c] = _mm_setzero_si128();
+        sbx[c] = _mm_setzero_si128();
+    }
+
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+    {
+        __m128i beta = pSteps[i];
+        __m128i alpha = _mm_sub_epi32( three, beta );
+        saa = _mm_add_epi32( saa, _mm_mullo_epi32( alpha, alpha ) );
+        sbb = _mm_add_epi32( sbb, _mm_mullo_epi32( beta, beta ) );
+        sab = _mm_add_epi32( sab, _mm_mullo_epi32( alpha, beta ) );
+        for( size_t c = 0; c < 3; ++c )
         {
-            XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+            sax[c] = _mm_add_epi32( sax[c], _mm_mullo_epi32( alpha, pTexels[c * NUM_PIXELS_PER_BLOCK + i] ) );
+            sbx[c] = _mm_add_epi32( sbx[c], _mm_mullo_epi32( beta, pTexels[c * NUM_PIXELS_PER_BLOCK + i] ) );
         }
     }
 
-    auto pBC1 = reinterpret_cast<D3DX_BC1 *>(pBC);
-    EncodeBC1(pBC1, Color, true, alphaRef, flags);
+    __m128i det = _mm_sub_epi32( _mm_mullo_epi32( saa, sbb ), _mm_mullo_epi32( sab, sab ) );
+    __m128i keep = _mm_cmpeq_epi32( det, _mm_setzero_si128() );
+    __m128 scale = _mm_div_ps( _mm_set1_ps( 3.0f ), _mm_cvtepi32_ps( _mm_max_epi32( det, _mm_set1_epi32( 1 ) ) ) );
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32( 255 );
+    for( size_t c = 0; c < 3; ++c )
+    {
+        __m128i a = _mm_sub_epi32( _mm_mullo_epi32( sbb, sax[c] ), _mm_mullo_epi32( sab, sbx[c] ) );
+        __m128i b = _mm_sub_epi32( _mm_mullo_epi32( saa, sbx[c] ), _mm_mullo_epi32( sab, sax[c] ) );
+        a = _mm_min_epi32( _mm_max_epi32( _mm_cvtps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( a ), scale ) ), zero ), max );
+        b = _mm_min_epi32( _mm_max_epi32( _mm_cvtps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( b ), scale ) ), zero ), max );
+        e0[c] = _mm_blendv_epi8( a, e0[c], keep );
+        e1[c] = _mm_blendv_epi8( b, e1[c], keep );
+    }
 }
 
+// Keeps the candidate with the lower error in each lane.
+inline static void KeepBetterColors( _In_ __m128 error, _In_ __m128i colors, _In_ __m128i bitmap,
+                                     _Inout_ __m128& bestError, _Inout_ __m128i& bestColors, _Inout_ __m128i& bestBitmap )
+{
+    __m128i better = _mm_castps_si128( _mm_cmplt_ps( error, bestError ) );
+    bestError = _mm_min_ps( error, bestError );
+    bestColors = _mm_blendv_epi8( bestColors, colors, better );
+    bestBitmap = _mm_blendv_epi8( bestBitmap, bitmap, better );
+}
 
-//-------------------------------------------------------------------------------------
-// BC2 Compression
-//-------------------------------------------------------------------------------------
-_Use_decl_annotations_
-void D3DXDecodeBC2(XMVECTOR *pColor, const uint8_t *pBC)
+// Channel c of texel i of lane b is at pRGB[ (c * 16 + i) * pitch + b ]: pitch is BC_COLOR_BLOCKS for
+// BCColorBlocks and BC_RUN_BLOCKS within a BCBlockRun.
+static void EncodeBC1ColorsSSE41( _Out_writes_bytes_(nBlocks * stride) uint8_t *pBC, _In_ size_t stride, _In_ const uint8_t *pRGB, _In_ size_t pitch,
+                                  _In_ size_t nBlocks, _In_ DWORD flags )
 {
-    assert( pColor && pBC );
-    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+    const size_t uWeights = ( flags & BC_FLAGS_UNIFORM ) ? 1 : 0;
+    const int32_t *pWeights2 = g_ColorWeights2[ uWeights ];
+    const float *pWeights = g_ColorWeights[ uWeights ];
+    const DWORD quality = flags & BC_FLAGS_QUALITY_MASK;
+
+    // texels[c * 16 + i] holds channel c of texel i, one block per lane
+    __m128i texels[NUM_PIXELS_PER_BLOCK * 3];
+    __m128i sum[3], lo[3], hi[3];
+    for( size_t c = 0; c < 3; ++c )
+    {
+        sum[c] = _mm_setzero_si128();
+        lo[c] = _mm_set1_epi32( 255 );
+        hi[c] = _mm_setzero_si128();
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+        {
+            int32_t packed;
+            memcpy( &packed, pRGB + (c * NUM_PIXELS_PER_BLOCK + i) * pitch, sizeof(packed) );
+            __m128i t = _mm_cvtepu8_epi32( _mm_cvtsi32_si128( packed ) );
+            texels[c * NUM_PIXELS_PER_BLOCK + i] = t;
+            sum[c] = _mm_add_epi32( sum[c], t );
+            lo[c] = _mm_min_epi32( lo[c], t );
+            hi[c] = _mm_max_epi32( hi[c], t );
+        }
+    }
 
-    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+    // Covariance x256 of the texels about their mean: rr, rg, rb, gg, gb, bb
+    __m128i cov[6];
+    for( size_t k = 0; k < 6; ++k )
+        cov[k] = _mm_setzero_si128();
 
-    // RGB part
-    DecodeBC1(pColor, &pBC2->bc1, false);
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+    {
+        __m128i d[3];
+        for( size_t c = 0; c < 3; ++c )
+            d[c] = _mm_sub_epi32( _mm_slli_epi32( texels[c * NUM_PIXELS_PER_BLOCK + i], 4 ), sum[c] );
+
+        cov[0] = _mm_add_epi32( cov[0], _mm_mullo_epi32( d[0], d[0] ) );
+        cov[1] = _mm_add_epi32( cov[1], _mm_mullo_epi32( d[0], d[1] ) );
+        cov[2] = _mm_add_epi32( cov[2], _mm_mullo_epi32( d[0], d[2] ) );
+        cov[3] = _mm_add_epi32( cov[3], _mm_mullo_epi32( d[1], d[1] ) );
+        cov[4] = _mm_add_epi32( cov[4], _mm_mullo_epi32( d[1], d[2] ) );
+        cov[5] = _mm_add_epi32( cov[5], _mm_mullo_epi32( d[2], d[2] ) );
+    }
 
-    // 4-bit alpha part
-    DWORD dw = pBC2->bitmap[0];
+    // Range fit: the bounding box diagonal, with red and blue flipped where they run against
+    // green (blue against red when green is flat)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i flipR = _mm_cmplt_epi32( cov[1], zero );
+    __m128i flipB = _mm_blendv_epi8( _mm_cmplt_epi32( cov[4], zero ),
+                                     _mm_xor_si128( flipR, _mm_cmplt_epi32( cov[2], zero ) ),
+                                     _mm_cmpeq_epi32( cov[3], zero ) );
+    __m128i flip[3] = { flipR, zero, flipB };
+
+    __m128i r0[3], r1[3];
+    for( size_t c = 0; c < 3; ++c )
+    {
+        r0[c] = _mm_blendv_epi8( hi[c], lo[c], flip[c] );
+        r1[c] = _mm_blendv_epi8( lo[c], hi[c], flip[c] );
+    }
 
-    for(size_t i = 0; i < 8; ++i, dw >>= 4)
+    __m128i e0[3], e1[3];
+    for( size_t c = 0; c < 3; ++c )
     {
-        #pragma prefast(suppress:22103, "writing blocks in two halves confuses tool")
-        pColor[i] = XMVectorSetW( pColor[i], (float) (dw & 0xf) * (1.0f / 15.0f) );
+        // Inset by 1/16th of the range, as the extremes rarely sit on the palette
+        __m128i inset = _mm_srai_epi32( _mm_sub_epi32( r0[c], r1[c] ), 4 );
+        e0[c] = _mm_sub_epi32( r0[c], inset );
+        e1[c] = _mm_add_epi32( r1[c], inset );
     }
 
-    dw = pBC2->bitmap[1];
+    __m128i bitmap;
+    __m128i colors;
+    __m128 error;
 
-    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 4)
-        pColor[i] = XMVectorSetW( pColor[i], (float) (dw & 0xf) * (1.0f / 15.0f) );
+    if ( quality == BC_FLAGS_QUALITY_FAST )
+    {
+        colors = FitColorsSSE41( texels, e0, e1, pWeights2, bitmap, nullptr, nullptr );
+    }
+    else
+    {
+        __m128i bestColors = zero;
+        __m128i bestBitmap = zero;
+        __m128 bestError = _mm_set1_ps( FLT_MAX );
+        if ( quality == BC_FLAGS_QUALITY_HIGH )
+        {
+            bestColors = FitColorsSSE41( texels, e0, e1, pWeights2, bestBitmap, nullptr, &bestError );
+        }
+
+        // Principal axis of the weighted covariance by power iteration, from the range fit diagonal
+        __m128 w[3], v[3], m[6];
+        for( size_t c = 0; c < 3; ++c )
+        {
+            w[c] = _mm_set1_ps( pWeights[c] );
+            v[c] = _mm_mul_ps( _mm_cvtepi32_ps( _mm_sub_epi32( r0[c], r1[c] ) ), w[c] );
+        }
+        m[0] = _mm_mul_ps( _mm_cvtepi32_ps( cov[0] ), _mm_mul_ps( w[0], w[0] ) );
+        m[1] = _mm_mul_ps( _mm_cvtepi32_ps( cov[1] ), _mm_mul_ps( w[0], w[1] ) );
+        m[2] = _mm_mul_ps( _mm_cvtepi32_ps( cov[2] ), _mm_mul_ps( w[0], w[2] ) );
+        m[3] = _mm_mul_ps( _mm_cvtepi32_ps( cov[3] ), _mm_mul_ps( w[1], w[1] ) );
+        m[4] = _mm_mul_ps( _mm_cvtepi32_ps( cov[4] ), _mm_mul_ps( w[1], w[2] ) );
+        m[5] = _mm_mul_ps( _mm_cvtepi32_ps( cov[5] ), _mm_mul_ps( w[2], w[2] ) );
+
+        const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+        __m128 len = _mm_setzero_ps();
+        for( size_t iter = 0; iter < 4; ++iter )
+        {
+            __m128 x = _mm_add_ps( _mm_add_ps( _mm_mul_ps( m[0], v[0] ), _mm_mul_ps( m[1], v[1] ) ), _mm_mul_ps( m[2], v[2] ) );
+            __m128 y = _mm_add_ps( _mm_add_ps( _mm_mul_ps( m[1], v[0] ), _mm_mul_ps( m[3], v[1] ) ), _mm_mul_ps( m[4], v[2] ) );
+            __m128 z = _mm_add_ps( _mm_add_ps( _mm_mul_ps( m[2], v[0] ), _mm_mul_ps( m[4], v[1] ) ), _mm_mul_ps( m[5], v[2] ) );
+            len = _mm_max_ps( _mm_max_ps( _mm_and_ps( x, absMask ), _mm_and_ps( y, absMask ) ), _mm_and_ps( z, absMask ) );
+            __m128 scale = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_max_ps( len, _mm_set1_ps( FLT_MIN ) ) );
+            v[0] = _mm_mul_ps( x, scale );
+            v[1] = _mm_mul_ps( y, scale );
+            v[2] = _mm_mul_ps( z, scale );
+        }
+
+        // Integer projection onto the axis, back in unweighted space; the extreme texels are the endpoints
+        __m128i axis[3];
+        __m128 amax = _mm_setzero_ps();
+        for( size_t c = 0; c < 3; ++c )
+        {
+            v[c] = _mm_mul_ps( v[c], w[c] );
+            amax = _mm_max_ps( amax, _mm_and_ps( v[c], absMask ) );
+        }
+        __m128 ascale = _mm_div_ps( _mm_set1_ps( 256.0f ), _mm_max_ps( amax, _mm_set1_ps( FLT_MIN ) ) );
+        for( size_t c = 0; c < 3; ++c )
+            axis[c] = _mm_cvtps_epi32( _mm_mul_ps( v[c], ascale ) );
+
+        __m128i pmin = _mm_set1_epi32( INT32_MAX );
+        __m128i pmax = _mm_set1_epi32( INT32_MIN );
+        __m128i p0[3], p1[3];
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+        {
+            __m128i p = _mm_setzero_si128();
+            for( size_t c = 0; c < 3; ++c )
+                p = _mm_add_epi32( p, _mm_mullo_epi32( texels[c * NUM_PIXELS_PER_BLOCK + i], axis[c] ) );
+
+            __m128i above = _mm_cmpgt_epi32( p, pmax );
+            __m128i below = _mm_cmplt_epi32( p, pmin );
+            pmax = _mm_max_epi32( pmax, p );
+            pmin = _mm_min_epi32( pmin, p );
+            for( size_t c = 0; c < 3; ++c )
+            {
+                const __m128i& t = texels[c * NUM_PIXELS_PER_BLOCK + i];
+                p0[c] = i ? _mm_blendv_epi8( p0[c], t, above ) : t;
+                p1[c] = i ? _mm_blendv_epi8( p1[c], t, below ) : t;
+            }
+        }
+
+        // A flat axis (no spread left after the iteration) keeps the range fit
+        __m128i flat = _mm_castps_si128( _mm_cmple_ps( len, _mm_setzero_ps() ) );
+        for( size_t c = 0; c < 3; ++c )
+        {
+            e0[c] = _mm_blendv_epi8( p0[c], e0[c], flat );
+            e1[c] = _mm_blendv_epi8( p1[c], e1[c], flat );
+        }
+
+        __m128i steps[NUM_PIXELS_PER_BLOCK];
+        const size_t uPasses = ( quality == BC_FLAGS_QUALITY_HIGH ) ? 2 : 1;
+        for( size_t pass = 0; ; ++pass )
+        {
+            colors = FitColorsSSE41( texels, e0, e1, pWeights2, bitmap, steps, &error );
+            KeepBetterColors( error, colors, bitmap, bestError, bestColors, bestBitmap );
+            if ( pass == uPasses )
+                break;
+
+            RefineColorsSSE41( texels, steps, e0, e1 );
+        }
+
+        colors = bestColors;
+        bitmap = bestBitmap;
+    }
+
+    uint32_t outColors[BC_COLOR_BLOCKS];
+    uint32_t outBitmap[BC_COLOR_BLOCKS];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( outColors ), colors );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( outBitmap ), bitmap );
+
+    for( size_t b = 0; b < nBlocks; ++b )
+    {
+        auto pBC1 = reinterpret_cast<D3DX_BC1 *>( pBC + b * stride );
+        pBC1->rgb[0] = static_cast<uint16_t>( outColors[b] & 0xffff );
+        pBC1->rgb[1] = static_cast<uint16_t>( outColors[b] >> 16 );
+        pBC1->bitmap = outBitmap[b];
+    }
 }
 
-_Use_decl_annotations_
-void D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
+inline static uint8_t ColorToByte( _In_ float f )
 {
-    assert( pBC && pColor );
-    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+    return (f <= 0.0f) ? 0 : (f >= 1.0f) ? 255 : static_cast<uint8_t>( f * 255.0f + 0.5f );
+}
 
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
-    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+#endif // _XM_SSE_INTRINSICS_
+
+// The SIMD encoder takes BC1-3 colors when a quality tier is selected and the CPU has SSE4.1.
+inline static bool UseSIMDColors( _In_ DWORD flags )
+{
+#ifdef _XM_SSE_INTRINSICS_
+    return (flags & BC_FLAGS_QUALITY_MASK) && !(flags & BC_FLAGS_DITHER_RGB) && HasSSE41();
+#else
+    UNREFERENCED_PARAMETER(flags);
+    return false;
+#endif
+}
+
+// RGB part of BC1-3
+static void EncodeBC1Color(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor, _In_ DWORD flags)
+{
+#ifdef _XM_SSE_INTRINSICS_
+    if ( UseSIMDColors( flags ) )
     {
-        XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+        BCColorBlocks blocks;
+        memset( &blocks, 0, sizeof(blocks) );
+        for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+        {
+            blocks.rgb[0][i][0] = ColorToByte( pColor[i].r );
+            blocks.rgb[1][i][0] = ColorToByte( pColor[i].g );
+            blocks.rgb[2][i][0] = ColorToByte( pColor[i].b );
+        }
+
+        EncodeBC1ColorsSSE41( reinterpret_cast<uint8_t*>( pBC ), sizeof(D3DX_BC1), &blocks.rgb[0][0][0], BC_COLOR_BLOCKS, 1, flags );
+        return;
     }
+#endif
 
-    auto pBC2 = reinterpret_cast<D3DX_BC2 *>(pBC);
+    EncodeBC1(pBC, pColor, false, 0.f, flags);
+}
 
-    // 4-bit alpha part.  Dithered using Floyd Stienberg error diffusion.
-    pBC2->bitmap[0] = 0;
-    pBC2->bitmap[1] = 0;
 
+//-------------------------------------------------------------------------------------
+// Alpha part of BC3
+static void EncodeBC3Alpha(_Inout_ D3DX_BC3 *pBC3, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor, _In_ DWORD flags)
+{
+    // Quantize block to A8, using Floyd Stienberg error diffusion.  This 
+    // increases the chance that colors will map directly to the quantized 
+    // axis endpoints.
+    float fAlpha[NUM_PIXELS_PER_BLOCK];
     float fError[NUM_PIXELS_PER_BLOCK];
+
+    float fMinAlpha = pColor[0].a;
+    float fMaxAlpha = pColor[0].a;
+
     if (flags & BC_FLAGS_DITHER_A)
         memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
 
     for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
-        float fAlph = Color[i].a;
+        float fAlph = pColor[i].a;
         if (flags & BC_FLAGS_DITHER_A)
             fAlph += fError[i];
 
-        uint32_t u = (uint32_t) static_cast<int32_t>(fAlph * 15.0f + 0.5f);
-
-        pBC2->bitmap[i >> 3] >>= 4;
-        pBC2->bitmap[i >> 3] |= (u << 28);
+        fAlpha[i] = static_cast<int32_t>(fAlph * 255.0f + 0.5f) * (1.0f / 255.0f);
 
+        if(fAlpha[i] < fMinAlpha)
+            fMinAlpha = fAlpha[i];
+        else if(fAlpha[i] > fMaxAlpha)
+            fMaxAlpha = fAlpha[i];
+    
         if (flags & BC_FLAGS_DITHER_A)
-        {     
-            float fDiff = fAlph - (float) u * (1.0f / 15.0f);
+        {
+            float fDiff = fAlph - fAlpha[i];
 
             if(3 != (i & 3))
             {
@@ -877,150 +1337,21 @@ void D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
         }
     }
 
-    // RGB part
 #ifdef COLOR_WEIGHTS
-    if(!pBC2->bitmap[0] && !pBC2->bitmap[1])
+    if(0.0f == fMaxAlpha)
     {
-        EncodeSolidBC1(pBC2->dxt1, Color);
-        return;
-    }
-#endif // COLOR_WEIGHTS
-
-    EncodeBC1(&pBC2->bc1, Color, false, 0.f, flags);
-}
-
-
-//-------------------------------------------------------------------------------------
-// BC3 Compression
-//-------------------------------------------------------------------------------------
-_Use_decl_annotations_
-void D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
-{
-    assert( pColor && pBC );
-    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
-
-    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
-
-    // RGB part
-    DecodeBC1(pColor, &pBC3->bc1, false);
-
-    // Adaptive 3-bit alpha part
-    float fAlpha[8];
-
-    fAlpha[0] = ((float) pBC3->alpha[0]) * (1.0f / 255.0f);
-    fAlpha[1] = ((float) pBC3->alpha[1]) * (1.0f / 255.0f);
-
-    if(pBC3->alpha[0] > pBC3->alpha[1]) 
-    {
-        for(size_t i = 1; i < 7; ++i)
-            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
-    }
-    else 
-    {
-        for(size_t i = 1; i < 5; ++i)
-            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
-
-        fAlpha[6] = 0.0f;
-        fAlpha[7] = 1.0f;
-    }
-
-    DWORD dw = pBC3->bitmap[0] | (pBC3->bitmap[1] << 8) | (pBC3->bitmap[2] << 16);
-
-    for(size_t i = 0; i < 8; ++i, dw >>= 3)
-        pColor[i] = XMVectorSetW( pColor[i], fAlpha[dw & 0x7] );
-
-    dw = pBC3->bitmap[3] | (pBC3->bitmap[4] << 8) | (pBC3->bitmap[5] << 16);
-
-    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
-        pColor[i] = XMVectorSetW( pColor[i], fAlpha[dw & 0x7] );
-}
-
-_Use_decl_annotations_
-void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
-{
-    assert( pBC && pColor );
-    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
-
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
-    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-    {
-        XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
-    }
-
-    auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
-
-    // Quantize block to A8, using Floyd Stienberg error diffusion.  This 
-    // increases the chance that colors will map directly to the quantized 
-    // axis endpoints.
-    float fAlpha[NUM_PIXELS_PER_BLOCK];
-    float fError[NUM_PIXELS_PER_BLOCK];
-
-    float fMinAlpha = Color[0].a;
-    float fMaxAlpha = Color[0].a;
-
-    if (flags & BC_FLAGS_DITHER_A)
-        memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
-
-    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-    {
-        float fAlph = Color[i].a;
-        if (flags & BC_FLAGS_DITHER_A)
-            fAlph += fError[i];
-
-        fAlpha[i] = static_cast<int32_t>(fAlph * 255.0f + 0.5f) * (1.0f / 255.0f);
-
-        if(fAlpha[i] < fMinAlpha)
-            fMinAlpha = fAlpha[i];
-        else if(fAlpha[i] > fMaxAlpha)
-            fMaxAlpha = fAlpha[i];
-    
-        if (flags & BC_FLAGS_DITHER_A)
-        {
-            float fDiff = fAlph - fAlpha[i];
-
-            if(3 != (i & 3))
-            {
-                assert( i < 15 );
-                _Analysis_assume_( i < 15 );
-                fError[i + 1] += fDiff * (7.0f / 16.0f);
-            }
-
-            if(i < 12)
-            {
-                if(i & 3)
-                    fError[i + 3] += fDiff * (3.0f / 16.0f);
-
-                fError[i + 4] += fDiff * (5.0f / 16.0f);
-
-                if(3 != (i & 3))
-                {
-                    assert( i < 11 );
-                    _Analysis_assume_( i < 11 );
-                    fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
-        }
-    }
-
-#ifdef COLOR_WEIGHTS
-    if(0.0f == fMaxAlpha)
-    {
-        EncodeSolidBC1(&pBC3->dxt1, Color);
-        pBC3->alpha[0] = 0x00;
-        pBC3->alpha[1] = 0x00;
-        memset(pBC3->bitmap, 0x00, 6);
-    }
-#endif
-
-    // RGB part
-    EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
-
-    // Alpha part
-    if(1.0f == fMinAlpha)
-    {
-        pBC3->alpha[0] = 0xff;
-        pBC3->alpha[1] = 0xff;
-        memset(pBC3->bitmap, 0x00, 6);
+        EncodeSolidBC1(&pBC3->dxt1, pColor);
+        pBC3->alpha[0] = 0x00;
+        pBC3->alpha[1] = 0x00;
+        memset(pBC3->bitmap, 0x00, 6);
+    }
+#endif
+
+    if(1.0f == fMinAlpha)
+    {
+        pBC3->alpha[0] = 0xff;
+        pBC3->alpha[1] = 0xff;
+        memset(pBC3->bitmap, 0x00, 6);
         return;
     }
 
@@ -1097,7 +1428,7 @@ void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 
         for(size_t i = iMin; i < iLim; ++i)
         {
-            float fAlph = Color[i].a;
+            float fAlph = pColor[i].a;
             if (flags & BC_FLAGS_DITHER_A)
                 fAlph += fError[i];
             float fDot = (fAlph - fStep[0]) * fScale;
@@ -1138,4 +1469,720 @@ void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
     }
 }
 
+
+//-------------------------------------------------------------------------------------
+// Solid blocks
+//-------------------------------------------------------------------------------------
+
+// Endpoints { rgb[0], rgb[1] } of each 8-bit value whose 1/3 interpolant (index 2) decodes closest
+// to it: 5-bit for red and blue, 6-bit for green. None is more than 1 off.
+static const uint8_t g_SolidBC1R5[256][2] =
+{
+    {  0,  0 }, {  0,  0 }, {  0,  1 }, {  0,  1 }, {  0,  1 }, {  0,  2 }, {  0,  2 }, {  0,  3 },
+    {  0,  3 }, {  0,  3 }, {  0,  4 }, {  0,  4 }, {  0,  4 }, {  0,  5 }, {  0,  5 }, {  0,  5 },
+    {  0,  6 }, {  0,  6 }, {  0,  7 }, {  0,  7 }, {  0,  7 }, {  0,  8 }, {  0,  8 }, {  0,  8 },
+    {  0,  9 }, {  0,  9 }, {  0,  9 }, {  0, 10 }, {  0, 10 }, {  0, 11 }, {  0, 11 }, {  0, 11 },
+    {  0, 12 }, {  0, 12 }, {  0, 12 }, {  0, 13 }, {  0, 13 }, {  0, 13 }, {  0, 14 }, {  0, 14 },
+    {  0, 15 }, {  0, 15 }, {  0, 15 }, {  0, 16 }, {  0, 16 }, {  0, 16 }, {  0, 17 }, {  0, 17 },
+    {  0, 17 }, {  0, 18 }, {  0, 18 }, {  0, 19 }, {  0, 19 }, {  0, 19 }, {  0, 20 }, {  0, 20 },
+    {  0, 20 }, {  0, 21 }, {  0, 21 }, {  0, 21 }, {  0, 22 }, {  0, 22 }, {  0, 23 }, {  0, 23 },
+    {  0, 23 }, {  0, 24 }, {  0, 24 }, {  0, 24 }, {  0, 25 }, {  0, 25 }, {  0, 25 }, {  0, 26 },
+    {  0, 26 }, {  0, 27 }, {  0, 27 }, {  0, 27 }, {  0, 28 }, {  0, 28 }, {  0, 28 }, {  0, 29 },
+    {  0, 29 }, {  0, 29 }, {  0, 30 }, {  0, 30 }, {  0, 31 }, {  0, 31 }, {  0, 31 }, {  1, 30 },
+    {  1, 30 }, {  1, 30 }, {  1, 31 }, {  1, 31 }, {  2, 30 }, {  2, 30 }, {  2, 30 }, {  2, 31 },
+    {  2, 31 }, {  2, 31 }, {  3, 30 }, {  3, 30 }, {  3, 30 }, {  3, 31 }, {  3, 31 }, {  4, 30 },
+    {  4, 30 }, {  4, 30 }, {  4, 31 }, {  4, 31 }, {  4, 31 }, {  5, 30 }, {  5, 30 }, {  5, 30 },
+    {  5, 31 }, {  5, 31 }, {  6, 30 }, {  6, 30 }, {  6, 30 }, {  6, 31 }, {  6, 31 }, {  6, 31 },
+    {  7, 30 }, {  7, 30 }, {  7, 30 }, {  7, 31 }, {  7, 31 }, {  8, 30 }, {  8, 30 }, {  8, 30 },
+    {  8, 31 }, {  8, 31 }, {  8, 31 }, {  9, 30 }, {  9, 30 }, {  9, 30 }, {  9, 31 }, {  9, 31 },
+    { 10, 30 }, { 10, 30 }, { 10, 30 }, { 10, 31 }, { 10, 31 }, { 10, 31 }, { 11, 30 }, { 11, 30 },
+    { 11, 30 }, { 11, 31 }, { 11, 31 }, { 12, 30 }, { 12, 30 }, { 12, 30 }, { 12, 31 }, { 12, 31 },
+    { 12, 31 }, { 13, 30 }, { 13, 30 }, { 13, 30 }, { 13, 31 }, { 13, 31 }, { 14, 30 }, { 14, 30 },
+    { 14, 30 }, { 14, 31 }, { 14, 31 }, { 14, 31 }, { 15, 30 }, { 15, 30 }, { 15, 30 }, { 15, 31 },
+    { 15, 31 }, { 16, 30 }, { 16, 30 }, { 16, 30 }, { 16, 31 }, { 16, 31 }, { 16, 31 }, { 17, 30 },
+    { 17, 30 }, { 17, 31 }, { 17, 31 }, { 17, 31 }, { 18, 30 }, { 18, 30 }, { 18, 30 }, { 18, 31 },
+    { 18, 31 }, { 18, 31 }, { 19, 30 }, { 19, 30 }, { 19, 31 }, { 19, 31 }, { 19, 31 }, { 20, 30 },
+    { 20, 30 }, { 20, 30 }, { 20, 31 }, { 20, 31 }, { 20, 31 }, { 21, 30 }, { 21, 30 }, { 21, 31 },
+    { 21, 31 }, { 21, 31 }, { 22, 30 }, { 22, 30 }, { 22, 30 }, { 22, 31 }, { 22, 31 }, { 22, 31 },
+    { 23, 30 }, { 23, 30 }, { 23, 31 }, { 23, 31 }, { 23, 31 }, { 24, 30 }, { 24, 30 }, { 24, 30 },
+    { 24, 31 }, { 24, 31 }, { 24, 31 }, { 25, 30 }, { 25, 30 }, { 25, 31 }, { 25, 31 }, { 25, 31 },
+    { 26, 30 }, { 26, 30 }, { 26, 30 }, { 26, 31 }, { 26, 31 }, { 26, 31 }, { 27, 30 }, { 27, 30 },
+    { 27, 31 }, { 27, 31 }, { 27, 31 }, { 28, 30 }, { 28, 30 }, { 28, 30 }, { 28, 31 }, { 28, 31 },
+    { 28, 31 }, { 29, 30 }, { 29, 30 }, { 29, 31 }, { 29, 31 }, { 29, 31 }, { 30, 30 }, { 30, 30 },
+    { 30, 30 }, { 30, 31 }, { 30, 31 }, { 30, 31 }, { 31, 30 }, { 31, 30 }, { 31, 31 }, { 31, 31 },
+};
+
+static const uint8_t g_SolidBC1G6[256][2] =
+{
+    {  0,  0 }, {  0,  1 }, {  0,  1 }, {  0,  2 }, {  0,  3 }, {  0,  4 }, {  0,  4 }, {  0,  5 },
+    {  0,  6 }, {  0,  7 }, {  0,  7 }, {  0,  8 }, {  0,  9 }, {  0, 10 }, {  0, 10 }, {  0, 11 },
+    {  0, 12 }, {  0, 12 }, {  0, 13 }, {  0, 14 }, {  0, 15 }, {  0, 15 }, {  0, 16 }, {  0, 17 },
+    {  0, 18 }, {  0, 18 }, {  0, 19 }, {  0, 20 }, {  0, 21 }, {  0, 21 }, {  0, 22 }, {  0, 23 },
+    {  0, 24 }, {  0, 24 }, {  0, 25 }, {  0, 26 }, {  0, 27 }, {  0, 27 }, {  0, 28 }, {  0, 29 },
+    {  0, 30 }, {  0, 30 }, {  0, 31 }, {  0, 32 }, {  0, 32 }, {  0, 33 }, {  0, 34 }, {  0, 35 },
+    {  0, 35 }, {  0, 36 }, {  0, 37 }, {  0, 38 }, {  0, 38 }, {  0, 39 }, {  0, 40 }, {  0, 41 },
+    {  0, 41 }, {  0, 42 }, {  0, 43 }, {  0, 44 }, {  0, 44 }, {  0, 45 }, {  0, 46 }, {  0, 47 },
+    {  0, 47 }, {  0, 48 }, {  0, 49 }, {  0, 50 }, {  0, 50 }, {  0, 51 }, {  0, 52 }, {  0, 52 },
+    {  0, 53 }, {  0, 54 }, {  0, 55 }, {  0, 55 }, {  0, 56 }, {  0, 57 }, {  0, 58 }, {  0, 58 },
+    {  0, 59 }, {  0, 60 }, {  0, 61 }, {  0, 61 }, {  0, 62 }, {  0, 63 }, {  1, 62 }, {  1, 62 },
+    {  1, 63 }, {  2, 62 }, {  2, 63 }, {  2, 63 }, {  3, 62 }, {  3, 63 }, {  4, 62 }, {  4, 62 },
+    {  4, 63 }, {  5, 62 }, {  5, 63 }, {  5, 63 }, {  6, 62 }, {  6, 63 }, {  6, 63 }, {  7, 62 },
+    {  7, 63 }, {  8, 62 }, {  8, 62 }, {  8, 63 }, {  9, 62 }, {  9, 63 }, {  9, 63 }, { 10, 62 },
+    { 10, 63 }, { 11, 62 }, { 11, 62 }, { 11, 63 }, { 12, 62 }, { 12, 63 }, { 12, 63 }, { 13, 62 },
+    { 13, 63 }, { 14, 62 }, { 14, 62 }, { 14, 63 }, { 15, 62 }, { 15, 63 }, { 15, 63 }, { 16, 62 },
+    { 16, 63 }, { 16, 63 }, { 17, 62 }, { 17, 63 }, { 18, 62 }, { 18, 62 }, { 18, 63 }, { 19, 62 },
+    { 19, 63 }, { 19, 63 }, { 20, 62 }, { 20, 63 }, { 21, 62 }, { 21, 62 }, { 21, 63 }, { 22, 62 },
+    { 22, 63 }, { 22, 63 }, { 23, 62 }, { 23, 63 }, { 24, 62 }, { 24, 62 }, { 24, 63 }, { 25, 62 },
+    { 25, 63 }, { 25, 63 }, { 26, 62 }, { 26, 63 }, { 26, 63 }, { 27, 62 }, { 27, 63 }, { 28, 62 },
+    { 28, 62 }, { 28, 63 }, { 29, 62 }, { 29, 63 }, { 29, 63 }, { 30, 62 }, { 30, 63 }, { 31, 62 },
+    { 31, 62 }, { 31, 63 }, { 32, 62 }, { 32, 63 }, { 32, 63 }, { 33, 62 }, { 33, 63 }, { 34, 62 },
+    { 34, 62 }, { 34, 63 }, { 35, 62 }, { 35, 63 }, { 35, 63 }, { 36, 62 }, { 36, 63 }, { 37, 62 },
+    { 37, 62 }, { 37, 63 }, { 38, 62 }, { 38, 62 }, { 38, 63 }, { 39, 62 }, { 39, 63 }, { 39, 63 },
+    { 40, 62 }, { 40, 63 }, { 41, 62 }, { 41, 62 }, { 41, 63 }, { 42, 62 }, { 42, 63 }, { 42, 63 },
+    { 43, 62 }, { 43, 63 }, { 44, 62 }, { 44, 62 }, { 44, 63 }, { 45, 62 }, { 45, 63 }, { 45, 63 },
+    { 46, 62 }, { 46, 63 }, { 47, 62 }, { 47, 62 }, { 47, 63 }, { 48, 62 }, { 48, 62 }, { 48, 63 },
+    { 49, 62 }, { 49, 63 }, { 49, 63 }, { 50, 62 }, { 50, 63 }, { 51, 62 }, { 51, 62 }, { 51, 63 },
+    { 52, 62 }, { 52, 63 }, { 52, 63 }, { 53, 62 }, { 53, 63 }, { 54, 62 }, { 54, 62 }, { 54, 63 },
+    { 55, 62 }, { 55, 63 }, { 55, 63 }, { 56, 62 }, { 56, 63 }, { 57, 62 }, { 57, 62 }, { 57, 63 },
+    { 58, 62 }, { 58, 62 }, { 58, 63 }, { 59, 62 }, { 59, 63 }, { 59, 63 }, { 60, 62 }, { 60, 63 },
+    { 61, 62 }, { 61, 62 }, { 61, 63 }, { 62, 62 }, { 62, 63 }, { 62, 63 }, { 63, 62 }, { 63, 63 },
+};
+
+inline static uint8_t FloatToByte( _In_ float f )
+{
+    return static_cast<uint8_t>( std::min<float>( std::max<float>( f, 0.f ), 1.f ) * 255.f + 0.5f );
+}
+
+// Opaque 4-color BC1 colors for a block of one color, from the single-color tables
+static void EncodeSolidColor(_Out_ D3DX_BC1 *pBC, _In_ uint8_t r, _In_ uint8_t g, _In_ uint8_t b)
+{
+    uint16_t rgb0 = static_cast<uint16_t>( (g_SolidBC1R5[r][0] << 11) | (g_SolidBC1G6[g][0] << 5) | g_SolidBC1R5[b][0] );
+    uint16_t rgb1 = static_cast<uint16_t>( (g_SolidBC1R5[r][1] << 11) | (g_SolidBC1G6[g][1] << 5) | g_SolidBC1R5[b][1] );
+
+    if (rgb0 > rgb1)
+    {
+        pBC->rgb[0] = rgb0;
+        pBC->rgb[1] = rgb1;
+        pBC->bitmap = 0xAAAAAAAA;   // Index 2
+    }
+    else if (rgb0 < rgb1)
+    {
+        // Swapped, so the same interpolant is index 3
+        pBC->rgb[0] = rgb1;
+        pBC->rgb[1] = rgb0;
+        pBC->bitmap = 0xFFFFFFFF;
+    }
+    else
+    {
+        // Exact endpoint
+        pBC->rgb[0] = rgb0;
+        pBC->rgb[1] = rgb1;
+        pBC->bitmap = 0x00000000;
+    }
+}
+
+inline static void EncodeSolidColor(_Out_ D3DX_BC1 *pBC, _In_ const HDRColorA& color)
+{
+    EncodeSolidColor( pBC, FloatToByte( color.r ), FloatToByte( color.g ), FloatToByte( color.b ) );
+}
+
+// Both alpha endpoints exact, every index 0
+inline static void EncodeSolidBC3Alpha(_Inout_ D3DX_BC3 *pBC3, _In_ uint8_t a)
+{
+    pBC3->alpha[0] = a;
+    pBC3->alpha[1] = a;
+    memset( pBC3->bitmap, 0, sizeof(pBC3->bitmap) );
+}
+
+// True if every texel has the same alpha
+static bool IsSolidAlpha(_In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor)
+{
+    for(size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        if (pColor[i].a != pColor[0].a)
+            return false;
+    }
+    return true;
+}
+
+// True if channels [first, first + count) of block b of a run are the same in every texel
+static bool IsSolidRunBlock(_In_ const BCBlockRun& run, _In_ size_t b, _In_ size_t first, _In_ size_t count)
+{
+    for(size_t c = first; c < first + count; ++c)
+    {
+        const uint8_t v = run.rgba[c][0][b];
+        for(size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            if (run.rgba[c][i][b] != v)
+                return false;
+        }
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Block runs
+//-------------------------------------------------------------------------------------
+
+// Block b of a run as the per-block encoders take it.
+static void LoadRunBlock(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_ const BCBlockRun& run, _In_ size_t b)
+{
+    static const XMVECTORF32 s_Scale = { 1.f/255.f, 1.f/255.f, 1.f/255.f, 1.f/255.f };
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        XMVECTOR v = XMVectorSet( (float) run.rgba[0][i][b], (float) run.rgba[1][i][b], (float) run.rgba[2][i][b], (float) run.rgba[3][i][b] );
+        pColor[i] = XMVectorMultiply( v, s_Scale );
+    }
+}
+
+// Colors of blocks [b, b + count) of a run, 'stride' bytes apart from pBC. Blocks set in
+// 'skip' are left to the caller. Blocks of one RGB color come from the single-color tables,
+// and only the rest are packed into lanes of the SIMD endpoint search.
+inline static void EncodeRunColors(_Out_writes_bytes_(count * stride) uint8_t *pBC, _In_ size_t stride, _In_ const BCBlockRun& run,
+                                   _In_ size_t b, _In_ size_t count, _In_ uint32_t skip, _In_ DWORD flags)
+{
+    assert( b % BC_COLOR_BLOCKS == 0 && count <= BC_COLOR_BLOCKS );
+#ifdef _XM_SSE_INTRINSICS_
+    size_t lanes[BC_COLOR_BLOCKS];
+    size_t nLanes = 0;
+    for(size_t j = 0; j < count; ++j)
+    {
+        if (skip & (1u << j))
+            continue;
+
+        if (IsSolidRunBlock( run, b + j, 0, 3 ))
+            EncodeSolidColor( reinterpret_cast<D3DX_BC1 *>(pBC + j * stride), run.rgba[0][0][b + j], run.rgba[1][0][b + j], run.rgba[2][0][b + j] );
+        else
+            lanes[nLanes++] = j;
+    }
+
+    if (nLanes == count)
+    {
+        EncodeBC1ColorsSSE41( pBC, stride, &run.rgba[0][0][b], BC_RUN_BLOCKS, count, flags );
+    }
+    else if (nLanes > 0)
+    {
+        BCColorBlocks blocks;
+        memset( &blocks, 0, sizeof(blocks) );
+        for(size_t l = 0; l < nLanes; ++l)
+        {
+            for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                blocks.rgb[0][i][l] = run.rgba[0][i][b + lanes[l]];
+                blocks.rgb[1][i][l] = run.rgba[1][i][b + lanes[l]];
+                blocks.rgb[2][i][l] = run.rgba[2][i][b + lanes[l]];
+            }
+        }
+
+        D3DX_BC1 encoded[BC_COLOR_BLOCKS];
+        EncodeBC1ColorsSSE41( reinterpret_cast<uint8_t*>( encoded ), sizeof(D3DX_BC1), &blocks.rgb[0][0][0], BC_COLOR_BLOCKS, nLanes, flags );
+        for(size_t l = 0; l < nLanes; ++l)
+        {
+            memcpy( pBC + lanes[l] * stride, &encoded[l], sizeof(D3DX_BC1) );
+        }
+    }
+#else
+    UNREFERENCED_PARAMETER(pBC);
+    UNREFERENCED_PARAMETER(stride);
+    UNREFERENCED_PARAMETER(run);
+    UNREFERENCED_PARAMETER(b);
+    UNREFERENCED_PARAMETER(count);
+    UNREFERENCED_PARAMETER(skip);
+    UNREFERENCED_PARAMETER(flags);
+#endif
+}
+
+
+//=====================================================================================
+// Entry points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+// Solid blocks
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+bool D3DXIsSolidBlock(const XMVECTOR *pColor, size_t nChannels)
+{
+    assert( pColor && nChannels > 0 && nChannels <= 4 );
+
+    // Lanes past nChannels always compare equal
+    static const XMVECTORU32 s_Ignore[4] =
+    {
+        { 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF },
+        { 0x00000000, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF },
+        { 0x00000000, 0x00000000, 0x00000000, 0xFFFFFFFF },
+        { 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    };
+
+    for(size_t i = 1; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        XMVECTOR eq = XMVectorOrInt( XMVectorEqual( pColor[i], pColor[0] ), s_Ignore[nChannels - 1] );
+        if ( !XMVector4EqualInt( eq, XMVectorTrueInt() ) )
+            return false;
+    }
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC1 Compression
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void D3DXDecodeBC1(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
+    DecodeBC1( pColor, pBC1, true );
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC1ToRGBA8(uint8_t *pDest, size_t pitch, const uint8_t *pBC)
+{
+    assert( pDest && pBC );
+    DecodeBC1ToRGBA8( pDest, pitch, reinterpret_cast<const D3DX_BC1 *>(pBC), true, nullptr );
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float alphaRef, DWORD flags)
+{
+    assert( pBC && pColor );
+
+    if ( D3DXIsSolidBlock( pColor, 4 ) )
+    {
+        // Alpha dithering can still key out part of a solid block that is not fully opaque
+        float a = XMVectorGetW( pColor[0] );
+        if ( a >= 1.0f || ( a >= alphaRef && !(flags & BC_FLAGS_DITHER_A) ) )
+        {
+            HDRColorA color;
+            XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &color ), pColor[0] );
+            EncodeSolidColor( reinterpret_cast<D3DX_BC1 *>(pBC), color );
+            return;
+        }
+    }
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+
+    if (flags & BC_FLAGS_DITHER_A)
+    {
+        float fError[NUM_PIXELS_PER_BLOCK];
+        memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
+
+        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            HDRColorA clr;
+            XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &clr ), pColor[i] );
+
+            float fAlph = clr.a + fError[i];
+
+            Color[i].r = clr.r;
+            Color[i].g = clr.g;
+            Color[i].b = clr.b;
+            Color[i].a = (float) static_cast<int32_t>(clr.a + fError[i] + 0.5f);
+
+            float fDiff = fAlph - Color[i].a;
+
+            if(3 != (i & 3))
+            {
+                assert( i < 15 );
+                _Analysis_assume_( i < 15 );
+                fError[i + 1] += fDiff * (7.0f / 16.0f);
+            }
+
+            if(i < 12)
+            {
+                if(i & 3)
+                    fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                if(3 != (i & 3))
+                {
+                    assert( i < 11 );
+                    _Analysis_assume_( i < 11 );
+                    fError[i + 5] += fDiff * (1.0f / 16.0f);
+                }
+            }
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+        }
+    }
+
+    // Blocks with color-keyed texels need the 3-color mode of the reference encoder
+    bool bColorKey = false;
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        if(Color[i].a < alphaRef)
+            bColorKey = true;
+    }
+
+    auto pBC1 = reinterpret_cast<D3DX_BC1 *>(pBC);
+    if (bColorKey)
+        EncodeBC1(pBC1, Color, true, alphaRef, flags);
+    else
+        EncodeBC1Color(pBC1, Color, flags);
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC1Colors(uint8_t *pBC, size_t stride, const BCColorBlocks& blocks, size_t nBlocks, DWORD flags)
+{
+    assert( pBC && nBlocks > 0 && nBlocks <= BC_COLOR_BLOCKS && stride >= sizeof(D3DX_BC1) );
+
+#ifdef _XM_SSE_INTRINSICS_
+    if ( UseSIMDColors( flags ) )
+    {
+        EncodeBC1ColorsSSE41( pBC, stride, &blocks.rgb[0][0][0], BC_COLOR_BLOCKS, nBlocks, flags );
+        return;
+    }
+#endif
+
+    for(size_t b = 0; b < nBlocks; ++b)
+    {
+        HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            Color[i].r = (float) blocks.rgb[0][i][b] * (1.0f / 255.0f);
+            Color[i].g = (float) blocks.rgb[1][i][b] * (1.0f / 255.0f);
+            Color[i].b = (float) blocks.rgb[2][i][b] * (1.0f / 255.0f);
+            Color[i].a = 1.0f;
+        }
+
+        EncodeBC1(reinterpret_cast<D3DX_BC1 *>(pBC + b * stride), Color, false, 0.f, flags);
+    }
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC1Run(uint8_t *pBC, const BCBlockRun& run, size_t nBlocks, float alphaRef, DWORD flags)
+{
+    assert( pBC && nBlocks > 0 && nBlocks <= BC_RUN_BLOCKS );
+
+    // Alpha dithering moves the color key, so those blocks all go through D3DXEncodeBC1
+    const bool bSIMD = UseSIMDColors( flags ) && !(flags & BC_FLAGS_DITHER_A);
+
+    XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+    for(size_t b = 0; b < nBlocks; b += BC_COLOR_BLOCKS)
+    {
+        size_t count = std::min<size_t>( BC_COLOR_BLOCKS, nBlocks - b );
+
+        // Color keyed blocks need 3-color mode and are left out of the SIMD search
+        uint32_t keyed = 0;
+        for(size_t j = 0; j < count; ++j)
+        {
+            for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                if((float) run.rgba[3][i][b + j] * (1.0f / 255.0f) < alphaRef)
+                    keyed |= 1u << j;
+            }
+        }
+
+        if (bSIMD)
+            EncodeRunColors( pBC + b * sizeof(D3DX_BC1), sizeof(D3DX_BC1), run, b, count, keyed, flags );
+
+        for(size_t j = 0; j < count; ++j)
+        {
+            if (!bSIMD || (keyed & (1u << j)))
+            {
+                LoadRunBlock( temp, run, b + j );
+                D3DXEncodeBC1( pBC + (b + j) * sizeof(D3DX_BC1), temp, alphaRef, flags );
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC2 Compression
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void D3DXDecodeBC2(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    // RGB part
+    DecodeBC1(pColor, &pBC2->bc1, false);
+
+    // 4-bit alpha part
+    DWORD dw = pBC2->bitmap[0];
+
+    for(size_t i = 0; i < 8; ++i, dw >>= 4)
+    {
+        #pragma prefast(suppress:22103, "writing blocks in two halves confuses tool")
+        pColor[i] = XMVectorSetW( pColor[i], (float) (dw & 0xf) * (1.0f / 15.0f) );
+    }
+
+    dw = pBC2->bitmap[1];
+
+    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 4)
+        pColor[i] = XMVectorSetW( pColor[i], (float) (dw & 0xf) * (1.0f / 15.0f) );
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC2ToRGBA8(uint8_t *pDest, size_t pitch, const uint8_t *pBC)
+{
+    assert( pDest && pBC );
+    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    // 4-bit alpha part: 15 -> 255 is exactly x17
+    uint8_t alpha[NUM_PIXELS_PER_BLOCK];
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        alpha[i] = static_cast<uint8_t>( ( ( pBC2->bitmap[i >> 3] >> ( (i & 7) * 4 ) ) & 0xF ) * 17 );
+    }
+
+    DecodeBC1ToRGBA8( pDest, pitch, &pBC2->bc1, false, alpha );
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
+{
+    assert( pBC && pColor );
+    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+    }
+
+    auto pBC2 = reinterpret_cast<D3DX_BC2 *>(pBC);
+
+    // 4-bit alpha part.  Dithered using Floyd Stienberg error diffusion.
+    pBC2->bitmap[0] = 0;
+    pBC2->bitmap[1] = 0;
+
+    float fError[NUM_PIXELS_PER_BLOCK];
+    if (flags & BC_FLAGS_DITHER_A)
+        memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        float fAlph = Color[i].a;
+        if (flags & BC_FLAGS_DITHER_A)
+            fAlph += fError[i];
+
+        uint32_t u = (uint32_t) static_cast<int32_t>(fAlph * 15.0f + 0.5f);
+
+        pBC2->bitmap[i >> 3] >>= 4;
+        pBC2->bitmap[i >> 3] |= (u << 28);
+
+        if (flags & BC_FLAGS_DITHER_A)
+        {     
+            float fDiff = fAlph - (float) u * (1.0f / 15.0f);
+
+            if(3 != (i & 3))
+            {
+                assert( i < 15 );
+                _Analysis_assume_( i < 15 );
+                fError[i + 1] += fDiff * (7.0f / 16.0f);
+            }
+
+            if(i < 12)
+            {
+                if(i & 3)
+                    fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                if(3 != (i & 3))
+                {
+                    assert( i < 11 );
+                    _Analysis_assume_( i < 11 );
+                    fError[i + 5] += fDiff * (1.0f / 16.0f);
+                }
+            }
+        }
+    }
+
+    // RGB part
+#ifdef COLOR_WEIGHTS
+    if(!pBC2->bitmap[0] && !pBC2->bitmap[1])
+    {
+        EncodeSolidBC1(pBC2->dxt1, Color);
+        return;
+    }
+#endif // COLOR_WEIGHTS
+
+    if ( D3DXIsSolidBlock( pColor, 3 ) )
+        EncodeSolidColor(&pBC2->bc1, Color[0]);
+    else
+        EncodeBC1Color(&pBC2->bc1, Color, flags);
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC2Run(uint8_t *pBC, const BCBlockRun& run, size_t nBlocks, float alphaRef, DWORD flags)
+{
+    UNREFERENCED_PARAMETER(alphaRef);
+    assert( pBC && nBlocks > 0 && nBlocks <= BC_RUN_BLOCKS );
+
+    if ( !UseSIMDColors( flags ) || (flags & BC_FLAGS_DITHER_A) )
+    {
+        XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+        for(size_t b = 0; b < nBlocks; ++b)
+        {
+            LoadRunBlock( temp, run, b );
+            D3DXEncodeBC2( pBC + b * sizeof(D3DX_BC2), temp, flags );
+        }
+        return;
+    }
+
+    for(size_t b = 0; b < nBlocks; b += BC_COLOR_BLOCKS)
+    {
+        size_t count = std::min<size_t>( BC_COLOR_BLOCKS, nBlocks - b );
+        EncodeRunColors( pBC + b * sizeof(D3DX_BC2) + offsetof(D3DX_BC2, bc1), sizeof(D3DX_BC2), run, b, count, 0, flags );
+    }
+
+    // 4-bit alpha part: round( a * 15 / 255 )
+    for(size_t b = 0; b < nBlocks; ++b)
+    {
+        auto pBC2 = reinterpret_cast<D3DX_BC2 *>(pBC + b * sizeof(D3DX_BC2));
+        pBC2->bitmap[0] = 0;
+        pBC2->bitmap[1] = 0;
+        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            uint32_t u = (run.rgba[3][i][b] * 30 + 255) / 510;
+            pBC2->bitmap[i >> 3] |= u << ((i & 7) * 4);
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC3 Compression
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
+
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    // RGB part
+    DecodeBC1(pColor, &pBC3->bc1, false);
+
+    // Adaptive 3-bit alpha part
+    float fAlpha[8];
+
+    fAlpha[0] = ((float) pBC3->alpha[0]) * (1.0f / 255.0f);
+    fAlpha[1] = ((float) pBC3->alpha[1]) * (1.0f / 255.0f);
+
+    if(pBC3->alpha[0] > pBC3->alpha[1]) 
+    {
+        for(size_t i = 1; i < 7; ++i)
+            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
+    }
+    else 
+    {
+        for(size_t i = 1; i < 5; ++i)
+            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
+
+        fAlpha[6] = 0.0f;
+        fAlpha[7] = 1.0f;
+    }
+
+    DWORD dw = pBC3->bitmap[0] | (pBC3->bitmap[1] << 8) | (pBC3->bitmap[2] << 16);
+
+    for(size_t i = 0; i < 8; ++i, dw >>= 3)
+        pColor[i] = XMVectorSetW( pColor[i], fAlpha[dw & 0x7] );
+
+    dw = pBC3->bitmap[3] | (pBC3->bitmap[4] << 8) | (pBC3->bitmap[5] << 16);
+
+    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
+        pColor[i] = XMVectorSetW( pColor[i], fAlpha[dw & 0x7] );
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC3ToRGBA8(uint8_t *pDest, size_t pitch, const uint8_t *pBC)
+{
+    assert( pDest && pBC );
+    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
+
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    // The alpha part has the layout of a BC4 block
+    uint8_t alpha[NUM_PIXELS_PER_BLOCK];
+    D3DXDecodeBC4Values( alpha, pBC, false );
+
+    DecodeBC1ToRGBA8( pDest, pitch, &pBC3->bc1, false, alpha );
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
+{
+    assert( pBC && pColor );
+    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+    }
+
+    auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
+
+    // RGB part
+    if ( D3DXIsSolidBlock( pColor, 3 ) )
+        EncodeSolidColor(&pBC3->bc1, Color[0]);
+    else
+        EncodeBC1Color(&pBC3->bc1, Color, flags);
+
+    // Alpha part
+    if ( IsSolidAlpha( Color ) )
+        EncodeSolidBC3Alpha(pBC3, FloatToByte( Color[0].a ));
+    else
+        EncodeBC3Alpha(pBC3, Color, flags);
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC3Run(uint8_t *pBC, const BCBlockRun& run, size_t nBlocks, float alphaRef, DWORD flags)
+{
+    UNREFERENCED_PARAMETER(alphaRef);
+    assert( pBC && nBlocks > 0 && nBlocks <= BC_RUN_BLOCKS );
+
+    if ( !UseSIMDColors( flags ) )
+    {
+        XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+        for(size_t b = 0; b < nBlocks; ++b)
+        {
+            LoadRunBlock( temp, run, b );
+            D3DXEncodeBC3( pBC + b * sizeof(D3DX_BC3), temp, flags );
+        }
+        return;
+    }
+
+    for(size_t b = 0; b < nBlocks; b += BC_COLOR_BLOCKS)
+    {
+        size_t count = std::min<size_t>( BC_COLOR_BLOCKS, nBlocks - b );
+        EncodeRunColors( pBC + b * sizeof(D3DX_BC3) + offsetof(D3DX_BC3, bc1), sizeof(D3DX_BC3), run, b, count, 0, flags );
+    }
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for(size_t b = 0; b < nBlocks; ++b)
+    {
+        auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC + b * sizeof(D3DX_BC3));
+        if (IsSolidRunBlock( run, b, 3, 1 ))
+        {
+            EncodeSolidBC3Alpha( pBC3, run.rgba[3][0][b] );
+            continue;
+        }
+
+        for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            Color[i] = HDRColorA( 0.0f, 0.0f, 0.0f, (float) run.rgba[3][i][b] * (1.0f / 255.0f) );
+        }
+
+        EncodeBC3Alpha( pBC3, Color, flags );
+    }
+}
+
 } // namespace
@@ -60,6 +60,10 @@ enum BC_FLAGS
     BC_FLAGS_DITHER_A   = 0x20000,  // Enables dithering for Alpha channel for BC1-3
     BC_FLAGS_UNIFORM    = 0x40000,  // By default, uses perceptual weighting for BC1-3; this flag makes it a uniform weighting
     BC_FLAGS_USE_3SUBSETS = 0x80000,// By default, BC7 skips mode 0 & 2; this flag adds those modes back
+    BC_FLAGS_QUALITY_FAST   = 0x100000, // BC1-3 colors use the SIMD encoder, bounding box range fit only
+    BC_FLAGS_QUALITY_NORMAL = 0x200000, // BC1-3 colors use the SIMD encoder, principal axis fit and one refinement pass
+    BC_FLAGS_QUALITY_HIGH   = 0x300000, // BC1-3 colors use the SIMD encoder, best of range fit, principal axis and two refinement passes
+    BC_FLAGS_QUALITY_MASK   = 0x300000, // None set: BC1-3 colors use the reference encoder (OptimizeRGB)
 };
 
 //-------------------------------------------------------------------------------------
@@ -301,6 +305,24 @@ struct D3DX_BC3
 };
 #pragma pack(pop)
 
+// Texels of up to BC_COLOR_BLOCKS blocks for the SIMD color encoder, in structure-of-arrays
+// order so that one texel of every block loads as a single vector.
+const size_t BC_COLOR_BLOCKS = 4;
+
+struct BCColorBlocks
+{
+    uint8_t     rgb[3][NUM_PIXELS_PER_BLOCK][BC_COLOR_BLOCKS];  // [channel][texel][block], 0-255
+};
+
+// A run of horizontally adjacent blocks for the batched encoders, 8-bit RGBA in the same
+// structure-of-arrays order. Must be a multiple of BC_COLOR_BLOCKS.
+const size_t BC_RUN_BLOCKS = 16;
+
+struct BCBlockRun
+{
+    uint8_t     rgba[4][NUM_PIXELS_PER_BLOCK][BC_RUN_BLOCKS];   // [channel][texel][block], 0-255
+};
+
 class INTColor
 {
 public:
@@ -861,8 +883,14 @@ template <bool bRange> void OptimizeAlpha(float *pX, float *pY, const float *pPo
 // Functions
 //-------------------------------------------------------------------------------------
 
+#ifdef _XM_SSE_INTRINSICS_
+bool HasSSE41();
+    // SSE4.1 (and so SSSE3) support of the CPU, checked once
+#endif
+
 typedef void (*BC_DECODE)(XMVECTOR *pColor, const uint8_t *pBC);
 typedef void (*BC_ENCODE)(uint8_t *pDXT, const XMVECTOR *pColor, DWORD flags);
+typedef void (*BC_ENCODE_RUN)(uint8_t *pDXT, const BCBlockRun& run, size_t nBlocks, float alphaRef, DWORD flags);
 
 void D3DXDecodeBC1(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(8) const uint8_t *pBC);
 void D3DXDecodeBC2(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
@@ -875,9 +903,37 @@ void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_re
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 
+typedef void (*BC_DECODE_8)(uint8_t *pDest, size_t pitch, const uint8_t *pBC);
+
+void D3DXDecodeBC1ToRGBA8(_Out_writes_bytes_(pitch * 3 + 16) uint8_t *pDest, _In_ size_t pitch, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC2ToRGBA8(_Out_writes_bytes_(pitch * 3 + 16) uint8_t *pDest, _In_ size_t pitch, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC3ToRGBA8(_Out_writes_bytes_(pitch * 3 + 16) uint8_t *pDest, _In_ size_t pitch, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC4UToR8(_Out_writes_bytes_(pitch * 3 + 4) uint8_t *pDest, _In_ size_t pitch, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC4SToR8(_Out_writes_bytes_(pitch * 3 + 4) uint8_t *pDest, _In_ size_t pitch, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC5UToRG8(_Out_writes_bytes_(pitch * 3 + 8) uint8_t *pDest, _In_ size_t pitch, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC5SToRG8(_Out_writes_bytes_(pitch * 3 + 8) uint8_t *pDest, _In_ size_t pitch, _In_reads_(16) const uint8_t *pBC);
+    // 8-bit decoders: one whole block into four rows 'pitch' bytes apart, as R8G8B8A8_UNORM (BC1-3),
+    // R8_UNORM / R8_SNORM (BC4) or R8G8_UNORM / R8G8_SNORM (BC5). Interpolated values are rounded to nearest
+
+void D3DXDecodeBC4Values(_Out_writes_(NUM_PIXELS_PER_BLOCK) uint8_t *pValues, _In_reads_(8) const uint8_t *pBC, _In_ bool isSigned);
+    // The 16 values of a BC4 block (or BC3 alpha block) in texel order; signed values as two's complement bytes
+
+bool D3DXIsSolidBlock(_In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ size_t nChannels);
+    // True if the first nChannels channels are the same in all texels. The encoders check this themselves
+    // and encode such blocks from single-color tables (BC1-3, BC7) or exact endpoints (BC4, BC5)
+
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ float alphaRef, _In_ DWORD flags);
     // BC1 requires one additional parameter, so it doesn't match signature of BC_ENCODE above
 
+void D3DXEncodeBC1Colors(_Out_writes_bytes_(nBlocks * stride) uint8_t *pBC, _In_ size_t stride, _In_ const BCColorBlocks& blocks, _In_ size_t nBlocks, _In_ DWORD flags);
+    // Opaque 4-color BC1 encode of the first nBlocks (up to BC_COLOR_BLOCKS) blocks, written 'stride' bytes apart
+    // (8 for BC1, 16 with pBC at the color half for BC2/BC3). Uses the SIMD encoder for the BC_FLAGS_QUALITY_* tier in flags
+
+void D3DXEncodeBC1Run(_Out_writes_bytes_(nBlocks * 8) uint8_t *pBC, _In_ const BCBlockRun& run, _In_ size_t nBlocks, _In_ float alphaRef, _In_ DWORD flags);
+void D3DXEncodeBC2Run(_Out_writes_bytes_(nBlocks * 16) uint8_t *pBC, _In_ const BCBlockRun& run, _In_ size_t nBlocks, _In_ float alphaRef, _In_ DWORD flags);
+void D3DXEncodeBC3Run(_Out_writes_bytes_(nBlocks * 16) uint8_t *pBC, _In_ const BCBlockRun& run, _In_ size_t nBlocks, _In_ float alphaRef, _In_ DWORD flags);
+    // Batched encoders: the first nBlocks blocks of the run, written consecutively. alphaRef is only used by BC1
+
 void D3DXEncodeBC2(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 void D3DXEncodeBC3(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 void D3DXEncodeBC4U(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
@@ -181,6 +181,51 @@ static void inline FloatToSNorm( _In_ float fVal, _Out_ int8_t *piSNorm )
     *piSNorm = (int8_t) (fVal);
 }
 
+//-------------------------------------------------------------------------------------
+// Convert a floating point value to an 8-bit UNORM
+//-------------------------------------------------------------------------------------
+static void inline FloatToUNorm( _In_ float fVal, _Out_ uint8_t *piUNorm )
+{
+    if( _isnan( fVal ) )
+        fVal = 0;
+    else
+        if( fVal > 1 )
+            fVal = 1;    // Clamp to 1
+        else
+            if( fVal < 0 )
+                fVal = 0;    // Clamp to 0
+
+    *piUNorm = (uint8_t) (fVal * 255.0f + .5f);
+}
+
+
+//------------------------------------------------------------------------------
+// Solid channels: both endpoints exact and every index 0
+//------------------------------------------------------------------------------
+static bool IsSolidChannel( _In_reads_(BLOCK_SIZE) const float theTexels[] )
+{
+    for (size_t i = 1; i < BLOCK_SIZE; ++i)
+    {
+        if (theTexels[i] != theTexels[0])
+            return false;
+    }
+    return true;
+}
+
+static void EncodeSolidUNORM( _Out_ BC4_UNORM* pBC, _In_ float fVal )
+{
+    pBC->data = 0;
+    FloatToUNorm(fVal, &pBC->red_0);
+    pBC->red_1 = pBC->red_0;
+}
+
+static void EncodeSolidSNORM( _Out_ BC4_SNORM* pBC, _In_ float fVal )
+{
+    pBC->data = 0;
+    FloatToSNorm(fVal, &pBC->red_0);
+    pBC->red_1 = pBC->red_0;
+}
+
 
 //------------------------------------------------------------------------------
 static void FindEndPointsBC4U( _In_reads_(BLOCK_SIZE) const float theTexelsU[], _Out_ uint8_t &endpointU_0, _Out_ uint8_t &endpointU_1)
@@ -292,24 +337,6 @@ static void FindEndPointsBC4S(_In_reads_(BLOCK_SIZE) const float theTexelsU[], _
 }
 
 
-//------------------------------------------------------------------------------
-static inline void FindEndPointsBC5U( _In_reads_(BLOCK_SIZE) const float theTexelsU[], _In_reads_(BLOCK_SIZE) const float theTexelsV[],
-                                      _Out_ uint8_t &endpointU_0, _Out_ uint8_t &endpointU_1, _Out_ uint8_t &endpointV_0, _Out_ uint8_t &endpointV_1)
-{
-    //Encoding the U and V channel by BC4 codec separately.
-    FindEndPointsBC4U( theTexelsU, endpointU_0, endpointU_1);
-    FindEndPointsBC4U( theTexelsV, endpointV_0, endpointV_1);
-}
-
-static inline void FindEndPointsBC5S( _In_reads_(BLOCK_SIZE) const float theTexelsU[], _In_reads_(BLOCK_SIZE) const float theTexelsV[],
-                                      _Out_ int8_t &endpointU_0, _Out_ int8_t &endpointU_1, _Out_ int8_t &endpointV_0, _Out_ int8_t &endpointV_1)
-{
-    //Encoding the U and V channel by BC4 codec separately.
-    FindEndPointsBC4S( theTexelsU, endpointU_0, endpointU_1);
-    FindEndPointsBC4S( theTexelsV, endpointV_0, endpointV_1);
-}
-
-
 //------------------------------------------------------------------------------
 static void FindClosestUNORM(_Inout_ BC4_UNORM* pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const float theTexelsU[])
 {
@@ -362,6 +389,167 @@ static void FindClosestSNORM(_Inout_ BC4_SNORM* pBC, _In_reads_(NUM_PIXELS_PER_B
 }
 
 
+//------------------------------------------------------------------------------------
+// 8-bit decoding
+//------------------------------------------------------------------------------------
+
+// ( a0 * (d - i) + a1 * i ) / d rounded to nearest, halves away from zero
+inline static int LerpValue( _In_ int a0, _In_ int a1, _In_ int i, _In_ int d )
+{
+    int n = a0 * (d - i) + a1 * i;
+    return ( n >= 0 ) ? ( n + d / 2 ) / d : -( ( -n + d / 2 ) / d );
+}
+
+static void BC4Palette( _Out_writes_(8) uint8_t *pPalette, _In_reads_(2) const uint8_t *pBC, _In_ bool isSigned )
+{
+    int a0, a1, lo, hi;
+    bool eightValues;
+    if ( isSigned )
+    {
+        int8_t r0 = static_cast<int8_t>( pBC[0] );
+        int8_t r1 = static_cast<int8_t>( pBC[1] );
+        eightValues = ( r0 > r1 );
+        a0 = ( r0 == -128 ) ? -127 : r0;
+        a1 = ( r1 == -128 ) ? -127 : r1;
+        lo = -127;
+        hi = 127;
+    }
+    else
+    {
+        eightValues = ( pBC[0] > pBC[1] );
+        a0 = pBC[0];
+        a1 = pBC[1];
+        lo = 0;
+        hi = 255;
+    }
+
+    pPalette[0] = static_cast<uint8_t>( a0 );
+    pPalette[1] = static_cast<uint8_t>( a1 );
+    if ( eightValues )
+    {
+        for( int i = 1; i < 7; ++i )
+            pPalette[i + 1] = static_cast<uint8_t>( LerpValue( a0, a1, i, 7 ) );
+    }
+    else
+    {
+        for( int i = 1; i < 5; ++i )
+            pPalette[i + 1] = static_cast<uint8_t>( LerpValue( a0, a1, i, 5 ) );
+        pPalette[6] = static_cast<uint8_t>( lo );
+        pPalette[7] = static_cast<uint8_t>( hi );
+    }
+}
+
+#ifdef _XM_SSE_INTRINSICS_
+
+// Bytes holding the 3-bit index of texels 0-7 (texels 8-15 are 3 bytes on), the shift that
+// brings each index to bit 7 of its 16-bit lane, and the 3-bit mask.
+static const XMVECTORU32 g_IndexPairs[2] =
+{
+    { 0x01000100, 0x02010100, 0x02010201, 0x03020302 },
+    { 0x04030403, 0x05040403, 0x05040504, 0x06050605 },
+};
+static const XMVECTORU32 g_IndexShifts = { 0x00100080, 0x00400002, 0x00010008, 0x00040020 };
+static const XMVECTORU32 g_IndexMask = { 0x00070007, 0x00070007, 0x00070007, 0x00070007 };
+
+// The 48 bits of 3-bit indices at pIndices as 16 bytes
+inline static __m128i UnpackIndices( _In_reads_(6) const uint8_t *pIndices )
+{
+    uint64_t bits = 0;
+    memcpy( &bits, pIndices, 6 );
+    __m128i v = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( &bits ) );
+
+    __m128i lo = _mm_shuffle_epi8( v, _mm_castps_si128( g_IndexPairs[0] ) );
+    __m128i hi = _mm_shuffle_epi8( v, _mm_castps_si128( g_IndexPairs[1] ) );
+    lo = _mm_srli_epi16( _mm_mullo_epi16( lo, _mm_castps_si128( g_IndexShifts ) ), 7 );
+    hi = _mm_srli_epi16( _mm_mullo_epi16( hi, _mm_castps_si128( g_IndexShifts ) ), 7 );
+    lo = _mm_and_si128( lo, _mm_castps_si128( g_IndexMask ) );
+    hi = _mm_and_si128( hi, _mm_castps_si128( g_IndexMask ) );
+    return _mm_packus_epi16( lo, hi );
+}
+
+// Palette weights of red_1 (red_0 gets d - w) for the 8- and 6-value modes, and 2^16 / d rounded up:
+// the interpolants never exceed 16 bits, so the high half of the product is the exact quotient.
+static const XMVECTORU32 g_Weights7 = { 0x00070000, 0x00020001, 0x00040003, 0x00060005 };
+static const XMVECTORU32 g_Weights5 = { 0x00050000, 0x00020001, 0x00040003, 0x00000000 };
+static const XMVECTORU32 g_Divide7 = { 0x24932493, 0x24932493, 0x24932493, 0x24932493 };
+static const XMVECTORU32 g_Divide5 = { 0x33343334, 0x33343334, 0x33343334, 0x33343334 };
+
+// BC4Palette in 16-bit lanes. Signed endpoints are biased by 127, which leaves the rounding
+// unchanged since d is odd, and the bias is taken off the bytes at the end.
+inline static __m128i BC4PaletteSSE( _In_reads_(2) const uint8_t *pBC, _In_ bool isSigned )
+{
+    int a0, a1;
+    bool eightValues;
+    if ( isSigned )
+    {
+        int8_t r0 = static_cast<int8_t>( pBC[0] );
+        int8_t r1 = static_cast<int8_t>( pBC[1] );
+        eightValues = ( r0 > r1 );
+        a0 = ( ( r0 == -128 ) ? -127 : r0 ) + 127;
+        a1 = ( ( r1 == -128 ) ? -127 : r1 ) + 127;
+    }
+    else
+    {
+        eightValues = ( pBC[0] > pBC[1] );
+        a0 = pBC[0];
+        a1 = pBC[1];
+    }
+
+    const int d = eightValues ? 7 : 5;
+    __m128i w1 = _mm_castps_si128( eightValues ? g_Weights7 : g_Weights5 );
+    __m128i w0 = _mm_sub_epi16( _mm_set1_epi16( static_cast<short>( d ) ), w1 );
+    __m128i n = _mm_add_epi16( _mm_mullo_epi16( _mm_set1_epi16( static_cast<short>( a0 ) ), w0 ),
+                               _mm_mullo_epi16( _mm_set1_epi16( static_cast<short>( a1 ) ), w1 ) );
+    n = _mm_add_epi16( n, _mm_set1_epi16( static_cast<short>( d / 2 ) ) );
+    __m128i v = _mm_mulhi_epu16( n, _mm_castps_si128( eightValues ? g_Divide7 : g_Divide5 ) );
+
+    if ( !eightValues )
+    {
+        // Biased -1 / 1 for SNORM, 0 / 1 for UNORM
+        v = _mm_insert_epi16( v, 0, 6 );
+        v = _mm_insert_epi16( v, isSigned ? 254 : 255, 7 );
+    }
+
+    v = _mm_packus_epi16( v, v );
+    return ( isSigned ) ? _mm_sub_epi8( v, _mm_set1_epi8( 127 ) ) : v;
+}
+
+#endif // _XM_SSE_INTRINSICS_
+
+// Copies 16 values in texel order to four rows of 'pitch' bytes
+inline static void StoreValueRows( _Out_writes_bytes_(pitch * 3 + 4) uint8_t *pDest, _In_ size_t pitch, _In_reads_(NUM_PIXELS_PER_BLOCK) const uint8_t *pValues )
+{
+    for( size_t row = 0; row < 4; ++row )
+        memcpy( pDest + row * pitch, pValues + row * 4, 4 );
+}
+
+static void DecodeBC5ToRG8( _Out_writes_bytes_(pitch * 3 + 8) uint8_t *pDest, _In_ size_t pitch, _In_reads_(16) const uint8_t *pBC, _In_ bool isSigned )
+{
+    uint8_t red[NUM_PIXELS_PER_BLOCK];
+    uint8_t green[NUM_PIXELS_PER_BLOCK];
+    D3DXDecodeBC4Values( red, pBC, isSigned );
+    D3DXDecodeBC4Values( green, pBC + sizeof(BC4_UNORM), isSigned );
+
+#ifdef _XM_SSE_INTRINSICS_
+    __m128i r = _mm_loadu_si128( reinterpret_cast<const __m128i*>( red ) );
+    __m128i g = _mm_loadu_si128( reinterpret_cast<const __m128i*>( green ) );
+    __m128i rg01 = _mm_unpacklo_epi8( r, g );
+    __m128i rg23 = _mm_unpackhi_epi8( r, g );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( pDest ), rg01 );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( pDest + pitch ), _mm_srli_si128( rg01, 8 ) );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( pDest + pitch * 2 ), rg23 );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( pDest + pitch * 3 ), _mm_srli_si128( rg23, 8 ) );
+#else
+    for( size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i )
+    {
+        uint8_t *dptr = pDest + ( i >> 2 ) * pitch + ( i & 3 ) * 2;
+        dptr[0] = red[i];
+        dptr[1] = green[i];
+    }
+#endif
+}
+
+
 //=====================================================================================
 // Entry points
 //=====================================================================================
@@ -399,6 +587,51 @@ void D3DXDecodeBC4S(XMVECTOR *pColor, const uint8_t *pBC)
     }       
 }
 
+_Use_decl_annotations_
+void D3DXDecodeBC4Values( uint8_t *pValues, const uint8_t *pBC, bool isSigned )
+{
+    assert( pValues && pBC );
+
+#ifdef _XM_SSE_INTRINSICS_
+    if ( HasSSE41() )
+    {
+        __m128i v = _mm_shuffle_epi8( BC4PaletteSSE( pBC, isSigned ), UnpackIndices( pBC + 2 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pValues ), v );
+        return;
+    }
+#endif
+
+    uint8_t palette[8];
+    BC4Palette( palette, pBC, isSigned );
+
+    uint64_t bits = 0;
+    memcpy( &bits, pBC + 2, 6 );
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, bits >>= 3)
+    {
+        pValues[i] = palette[ bits & 0x7 ];
+    }
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC4UToR8( uint8_t *pDest, size_t pitch, const uint8_t *pBC )
+{
+    assert( pDest && pBC );
+
+    uint8_t values[NUM_PIXELS_PER_BLOCK];
+    D3DXDecodeBC4Values( values, pBC, false );
+    StoreValueRows( pDest, pitch, values );
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC4SToR8( uint8_t *pDest, size_t pitch, const uint8_t *pBC )
+{
+    assert( pDest && pBC );
+
+    uint8_t values[NUM_PIXELS_PER_BLOCK];
+    D3DXDecodeBC4Values( values, pBC, true );
+    StoreValueRows( pDest, pitch, values );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC4U( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
 {
@@ -416,6 +649,12 @@ void D3DXEncodeBC4U( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
         theTexelsU[i] = XMVectorGetX( pColor[i] );
     }
 
+    if (IsSolidChannel(theTexelsU))
+    {
+        EncodeSolidUNORM(pBC4, theTexelsU[0]);
+        return;
+    }
+
     FindEndPointsBC4U(theTexelsU, pBC4->red_0, pBC4->red_1);
     FindClosestUNORM(pBC4, theTexelsU);
 }
@@ -437,6 +676,12 @@ void D3DXEncodeBC4S( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
         theTexelsU[i] = XMVectorGetX( pColor[i] );
     }
 
+    if (IsSolidChannel(theTexelsU))
+    {
+        EncodeSolidSNORM(pBC4, theTexelsU[0]);
+        return;
+    }
+
     FindEndPointsBC4S(theTexelsU, pBC4->red_0, pBC4->red_1);
     FindClosestSNORM(pBC4, theTexelsU);
 }
@@ -477,6 +722,20 @@ void D3DXDecodeBC5S(XMVECTOR *pColor, const uint8_t *pBC)
     }       
 }
 
+_Use_decl_annotations_
+void D3DXDecodeBC5UToRG8( uint8_t *pDest, size_t pitch, const uint8_t *pBC )
+{
+    assert( pDest && pBC );
+    DecodeBC5ToRG8( pDest, pitch, pBC, false );
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC5SToRG8( uint8_t *pDest, size_t pitch, const uint8_t *pBC )
+{
+    assert( pDest && pBC );
+    DecodeBC5ToRG8( pDest, pitch, pBC, true );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC5U( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
 {
@@ -499,16 +758,22 @@ void D3DXEncodeBC5U( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
         theTexelsV[i] = clr.y;
     }
 
-    FindEndPointsBC5U(
-        theTexelsU,
-        theTexelsV,
-        pBCR->red_0,
-        pBCR->red_1,
-        pBCG->red_0,
-        pBCG->red_1);
+    // The channels are coded independently, so a solid one takes the exact path on its own
+    if (IsSolidChannel(theTexelsU))
+        EncodeSolidUNORM(pBCR, theTexelsU[0]);
+    else
+    {
+        FindEndPointsBC4U(theTexelsU, pBCR->red_0, pBCR->red_1);
+        FindClosestUNORM(pBCR, theTexelsU);
+    }
 
-    FindClosestUNORM(pBCR, theTexelsU);
-    FindClosestUNORM(pBCG, theTexelsV);
+    if (IsSolidChannel(theTexelsV))
+        EncodeSolidUNORM(pBCG, theTexelsV[0]);
+    else
+    {
+        FindEndPointsBC4U(theTexelsV, pBCG->red_0, pBCG->red_1);
+        FindClosestUNORM(pBCG, theTexelsV);
+    }
 }
 
 _Use_decl_annotations_
@@ -533,16 +798,22 @@ void D3DXEncodeBC5S( uint8_t *pBC, const XMVECTOR *pColor, DWORD flags )
         theTexelsV[i] = clr.y;
     }
 
-    FindEndPointsBC5S(
-        theTexelsU,
-        theTexelsV,
-        pBCR->red_0,
-        pBCR->red_1,
-        pBCG->red_0,
-        pBCG->red_1);
+    // The channels are coded independently, so a solid one takes the exact path on its own
+    if (IsSolidChannel(theTexelsU))
+        EncodeSolidSNORM(pBCR, theTexelsU[0]);
+    else
+    {
+        FindEndPointsBC4S(theTexelsU, pBCR->red_0, pBCR->red_1);
+        FindClosestSNORM(pBCR, theTexelsU);
+    }
 
-    FindClosestSNORM(pBCR, theTexelsU);
-    FindClosestSNORM(pBCG, theTexelsV);
+    if (IsSolidChannel(theTexelsV))
+        EncodeSolidSNORM(pBCG, theTexelsV[0]);
+    else
+    {
+        FindEndPointsBC4S(theTexelsV, pBCG->red_0, pBCG->red_1);
+        FindClosestSNORM(pBCG, theTexelsV);
+    }
 }
 
 } // namespace
@@ -2852,6 +2852,74 @@ void D3DXEncodeBC6HS(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 }
 
 
+//-------------------------------------------------------------------------------------
+// BC7 solid blocks
+//-------------------------------------------------------------------------------------
+
+// Mode 5 endpoint pairs (7 bits, lo/hi) whose index 1 interpolant is exactly the 8-bit value
+static const uint8_t g_SolidBC7[256][2] =
+{
+    {   0,   0 }, {   0,   1 }, {   0,   3 }, {   0,   4 }, {   0,   6 }, {   0,   7 }, {   0,   9 }, {   0,  10 },
+    {   0,  12 }, {   0,  13 }, {   0,  15 }, {   0,  16 }, {   0,  18 }, {   0,  20 }, {   0,  21 }, {   0,  23 },
+    {   0,  24 }, {   0,  26 }, {   0,  27 }, {   0,  29 }, {   0,  30 }, {   0,  32 }, {   0,  33 }, {   0,  35 },
+    {   0,  36 }, {   0,  38 }, {   0,  39 }, {   0,  41 }, {   0,  42 }, {   0,  44 }, {   0,  45 }, {   0,  47 },
+    {   0,  48 }, {   0,  50 }, {   0,  52 }, {   0,  53 }, {   0,  55 }, {   0,  56 }, {   0,  58 }, {   0,  59 },
+    {   0,  61 }, {   0,  62 }, {   0,  64 }, {   0,  65 }, {   0,  66 }, {   0,  68 }, {   0,  69 }, {   0,  71 },
+    {   0,  72 }, {   0,  74 }, {   0,  75 }, {   0,  77 }, {   0,  78 }, {   0,  80 }, {   0,  82 }, {   0,  83 },
+    {   0,  85 }, {   0,  86 }, {   0,  88 }, {   0,  89 }, {   0,  91 }, {   0,  92 }, {   0,  94 }, {   0,  95 },
+    {   0,  97 }, {   0,  98 }, {   0, 100 }, {   0, 101 }, {   0, 103 }, {   0, 104 }, {   0, 106 }, {   0, 107 },
+    {   0, 109 }, {   0, 110 }, {   0, 112 }, {   0, 114 }, {   0, 115 }, {   0, 117 }, {   0, 118 }, {   0, 120 },
+    {   0, 121 }, {   0, 123 }, {   0, 124 }, {   0, 126 }, {   0, 127 }, {   1, 127 }, {   2, 126 }, {   3, 126 },
+    {   3, 127 }, {   4, 127 }, {   5, 126 }, {   6, 126 }, {   6, 127 }, {   7, 127 }, {   8, 126 }, {   9, 126 },
+    {   9, 127 }, {  10, 127 }, {  11, 126 }, {  12, 126 }, {  12, 127 }, {  13, 127 }, {  14, 126 }, {  15, 125 },
+    {  15, 127 }, {  16, 126 }, {  17, 126 }, {  17, 127 }, {  18, 127 }, {  19, 126 }, {  20, 126 }, {  20, 127 },
+    {  21, 127 }, {  22, 126 }, {  23, 126 }, {  23, 127 }, {  24, 127 }, {  25, 126 }, {  26, 126 }, {  26, 127 },
+    {  27, 127 }, {  28, 126 }, {  29, 126 }, {  29, 127 }, {  30, 127 }, {  31, 126 }, {  32, 126 }, {  32, 127 },
+    {  33, 127 }, {  34, 126 }, {  35, 126 }, {  35, 127 }, {  36, 127 }, {  37, 126 }, {  38, 126 }, {  38, 127 },
+    {  39, 127 }, {  40, 126 }, {  41, 126 }, {  41, 127 }, {  42, 127 }, {  43, 126 }, {  44, 126 }, {  44, 127 },
+    {  45, 127 }, {  46, 126 }, {  47, 125 }, {  47, 127 }, {  48, 126 }, {  49, 126 }, {  49, 127 }, {  50, 127 },
+    {  51, 126 }, {  52, 126 }, {  52, 127 }, {  53, 127 }, {  54, 126 }, {  55, 126 }, {  55, 127 }, {  56, 127 },
+    {  57, 126 }, {  58, 126 }, {  58, 127 }, {  59, 127 }, {  60, 126 }, {  61, 126 }, {  61, 127 }, {  62, 127 },
+    {  63, 126 }, {  64, 125 }, {  64, 126 }, {  65, 126 }, {  65, 127 }, {  66, 127 }, {  67, 126 }, {  68, 126 },
+    {  68, 127 }, {  69, 127 }, {  70, 126 }, {  71, 126 }, {  71, 127 }, {  72, 127 }, {  73, 126 }, {  74, 126 },
+    {  74, 127 }, {  75, 127 }, {  76, 126 }, {  77, 125 }, {  77, 127 }, {  78, 126 }, {  79, 126 }, {  79, 127 },
+    {  80, 127 }, {  81, 126 }, {  82, 126 }, {  82, 127 }, {  83, 127 }, {  84, 126 }, {  85, 126 }, {  85, 127 },
+    {  86, 127 }, {  87, 126 }, {  88, 126 }, {  88, 127 }, {  89, 127 }, {  90, 126 }, {  91, 126 }, {  91, 127 },
+    {  92, 127 }, {  93, 126 }, {  94, 126 }, {  94, 127 }, {  95, 127 }, {  96, 126 }, {  97, 126 }, {  97, 127 },
+    {  98, 127 }, {  99, 126 }, { 100, 126 }, { 100, 127 }, { 101, 127 }, { 102, 126 }, { 103, 126 }, { 103, 127 },
+    { 104, 127 }, { 105, 126 }, { 106, 126 }, { 106, 127 }, { 107, 127 }, { 108, 126 }, { 109, 125 }, { 109, 127 },
+    { 110, 126 }, { 111, 126 }, { 111, 127 }, { 112, 127 }, { 113, 126 }, { 114, 126 }, { 114, 127 }, { 115, 127 },
+    { 116, 126 }, { 117, 126 }, { 117, 127 }, { 118, 127 }, { 119, 126 }, { 120, 126 }, { 120, 127 }, { 121, 127 },
+    { 122, 126 }, { 123, 126 }, { 123, 127 }, { 124, 127 }, { 125, 126 }, { 126, 126 }, { 126, 127 }, { 127, 127 },
+};
+
+// Mode 5 with the table endpoints for R, G and B at index 1 in every texel, and alpha as an
+// exact endpoint pair at index 0. The texel values are quantized the way D3DX_BC7::Encode does.
+static void EncodeSolidBC7(_Out_writes_bytes_(16) uint8_t *pBC, _In_ const HDRColorA& color)
+{
+    const uint8_t r = uint8_t( std::max<float>( 0.0f, std::min<float>( 255.0f, color.r * 255.0f + 0.01f ) ) );
+    const uint8_t g = uint8_t( std::max<float>( 0.0f, std::min<float>( 255.0f, color.g * 255.0f + 0.01f ) ) );
+    const uint8_t b = uint8_t( std::max<float>( 0.0f, std::min<float>( 255.0f, color.b * 255.0f + 0.01f ) ) );
+    const uint8_t a = uint8_t( std::max<float>( 0.0f, std::min<float>( 255.0f, color.a * 255.0f + 0.01f ) ) );
+
+    // Bits 0-5 mode, 6-7 rotation, 8-49 RGB endpoints, 50-65 alpha endpoints,
+    // 66-96 color indices (1 bit for the anchor), 97-127 alpha indices.
+    uint64_t lo = 0x20;
+    lo |= uint64_t( g_SolidBC7[r][0] ) << 8;
+    lo |= uint64_t( g_SolidBC7[r][1] ) << 15;
+    lo |= uint64_t( g_SolidBC7[g][0] ) << 22;
+    lo |= uint64_t( g_SolidBC7[g][1] ) << 29;
+    lo |= uint64_t( g_SolidBC7[b][0] ) << 36;
+    lo |= uint64_t( g_SolidBC7[b][1] ) << 43;
+    lo |= uint64_t( a ) << 50;
+    lo |= uint64_t( a ) << 58;
+    uint64_t hi = uint64_t( a >> 6 ) | 0xAAAAAAACULL;
+
+    memcpy( pBC, &lo, sizeof(lo) );
+    memcpy( pBC + sizeof(lo), &hi, sizeof(hi) );
+}
+
+
 //-------------------------------------------------------------------------------------
 // BC7 Compression
 //-------------------------------------------------------------------------------------
@@ -2868,6 +2936,11 @@ void D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
     assert( pBC && pColor );
     static_assert( sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes" );
+    if ( D3DXIsSolidBlock( pColor, 4 ) )
+    {
+        EncodeSolidBC7( pBC, *reinterpret_cast<const HDRColorA*>(pColor) );
+        return;
+    }
     reinterpret_cast< D3DX_BC7* >( pBC )->Encode( !(flags& BC_FLAGS_USE_3SUBSETS), reinterpret_cast<const HDRColorA*>(pColor));
 }
 
@@ -185,6 +185,9 @@ namespace DirectX
         DDS_FLAGS_EXPAND_LUMINANCE      = 0x20,
             // When loading legacy luminance formats expand replicating the color channels rather than leaving them packed (L8, L16, A8L8)
 
+        DDS_FLAGS_SPLIT_ATI1            = 0x100,
+            // LoadFromSplitDDS: treat a 'DX10' header as legacy 'ATI1' (BC4_UNORM) with no extension header (Star Citizen mask alpha '.a' parts)
+
         DDS_FLAGS_FORCE_DX10_EXT        = 0x10000,
             // Always use the 'DX10' header extension for DDS writer (i.e. don't try to write DX9 compatible DDS files)
 
@@ -331,6 +334,27 @@ namespace DirectX
         Blob& operator=( const Blob& );
     };
 
+    //---------------------------------------------------------------------------------
+    // Image memory pool
+    //   ScratchImage and Blob take their memory from a process wide pool of size classes.
+    //   Buffers released by one conversion stage (or file) are handed to the next allocation
+    //   of the same class, so a chain of transforms ping-pongs between the same two buffers.
+
+    struct ImagePoolStats
+    {
+        size_t      hits;           // Allocations served from the pool
+        size_t      misses;         // Allocations that went to the heap
+        size_t      bytesInUse;     // Held by live ScratchImage / Blob objects
+        size_t      peakBytesInUse;
+        size_t      bytesCached;    // Free, kept for reuse
+        size_t      peakBytesCached;
+    };
+
+    void __cdecl GetImagePoolStats( _Out_ ImagePoolStats& stats );
+    void __cdecl SetImagePoolLimit( _In_ size_t maxCachedBytes );
+        // Free buffers beyond this total are returned to the heap (0 disables pooling)
+    void __cdecl TrimImagePool();
+
     //---------------------------------------------------------------------------------
     // Image I/O
 
@@ -340,6 +364,21 @@ namespace DirectX
     HRESULT __cdecl LoadFromDDSFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags,
                                      _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
 
+    HRESULT __cdecl LoadFromSplitDDS( _In_z_ LPCWSTR szHeaderFile, _In_reads_opt_(nParts) const LPCWSTR* szParts, _In_ size_t nParts, _In_ DWORD flags,
+                                      _Out_opt_ TexMetadata* metadata, _Out_ ScratchImage& image );
+        // Star Citizen split DDS: header fragment (.dds / .dds.0, "DDS " magic optional) plus mip parts ordered largest first (.dds.N ... .dds.1).
+        // The parts are read straight into the image; the small mips that follow the header in the header fragment are read last.
+
+    HRESULT __cdecl GetMetadataFromSplitDDS( _In_z_ LPCWSTR szHeaderFile, _In_ DWORD flags, _Out_ TexMetadata& metadata );
+        // Header of a split DDS header fragment, or of a whole DDS file
+
+    HRESULT __cdecl CopySplitDDSToMemory( _In_z_ LPCWSTR szHeaderFile, _In_reads_opt_(nParts) const LPCWSTR* szParts, _In_ size_t nParts, _In_ DWORD flags,
+                                          _In_ const TexMetadata& metadata, _In_ size_t firstItem, _In_ DWORD saveFlags, _Out_ Blob& blob );
+        // Writes a DDS holding the first metadata.mipLevels levels of items [firstItem, firstItem + metadata.arraySize) of a split
+        // (nParts > 0) or whole DDS, without loading or decoding it: the header is encoded for 'metadata' (DX10 / legacy per
+        // 'saveFlags', alpha mode) and the subresources are copied by byte range. Format and top level size must match the source.
+        // Returns HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED ) for sources that need converting on load (legacy expansion, swizzle).
+
     HRESULT __cdecl SaveToDDSMemory( _In_ const Image& image, _In_ DWORD flags,
                                      _Out_ Blob& blob );
     HRESULT __cdecl SaveToDDSMemory( _In_reads_(nimages) const Image* images, _In_ size_t nimages, _In_ const TexMetadata& metadata, _In_ DWORD flags,
@@ -514,6 +553,12 @@ namespace DirectX
         TEX_COMPRESS_BC7_USE_3SUBSETS = 0x80000,
             // Enables exhaustive search for BC7 compress for mode 0 and 2; by default skips trying these modes
 
+        TEX_COMPRESS_BC_FAST        = 0x100000,
+        TEX_COMPRESS_BC_NORMAL      = 0x200000,
+        TEX_COMPRESS_BC_HIGH        = 0x300000,
+            // BC1-3 colors use the SIMD encoder at this quality (range fit, principal axis + 1 refinement pass, best of both + 2 passes)
+            // By default uses the reference encoder
+
         TEX_COMPRESS_SRGB_IN        = 0x1000000,
         TEX_COMPRESS_SRGB_OUT       = 0x2000000,
         TEX_COMPRESS_SRGB           = ( TEX_COMPRESS_SRGB_IN | TEX_COMPRESS_SRGB_OUT ),
@@ -530,6 +575,17 @@ namespace DirectX
                               _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef, _Out_ ScratchImage& cImages );
         // Note that alphaRef is only used by BC1. 0.5f is a typical value to use
 
+    struct BCBlockStats
+    {
+        size_t      blocks;         // Blocks encoded by the CPU Compress, over all calls
+        size_t      solidBlocks;    // One color in every texel, encoded by the solid block paths
+        size_t      cachedBlocks;   // Copied from an identical earlier block of the same image
+    };
+
+    void __cdecl GetBCBlockStats( _Out_ BCBlockStats& stats );
+    void __cdecl GetThreadBCBlockStats( _Out_ BCBlockStats& stats );
+        // Only the Compress calls made from the calling thread (their parallel work included), to time a single call
+
     HRESULT __cdecl Compress( _In_ ID3D11Device* pDevice, _In_ const Image& srcImage, _In_ DXGI_FORMAT format, _In_ DWORD compress,
                               _In_ float alphaWeight, _Out_ ScratchImage& image );
     HRESULT __cdecl Compress( _In_ ID3D11Device* pDevice, _In_ const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
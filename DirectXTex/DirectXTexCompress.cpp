@@ -33,7 +33,10 @@ inline static DWORD _GetBCFlags( _In_ DWORD compress )
     static_assert( TEX_COMPRESS_DITHER == (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A), "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
     static_assert( TEX_COMPRESS_UNIFORM == BC_FLAGS_UNIFORM, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
     static_assert( TEX_COMPRESS_BC7_USE_3SUBSETS == BC_FLAGS_USE_3SUBSETS, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
-    return ( compress & (BC_FLAGS_DITHER_RGB|BC_FLAGS_DITHER_A|BC_FLAGS_UNIFORM|BC_FLAGS_USE_3SUBSETS) );
+    static_assert( TEX_COMPRESS_BC_FAST == BC_FLAGS_QUALITY_FAST, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
+    static_assert( TEX_COMPRESS_BC_NORMAL == BC_FLAGS_QUALITY_NORMAL, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
+    static_assert( TEX_COMPRESS_BC_HIGH == BC_FLAGS_QUALITY_HIGH, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
+    return ( compress & (BC_FLAGS_DITHER_RGB|BC_FLAGS_DITHER_A|BC_FLAGS_UNIFORM|BC_FLAGS_USE_3SUBSETS|BC_FLAGS_QUALITY_MASK) );
 }
 
 inline static DWORD _GetSRGBFlags( _In_ DWORD compress )
@@ -44,16 +47,19 @@ inline static DWORD _GetSRGBFlags( _In_ DWORD compress )
     return ( compress & TEX_COMPRESS_SRGB );
 }
 
-inline static bool _DetermineEncoderSettings( _In_ DXGI_FORMAT format, _Out_ BC_ENCODE& pfEncode, _Out_ size_t& blocksize, _Out_ DWORD& cflags )
+inline static bool _DetermineEncoderSettings( _In_ DXGI_FORMAT format, _Out_ BC_ENCODE& pfEncode, _Out_ BC_ENCODE_RUN& pfEncodeRun,
+                                              _Out_ size_t& blocksize, _Out_ DWORD& cflags )
 {
+    pfEncodeRun = nullptr;
+
     switch(format)
     {
     case DXGI_FORMAT_BC1_UNORM:
-    case DXGI_FORMAT_BC1_UNORM_SRGB:    pfEncode = nullptr;         blocksize = 8;   cflags = 0; break;
+    case DXGI_FORMAT_BC1_UNORM_SRGB:    pfEncode = nullptr;         blocksize = 8;   cflags = 0; pfEncodeRun = D3DXEncodeBC1Run; break;
     case DXGI_FORMAT_BC2_UNORM:
-    case DXGI_FORMAT_BC2_UNORM_SRGB:    pfEncode = D3DXEncodeBC2;   blocksize = 16;  cflags = 0; break;
+    case DXGI_FORMAT_BC2_UNORM_SRGB:    pfEncode = D3DXEncodeBC2;   blocksize = 16;  cflags = 0; pfEncodeRun = D3DXEncodeBC2Run; break;
     case DXGI_FORMAT_BC3_UNORM:
-    case DXGI_FORMAT_BC3_UNORM_SRGB:    pfEncode = D3DXEncodeBC3;   blocksize = 16;  cflags = 0; break;
+    case DXGI_FORMAT_BC3_UNORM_SRGB:    pfEncode = D3DXEncodeBC3;   blocksize = 16;  cflags = 0; pfEncodeRun = D3DXEncodeBC3Run; break;
     case DXGI_FORMAT_BC4_UNORM:         pfEncode = D3DXEncodeBC4U;  blocksize = 8;   cflags = TEX_FILTER_RGB_COPY_RED; break;
     case DXGI_FORMAT_BC4_SNORM:         pfEncode = D3DXEncodeBC4S;  blocksize = 8;   cflags = TEX_FILTER_RGB_COPY_RED; break;
     case DXGI_FORMAT_BC5_UNORM:         pfEncode = D3DXEncodeBC5U;  blocksize = 16;  cflags = TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN; break;
@@ -70,133 +76,403 @@ inline static bool _DetermineEncoderSettings( _In_ DXGI_FORMAT format, _Out_ BC_
 
 
 //-------------------------------------------------------------------------------------
-static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
-                            _In_ DWORD srgb, _In_ float alphaRef )
+// Partial blocks replicate texels 0, 0, 1 into the missing columns / rows 1-3
+//-------------------------------------------------------------------------------------
+inline static size_t _ReplicatedTexel( _In_ size_t s, _In_ size_t count )
 {
-    if ( !image.pixels || !result.pixels )
-        return E_POINTER;
+    static const size_t uSrc[] = { 0, 0, 0, 1 };
 
-    assert( image.width == result.width );
-    assert( image.height == result.height );
+    while ( s >= count )
+        s = uSrc[s];
+    return s;
+}
 
-    const DXGI_FORMAT format = image.format;
-    size_t sbpp = BitsPerPixel( format );
-    if ( !sbpp )
-        return E_FAIL;
 
-    if ( sbpp < 8 )
+//-------------------------------------------------------------------------------------
+// 8-bit RGBA sources the batched encoders read without _LoadScanline / _ConvertScanline
+//-------------------------------------------------------------------------------------
+static bool _CanGatherRun( _In_ DXGI_FORMAT format, _In_ DXGI_FORMAT bcformat, _In_ DWORD srgb )
+{
+    switch( format )
     {
-        // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
-        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        break;
+
+    default:
+        return false;
     }
 
-    // Round to bytes
-    sbpp = ( sbpp + 7 ) / 8;
+    // Texels are copied as is, so there must be no sRGB conversion between source and target
+    bool srgbIn = IsSRGB( format ) || ( srgb & TEX_FILTER_SRGB_IN );
+    bool srgbOut = IsSRGB( bcformat ) || ( srgb & TEX_FILTER_SRGB_OUT );
+    return ( srgbIn == srgbOut );
+}
 
-    uint8_t *pDest = result.pixels;
+static void _GatherRun( _In_ const Image& image, _In_ size_t y, _In_ size_t bx, _In_ size_t nBlocks, _Out_ BCBlockRun& run )
+{
+    size_t ir = 0;
+    size_t ib = 2;
+    bool opaque = false;
+    switch( image.format )
+    {
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        opaque = true;
+        // fall through
+
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        ir = 2;
+        ib = 0;
+        break;
+    }
 
-    // Determine BC format encoder
-    BC_ENCODE pfEncode;
-    size_t blocksize;
-    DWORD cflags;
-    if ( !_DetermineEncoderSettings( result.format, pfEncode, blocksize, cflags ) )
-        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    const size_t ph = std::min<size_t>( 4, image.height - y );
+    for( size_t t = 0; t < 4; ++t )
+    {
+        const uint8_t *pRow = image.pixels + ( y + _ReplicatedTexel( t, ph ) ) * image.rowPitch;
 
-    XMVECTOR temp[16];
-    const uint8_t *pSrc = image.pixels;
+        for( size_t b = 0; b < nBlocks; ++b )
+        {
+            const size_t x = ( bx + b ) * 4;
+            const size_t pw = std::min<size_t>( 4, image.width - x );
+            for( size_t s = 0; s < 4; ++s )
+            {
+                const uint8_t *sptr = pRow + ( x + _ReplicatedTexel( s, pw ) ) * 4;
+                const size_t i = ( t << 2 ) | s;
+                run.rgba[0][i][b] = sptr[ir];
+                run.rgba[1][i][b] = sptr[1];
+                run.rgba[2][i][b] = sptr[ib];
+                run.rgba[3][i][b] = ( opaque ) ? 255 : sptr[3];
+            }
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Loads and converts a whole row of blocks (4 scanlines padded to a multiple of 4 texels)
+//-------------------------------------------------------------------------------------
+static bool _LoadBlockRow( _In_ const Image& image, _In_ size_t y, _In_ DXGI_FORMAT bcformat, _In_ DWORD flags,
+                           _Out_writes_(pwidth * 4) XMVECTOR* pRows, _In_ size_t pwidth )
+{
     const uint8_t *pEnd = image.pixels + image.slicePitch;
-    const size_t rowPitch = image.rowPitch;
-    for( size_t h=0; h < image.height; h += 4 )
+    const size_t ph = std::min<size_t>( 4, image.height - y );
+    const size_t lastBlock = pwidth - 4;
+    const size_t pw = image.width - lastBlock;
+    assert( pw > 0 && pw <= 4 );
+
+    for( size_t t = 0; t < ph; ++t )
     {
-        const uint8_t *sptr = pSrc;
-        uint8_t* dptr = pDest;
-        size_t ph = std::min<size_t>( 4, image.height - h );
-        size_t w = 0;
-        for( size_t count = 0; (count < result.rowPitch) && (w < image.width); count += blocksize, w += 4 )
+        const uint8_t *sptr = image.pixels + ( y + t ) * image.rowPitch;
+        ptrdiff_t bytesLeft = pEnd - sptr;
+        assert( bytesLeft > 0 );
+        size_t bytesToRead = std::min<size_t>( image.rowPitch, bytesLeft );
+
+        XMVECTOR* dptr = pRows + t * pwidth;
+        if ( !_LoadScanline( dptr, image.width, sptr, bytesToRead, image.format ) )
+            return false;
+
+        // Replicate pixels for partial block
+        for( size_t s = pw; s < 4; ++s )
         {
-            size_t pw = std::min<size_t>( 4, image.width - w );
-            assert( pw > 0 && ph > 0 );
+            dptr[ lastBlock + s ] = dptr[ lastBlock + _ReplicatedTexel( s, pw ) ];
+        }
+    }
 
-            ptrdiff_t bytesLeft = pEnd - sptr;
-            assert( bytesLeft > 0 );
-            size_t bytesToRead = std::min<size_t>( rowPitch, bytesLeft );
-            if ( !_LoadScanline( &temp[0], pw, sptr, bytesToRead, format ) )
-                return E_FAIL;
+    for( size_t t = ph; t < 4; ++t )
+    {
+        memcpy( pRows + t * pwidth, pRows + _ReplicatedTexel( t, ph ) * pwidth, sizeof(XMVECTOR) * pwidth );
+    }
 
-            if ( ph > 1 )
-            {
-                bytesToRead = std::min<size_t>( rowPitch, bytesLeft - rowPitch );
-                if ( !_LoadScanline( &temp[4], pw, sptr + rowPitch, bytesToRead, format ) )
-                    return E_FAIL;
+    _ConvertScanline( pRows, pwidth * 4, bcformat, image.format, flags );
+    return true;
+}
 
-                if ( ph > 2 )
-                {
-                    bytesToRead = std::min<size_t>( rowPitch, bytesLeft - rowPitch * 2 );
-                    if ( !_LoadScanline( &temp[8], pw, sptr + rowPitch*2, bytesToRead, format ) )
-                        return E_FAIL;
 
-                    if ( ph > 3 )
-                    {
-                        bytesToRead = std::min<size_t>( rowPitch, bytesLeft - rowPitch * 3 );
-                        if ( !_LoadScanline( &temp[12], pw, sptr + rowPitch*3, bytesToRead, format ) )
-                            return E_FAIL;
-                    }
-                }
-            }
+//-------------------------------------------------------------------------------------
+// Block counters of Compress, summed over every image and thread
+//-------------------------------------------------------------------------------------
+namespace
+{
+    struct BlockStatsState
+    {
+        SRWLOCK         lock;
+        BCBlockStats    stats;
+    };
 
-            if ( pw != 4 || ph != 4 )
-            {
-                // Replicate pixels for partial block
-                static const size_t uSrc[] = { 0, 0, 0, 1 };
+    BlockStatsState g_BlockStats = { SRWLOCK_INIT, { 0, 0, 0 } };
 
-                if ( pw < 4 )
-                {
-                    for( size_t t = 0; t < ph && t < 4; ++t )
-                    {
-                        for( size_t s = pw; s < 4; ++s )
-                        {
-#pragma prefast(suppress: 26000, "PREFAST false positive")
-                            temp[ (t << 2) | s ] = temp[ (t << 2) | uSrc[s] ]; 
-                        }
-                    }
-                }
+    // The same, for the Compress calls of this thread only
+    __declspec(thread) BCBlockStats t_BlockStats = { 0, 0, 0 };
+}
 
-                if ( ph < 4 )
-                {
-                    for( size_t t = ph; t < 4; ++t )
-                    {
-                        for( size_t s = 0; s < 4; ++s )
-                        {
-#pragma prefast(suppress: 26000, "PREFAST false positive")
-                            temp[ (t << 2) | s ] = temp[ (uSrc[t] << 2) | s ]; 
-                        }
-                    }
-                }
-            }
+// Called on the thread that called Compress, with the counts of all the threads that worked for it
+static void _AddBlockStats( _In_ const BCBlockStats& stats )
+{
+    t_BlockStats.blocks += stats.blocks;
+    t_BlockStats.solidBlocks += stats.solidBlocks;
+    t_BlockStats.cachedBlocks += stats.cachedBlocks;
+
+    AcquireSRWLockExclusive( &g_BlockStats.lock );
+    g_BlockStats.stats.blocks += stats.blocks;
+    g_BlockStats.stats.solidBlocks += stats.solidBlocks;
+    g_BlockStats.stats.cachedBlocks += stats.cachedBlocks;
+    ReleaseSRWLockExclusive( &g_BlockStats.lock );
+}
+
+
+//-------------------------------------------------------------------------------------
+// Cache of encoded blocks keyed by their source texels
+//-------------------------------------------------------------------------------------
+// Direct mapped, one per thread and image: a block with the same texels as an earlier one
+// (flat areas, tiles, padding) is copied instead of encoded again. Keys are compared in
+// full, so the output is exactly what the encoder would have written.
+struct BCBlockCache
+{
+    size_t                      keySize;
+    size_t                      blockSize;
+    size_t                      mask;
+    std::unique_ptr<uint8_t[]>  keys;
+    std::unique_ptr<uint8_t[]>  blocks;
+    std::unique_ptr<uint8_t[]>  valid;
+};
+
+// Bytes of keys per cache; at most one slot per block of the image
+static const size_t BC_CACHE_KEY_BYTES = 256 * 1024;
+
+static bool _InitializeCache( _In_ size_t keySize, _In_ size_t blockSize, _In_ size_t nBlocks, _Out_ BCBlockCache& cache )
+{
+    const size_t maxSlots = BC_CACHE_KEY_BYTES / keySize;
+    size_t slots = 16;
+    while ( slots < nBlocks && slots < maxSlots )
+        slots <<= 1;
+
+    cache.keySize = keySize;
+    cache.blockSize = blockSize;
+    cache.mask = slots - 1;
+    cache.keys.reset( new (std::nothrow) uint8_t[ slots * keySize ] );
+    cache.blocks.reset( new (std::nothrow) uint8_t[ slots * blockSize ] );
+    cache.valid.reset( new (std::nothrow) uint8_t[ slots ] );
+    if ( !cache.keys || !cache.blocks || !cache.valid )
+        return false;
+
+    memset( cache.valid.get(), 0, slots );
+    return true;
+}
+
+// Sets the slot of the key; true if that slot holds the key's encoded block
+static bool _FindBlock( _In_ const BCBlockCache& cache, _In_reads_bytes_(cache.keySize) const void* pKey, _Out_ size_t& slot )
+{
+    const uint32_t* pWords = reinterpret_cast<const uint32_t*>( pKey );
+    uint32_t h = 2166136261u;
+    for( size_t i = 0; i < cache.keySize / 4; ++i )
+    {
+        h = ( h ^ pWords[i] ) * 16777619u;
+    }
+    slot = ( h ^ ( h >> 16 ) ) & cache.mask;
+
+    return cache.valid[ slot ] && memcmp( cache.keys.get() + slot * cache.keySize, pKey, cache.keySize ) == 0;
+}
 
-            _ConvertScanline( temp, 16, result.format, format, cflags | srgb );
-            
-            if ( pfEncode )
-                pfEncode( dptr, temp, bcflags );
+static void _StoreBlock( _Inout_ BCBlockCache& cache, _In_ size_t slot, _In_reads_bytes_(cache.keySize) const void* pKey,
+                         _In_reads_bytes_(cache.blockSize) const uint8_t* pBlock )
+{
+    memcpy( cache.keys.get() + slot * cache.keySize, pKey, cache.keySize );
+    memcpy( cache.blocks.get() + slot * cache.blockSize, pBlock, cache.blockSize );
+    cache.valid[ slot ] = 1;
+}
+
+// A block of a run as 16 RGBA texels, the cache key of the run path
+static void _RunBlockKey( _In_ const BCBlockRun& run, _In_ size_t b, _Out_writes_(16) uint32_t key[] )
+{
+    for( size_t i = 0; i < 16; ++i )
+    {
+        key[i] = uint32_t( run.rgba[0][i][b] ) | ( uint32_t( run.rgba[1][i][b] ) << 8 )
+               | ( uint32_t( run.rgba[2][i][b] ) << 16 ) | ( uint32_t( run.rgba[3][i][b] ) << 24 );
+    }
+}
+
+static void _CopyRunBlock( _In_ const BCBlockRun& src, _In_ size_t sb, _Inout_ BCBlockRun& dest, _In_ size_t db )
+{
+    for( size_t c = 0; c < 4; ++c )
+    {
+        for( size_t i = 0; i < 16; ++i )
+        {
+            dest.rgba[c][i][db] = src.rgba[c][i][sb];
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Encodes the row of blocks starting at scanline y
+//-------------------------------------------------------------------------------------
+struct BCRowEncoder
+{
+    BC_ENCODE       pfEncode;
+    BC_ENCODE_RUN   pfEncodeRun;    // Only set when the source can be gathered into runs
+    size_t          blocksize;
+    size_t          solidChannels;  // Channels D3DXIsSolidBlock checks to count solid blocks, 0 for none
+    DWORD           cflags;
+    DWORD           bcflags;
+    DWORD           srgb;
+    float           alphaRef;
+};
+
+// Per-thread state of _CompressBlockRow
+struct BCRowScratch
+{
+    std::unique_ptr<BCBlockRun> run;        // Gathered blocks of the run path
+    std::unique_ptr<BCBlockRun> missed;     // The blocks of a run not found in the cache
+    ScopedAlignedArrayXMVECTOR  rows;       // 4 converted scanlines otherwise
+    BCBlockCache                cache;
+    BCBlockStats                stats;
+};
+
+static void _CompressRunRow( _In_ const Image& image, _In_ const BCRowEncoder& enc, _In_ size_t y,
+                             _Out_ uint8_t* pDest, _Inout_ BCRowScratch& scratch )
+{
+    const size_t nbWidth = std::max<size_t>( 1, ( image.width + 3 ) / 4 );
+    const size_t bs = enc.blocksize;
+    BCBlockRun& run = *scratch.run;
+
+    for( size_t bx = 0; bx < nbWidth; bx += BC_RUN_BLOCKS )
+    {
+        const size_t count = std::min<size_t>( BC_RUN_BLOCKS, nbWidth - bx );
+        _GatherRun( image, y, bx, count, run );
+        uint8_t* pRunDest = pDest + bx * bs;
+
+        uint32_t keys[ BC_RUN_BLOCKS ][ 16 ];
+        size_t slots[ BC_RUN_BLOCKS ];
+        size_t missed[ BC_RUN_BLOCKS ];
+        size_t nMissed = 0;
+        for( size_t b = 0; b < count; ++b )
+        {
+            _RunBlockKey( run, b, keys[b] );
+            if ( _FindBlock( scratch.cache, keys[b], slots[b] ) )
+                memcpy( pRunDest + b * bs, scratch.cache.blocks.get() + slots[b] * bs, bs );
             else
-                D3DXEncodeBC1( dptr, temp, alphaRef, bcflags );
+                missed[ nMissed++ ] = b;
+        }
 
-            sptr += sbpp*4;
-            dptr += blocksize;
+        scratch.stats.blocks += count;
+        scratch.stats.cachedBlocks += count - nMissed;
+        if ( !nMissed )
+            continue;
+
+        // Encode the whole run in place, or pack the missed blocks into a run of their own
+        uint8_t encoded[ BC_RUN_BLOCKS * 16 ];
+        uint8_t* pEncoded = pRunDest;
+        if ( nMissed < count )
+        {
+            for( size_t m = 0; m < nMissed; ++m )
+            {
+                _CopyRunBlock( run, missed[m], *scratch.missed, m );
+            }
+            pEncoded = encoded;
+            enc.pfEncodeRun( pEncoded, *scratch.missed, nMissed, enc.alphaRef, enc.bcflags );
+        }
+        else
+        {
+            enc.pfEncodeRun( pRunDest, run, count, enc.alphaRef, enc.bcflags );
         }
 
-        pSrc += rowPitch*4;
-        pDest += result.rowPitch;
+        for( size_t m = 0; m < nMissed; ++m )
+        {
+            const size_t b = missed[m];
+            uint8_t* dptr = pRunDest + b * bs;
+            if ( pEncoded != pRunDest )
+                memcpy( dptr, pEncoded + m * bs, bs );
+
+            _StoreBlock( scratch.cache, slots[b], keys[b], dptr );
+
+            size_t i = 1;
+            while ( i < 16 && keys[b][i] == keys[b][0] )
+                ++i;
+            if ( i == 16 )
+                ++scratch.stats.solidBlocks;
+        }
     }
+}
 
-    return S_OK;
+static bool _CompressBlockRow( _In_ const Image& image, _In_ const Image& result, _In_ const BCRowEncoder& enc, _In_ size_t y,
+                               _Inout_ BCRowScratch& scratch )
+{
+    const size_t nbWidth = std::max<size_t>( 1, ( image.width + 3 ) / 4 );
+    uint8_t *pDest = result.pixels + ( y / 4 ) * result.rowPitch;
+
+    if ( enc.pfEncodeRun )
+    {
+        assert( scratch.run != 0 && scratch.missed != 0 );
+        _CompressRunRow( image, enc, y, pDest, scratch );
+        return true;
+    }
+
+    assert( scratch.rows != 0 );
+    XMVECTOR* pRows = scratch.rows.get();
+    const size_t pwidth = nbWidth * 4;
+    if ( !_LoadBlockRow( image, y, result.format, enc.cflags | enc.srgb, pRows, pwidth ) )
+        return false;
+
+    XMVECTOR temp[16];
+    for( size_t bx = 0; bx < nbWidth; ++bx )
+    {
+        for( size_t t = 0; t < 4; ++t )
+        {
+            const XMVECTOR* sptr = pRows + t * pwidth + bx * 4;
+            temp[ (t << 2) ] = sptr[0];
+            temp[ (t << 2) | 1 ] = sptr[1];
+            temp[ (t << 2) | 2 ] = sptr[2];
+            temp[ (t << 2) | 3 ] = sptr[3];
+        }
+
+        uint8_t* dptr = pDest + bx * enc.blocksize;
+        ++scratch.stats.blocks;
+
+        size_t slot;
+        if ( _FindBlock( scratch.cache, temp, slot ) )
+        {
+            memcpy( dptr, scratch.cache.blocks.get() + slot * enc.blocksize, enc.blocksize );
+            ++scratch.stats.cachedBlocks;
+            continue;
+        }
+
+        if ( enc.pfEncode )
+            enc.pfEncode( dptr, temp, enc.bcflags );
+        else
+            D3DXEncodeBC1( dptr, temp, enc.alphaRef, enc.bcflags );
+
+        _StoreBlock( scratch.cache, slot, temp, dptr );
+        if ( enc.solidChannels && D3DXIsSolidBlock( temp, enc.solidChannels ) )
+            ++scratch.stats.solidBlocks;
+    }
+
+    return true;
 }
 
+// Channels the encoders of the format test for their solid block paths (BC6H has none)
+static size_t _SolidChannels( _In_ DXGI_FORMAT format )
+{
+    switch( format )
+    {
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:     return 1;
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:     return 2;
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:     return 0;
+    default:                        return 4;
+    }
+}
 
-//-------------------------------------------------------------------------------------
-#ifdef _OPENMP
-static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
-                                     _In_ DWORD srgb, _In_ float alphaRef )
+static HRESULT _SetupRowEncoder( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
+                                 _In_ DWORD srgb, _In_ float alphaRef, _Out_ BCRowEncoder& enc )
 {
     if ( !image.pixels || !result.pixels )
         return E_POINTER;
@@ -215,109 +491,114 @@ static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image&
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
-    // Round to bytes
-    sbpp = ( sbpp + 7 ) / 8;
-
-    const uint8_t *pEnd = image.pixels + image.slicePitch;
-
     // Determine BC format encoder
-    BC_ENCODE pfEncode;
-    size_t blocksize;
-    DWORD cflags;
-    if ( !_DetermineEncoderSettings( result.format, pfEncode, blocksize, cflags ) )
+    if ( !_DetermineEncoderSettings( result.format, enc.pfEncode, enc.pfEncodeRun, enc.blocksize, enc.cflags ) )
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
 
-    // Refactored version of loop to support parallel independance
-    const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4 ) * std::max<size_t>(1, (image.height + 3) / 4 );
+    if ( enc.pfEncodeRun && !_CanGatherRun( format, result.format, srgb ) )
+        enc.pfEncodeRun = nullptr;
 
-    bool fail = false;
+    enc.solidChannels = _SolidChannels( result.format );
+    enc.bcflags = bcflags;
+    enc.srgb = srgb;
+    enc.alphaRef = alphaRef;
+    return S_OK;
+}
+
+// Per-thread scratch of _CompressBlockRow: block runs, or 4 converted scanlines, and the block cache
+static bool _AllocateRowScratch( _In_ const Image& image, _In_ const BCRowEncoder& enc, _Out_ BCRowScratch& scratch )
+{
+    memset( &scratch.stats, 0, sizeof(BCBlockStats) );
 
-#pragma omp parallel for
-    for( int nb=0; nb < static_cast<int>( nBlocks ); ++nb )
+    const size_t nbWidth = std::max<size_t>( 1, ( image.width + 3 ) / 4 );
+    const size_t nBlocks = nbWidth * std::max<size_t>( 1, ( image.height + 3 ) / 4 );
+
+    if ( enc.pfEncodeRun )
     {
-        int nbWidth = std::max<int>(1, int( (image.width + 3) / 4 ) );
+        scratch.run.reset( new (std::nothrow) BCBlockRun );
+        scratch.missed.reset( new (std::nothrow) BCBlockRun );
+        if ( !scratch.run || !scratch.missed )
+            return false;
+        memset( scratch.run.get(), 0, sizeof(BCBlockRun) );
+        memset( scratch.missed.get(), 0, sizeof(BCBlockRun) );
+        return _InitializeCache( sizeof(uint32_t) * 16, enc.blocksize, nBlocks, scratch.cache );
+    }
 
-        int y = nb / nbWidth;
-        int x = ( nb - (y*nbWidth) ) * 4;
-        y *= 4;
+    const size_t pwidth = nbWidth * 4;
+    scratch.rows.reset( reinterpret_cast<XMVECTOR*>( _aligned_malloc( sizeof(XMVECTOR) * pwidth * 4, 16 ) ) );
+    if ( !scratch.rows )
+        return false;
+    return _InitializeCache( sizeof(XMVECTOR) * 16, enc.blocksize, nBlocks, scratch.cache );
+}
 
-        assert( (x >= 0) && (x < int(image.width)) );
-        assert( (y >= 0) && (y < int(image.height)) );
 
-        size_t rowPitch = image.rowPitch;
-        const uint8_t *pSrc = image.pixels + (y*rowPitch) + (x*sbpp);
+//-------------------------------------------------------------------------------------
+static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
+                            _In_ DWORD srgb, _In_ float alphaRef )
+{
+    BCRowEncoder enc;
+    HRESULT hr = _SetupRowEncoder( image, result, bcflags, srgb, alphaRef, enc );
+    if ( FAILED(hr) )
+        return hr;
 
-        uint8_t *pDest = result.pixels + (nb*blocksize);
+    BCRowScratch scratch;
+    if ( !_AllocateRowScratch( image, enc, scratch ) )
+        return E_OUTOFMEMORY;
 
-        size_t ph = std::min<size_t>( 4, image.height - y );
-        size_t pw = std::min<size_t>( 4, image.width - x );
-        assert( pw > 0 && ph > 0 );
+    for( size_t y = 0; y < image.height; y += 4 )
+    {
+        if ( !_CompressBlockRow( image, result, enc, y, scratch ) )
+            return E_FAIL;
+    }
 
-        ptrdiff_t bytesLeft = pEnd - pSrc;
-        assert( bytesLeft > 0 );
-        size_t bytesToRead = std::min<size_t>( rowPitch, bytesLeft );
+    _AddBlockStats( scratch.stats );
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+#ifdef _OPENMP
+static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
+                                     _In_ DWORD srgb, _In_ float alphaRef )
+{
+    BCRowEncoder enc;
+    HRESULT hr = _SetupRowEncoder( image, result, bcflags, srgb, alphaRef, enc );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Rows of blocks are independent; each thread keeps its own scratch and block cache
+    const int nbHeight = static_cast<int>( std::max<size_t>( 1, ( image.height + 3 ) / 4 ) );
 
-        XMVECTOR temp[16];
-        if ( !_LoadScanline( &temp[0], pw, pSrc, bytesToRead, format ) )
+    bool fail = false;
+    BCBlockStats stats = { 0, 0, 0 };
+
+#pragma omp parallel
+    {
+        BCRowScratch scratch;
+        bool ready = _AllocateRowScratch( image, enc, scratch );
+        if ( !ready )
             fail = true;
 
-        if ( ph > 1 )
+#pragma omp for
+        for( int by = 0; by < nbHeight; ++by )
         {
-            bytesToRead = std::min<size_t>( rowPitch, bytesLeft - rowPitch );
-            if ( !_LoadScanline( &temp[4], pw, pSrc + rowPitch, bytesToRead, format ) )
+            if ( ready && !_CompressBlockRow( image, result, enc, size_t( by ) * 4, scratch ) )
                 fail = true;
-
-            if ( ph > 2 )
-            {
-                bytesToRead = std::min<size_t>( rowPitch, bytesLeft - rowPitch * 2 );
-                if ( !_LoadScanline( &temp[8], pw, pSrc + rowPitch*2, bytesToRead, format ) )
-                    fail = true;
-
-                if ( ph > 3 )
-                {
-                    bytesToRead = std::min<size_t>( rowPitch, bytesLeft - rowPitch * 3 );
-                    if ( !_LoadScanline( &temp[12], pw, pSrc + rowPitch*3, bytesToRead, format ) )
-                        fail = true;
-                }
-            }
         }
 
-        if ( pw != 4 || ph != 4 )
+        if ( ready )
         {
-            // Replicate pixels for partial block
-            static const size_t uSrc[] = { 0, 0, 0, 1 };
-
-            if ( pw < 4 )
-            {
-                for( size_t t = 0; t < ph && t < 4; ++t )
-                {
-                    for( size_t s = pw; s < 4; ++s )
-                    {
-                        temp[ (t << 2) | s ] = temp[ (t << 2) | uSrc[s] ]; 
-                    }
-                }
-            }
-
-            if ( ph < 4 )
+#pragma omp critical
             {
-                for( size_t t = ph; t < 4; ++t )
-                {
-                    for( size_t s = 0; s < 4; ++s )
-                    {
-                        temp[ (t << 2) | s ] = temp[ (uSrc[t] << 2) | s ]; 
-                    }
-                }
+                stats.blocks += scratch.stats.blocks;
+                stats.solidBlocks += scratch.stats.solidBlocks;
+                stats.cachedBlocks += scratch.stats.cachedBlocks;
             }
         }
-
-        _ConvertScanline( temp, 16, result.format, format, cflags | srgb );
-            
-        if ( pfEncode )
-            pfEncode( pDest, temp, bcflags );
-        else
-            D3DXEncodeBC1( pDest, temp, alphaRef, bcflags );
     }
 
+    _AddBlockStats( stats );
+
     return (fail) ? E_FAIL : S_OK;
 }
 
@@ -372,6 +653,73 @@ static DXGI_FORMAT _DefaultDecompress( _In_ DXGI_FORMAT format )
 }
 
 
+//-------------------------------------------------------------------------------------
+// 8-bit decoders for BC1-5 into their default format (no conversion in between)
+//-------------------------------------------------------------------------------------
+static BC_DECODE_8 _DetermineDecoder8( _In_ DXGI_FORMAT cformat, _In_ DXGI_FORMAT format )
+{
+    switch( cformat )
+    {
+    case DXGI_FORMAT_BC1_UNORM:         return ( format == DXGI_FORMAT_R8G8B8A8_UNORM ) ? D3DXDecodeBC1ToRGBA8 : nullptr;
+    case DXGI_FORMAT_BC1_UNORM_SRGB:    return ( format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ) ? D3DXDecodeBC1ToRGBA8 : nullptr;
+    case DXGI_FORMAT_BC2_UNORM:         return ( format == DXGI_FORMAT_R8G8B8A8_UNORM ) ? D3DXDecodeBC2ToRGBA8 : nullptr;
+    case DXGI_FORMAT_BC2_UNORM_SRGB:    return ( format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ) ? D3DXDecodeBC2ToRGBA8 : nullptr;
+    case DXGI_FORMAT_BC3_UNORM:         return ( format == DXGI_FORMAT_R8G8B8A8_UNORM ) ? D3DXDecodeBC3ToRGBA8 : nullptr;
+    case DXGI_FORMAT_BC3_UNORM_SRGB:    return ( format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ) ? D3DXDecodeBC3ToRGBA8 : nullptr;
+    case DXGI_FORMAT_BC4_UNORM:         return ( format == DXGI_FORMAT_R8_UNORM ) ? D3DXDecodeBC4UToR8 : nullptr;
+    case DXGI_FORMAT_BC4_SNORM:         return ( format == DXGI_FORMAT_R8_SNORM ) ? D3DXDecodeBC4SToR8 : nullptr;
+    case DXGI_FORMAT_BC5_UNORM:         return ( format == DXGI_FORMAT_R8G8_UNORM ) ? D3DXDecodeBC5UToRG8 : nullptr;
+    case DXGI_FORMAT_BC5_SNORM:         return ( format == DXGI_FORMAT_R8G8_SNORM ) ? D3DXDecodeBC5SToRG8 : nullptr;
+    default:                            return nullptr;
+    }
+}
+
+static HRESULT _DecompressBC8( _In_ const Image& cImage, _In_ const Image& result, _In_ BC_DECODE_8 pfDecode8,
+                               _In_ size_t sbpp, _In_ size_t dbpp )
+{
+    // Edge blocks go through a block-sized buffer
+    uint8_t temp[ 4 * 16 ];
+    const size_t tempPitch = 16;
+
+    const uint8_t *pSrc = cImage.pixels;
+    uint8_t *pDest = result.pixels;
+    const size_t rowPitch = result.rowPitch;
+    for( size_t h=0; h < cImage.height; h += 4 )
+    {
+        const uint8_t *sptr = pSrc;
+        uint8_t* dptr = pDest;
+        size_t ph = std::min<size_t>( 4, cImage.height - h );
+        size_t w = 0;
+        for( size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += sbpp, w += 4 )
+        {
+            size_t pw = std::min<size_t>( 4, cImage.width - w );
+            assert( pw > 0 && ph > 0 );
+
+            if ( pw == 4 && ph == 4 )
+            {
+                pfDecode8( dptr, rowPitch, sptr );
+            }
+            else
+            {
+                pfDecode8( temp, tempPitch, sptr );
+                for( size_t t = 0; t < ph; ++t )
+                {
+                    memcpy( dptr + rowPitch * t, temp + tempPitch * t, pw * dbpp );
+                }
+            }
+
+            sptr += sbpp;
+            dptr += dbpp*4;
+        }
+
+        pSrc += cImage.rowPitch;
+        pDest += rowPitch*4;
+    }
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result )
 {
@@ -436,6 +784,10 @@ static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
+    BC_DECODE_8 pfDecode8 = _DetermineDecoder8( cformat, format );
+    if ( pfDecode8 )
+        return _DecompressBC8( cImage, result, pfDecode8, sbpp, dbpp );
+
     XMVECTOR temp[16];
     const uint8_t *pSrc = cImage.pixels;
     const size_t rowPitch = result.rowPitch;
@@ -699,6 +1051,21 @@ HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& met
 }
 
 
+_Use_decl_annotations_
+void __cdecl GetBCBlockStats( BCBlockStats& stats )
+{
+    AcquireSRWLockShared( &g_BlockStats.lock );
+    stats = g_BlockStats.stats;
+    ReleaseSRWLockShared( &g_BlockStats.lock );
+}
+
+_Use_decl_annotations_
+void __cdecl GetThreadBCBlockStats( BCBlockStats& stats )
+{
+    stats = t_BlockStats;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Decompression
 //-------------------------------------------------------------------------------------
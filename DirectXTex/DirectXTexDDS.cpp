@@ -1611,6 +1611,478 @@ HRESULT LoadFromDDSFile( LPCWSTR szFile, DWORD flags, TexMetadata* metadata, Scr
 }
 
 
+//-------------------------------------------------------------------------------------
+// Load a Star Citizen split DDS (header fragment + mip part files) from disk
+//-------------------------------------------------------------------------------------
+static HANDLE _OpenSplitFragment( _In_z_ LPCWSTR szFile )
+{
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    return safe_handle( CreateFile2( szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, 0 ) );
+#else
+    return safe_handle( CreateFileW( szFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                     FILE_FLAG_SEQUENTIAL_SCAN, 0 ) );
+#endif
+}
+
+static HRESULT _GetSplitFragmentSize( _In_ HANDLE hFile, _Out_ DWORD& size )
+{
+    size = 0;
+
+    LARGE_INTEGER fileSize = {0};
+    if ( !GetFileSizeEx( hFile, &fileSize ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    // Each fragment, like a whole DDS, must fit a 32-bit read
+    if ( fileSize.HighPart > 0 )
+    {
+        return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+    }
+
+    size = fileSize.LowPart;
+    return S_OK;
+}
+
+static HRESULT _ReadSplitFragment( _In_ HANDLE hFile, _Out_writes_bytes_(size) uint8_t* pDest, _In_ DWORD size )
+{
+    if ( !size )
+        return S_OK;
+
+    DWORD bytesRead = 0;
+    if ( !ReadFile( hFile, pDest, size, &bytesRead, 0 ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    return ( bytesRead == size ) ? S_OK : E_FAIL;
+}
+
+// Reads and decodes the header of a split header fragment (or of a whole DDS file) and leaves
+// the file at the small mips that follow it: 'tailSize' bytes from 'tailOffset' to the end.
+static HRESULT _ReadSplitHeader( _In_ HANDLE hFile, _In_ DWORD flags, _Out_ TexMetadata& metadata, _Out_ DWORD& convFlags,
+                                 _Out_ DWORD& tailOffset, _Out_ DWORD& tailSize )
+{
+    convFlags = tailOffset = tailSize = 0;
+
+    DWORD headerFileSize = 0;
+    HRESULT hr = _GetSplitFragmentSize( hFile, headerFileSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Read the header in (including extended header if present). CIG gloss and mask alpha fragments
+    // are written without the "DDS " magic value, so it is put back in front of the header here.
+    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+    uint8_t header[MAX_HEADER_SIZE];
+
+    DWORD bytesRead = 0;
+    if ( !ReadFile( hFile, header, MAX_HEADER_SIZE, &bytesRead, 0 ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    if ( bytesRead < sizeof(DDS_HEADER) )
+    {
+        return E_FAIL;
+    }
+
+    size_t magicBias = 0;
+    if ( *reinterpret_cast<const uint32_t*>( header ) != DDS_MAGIC )
+    {
+        memmove( header + sizeof(uint32_t), header, MAX_HEADER_SIZE - sizeof(uint32_t) );
+        *reinterpret_cast<uint32_t*>( header ) = DDS_MAGIC;
+
+        magicBias = sizeof(uint32_t);
+        bytesRead = std::min<DWORD>( bytesRead + sizeof(uint32_t), MAX_HEADER_SIZE );
+    }
+
+    size_t headerSize = bytesRead;
+
+    if ( flags & DDS_FLAGS_SPLIT_ATI1 )
+    {
+        auto pHeader = reinterpret_cast<DDS_HEADER*>( header + sizeof(uint32_t) );
+        if ( (pHeader->ddspf.dwFlags & DDS_FOURCC)
+             && (MAKEFOURCC( 'D', 'X', '1', '0' ) == pHeader->ddspf.dwFourCC) )
+        {
+            // Mask alpha parts carry no extension header; pixel data follows the standard header
+            pHeader->ddspf.dwFourCC = MAKEFOURCC( 'A', 'T', 'I', '1' );
+            headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        }
+    }
+
+    hr = _DecodeDDSHeader( header, headerSize, flags, metadata, convFlags );
+    if ( FAILED(hr) )
+        return hr;
+
+    if ( convFlags & CONV_FLAGS_PAL8 )
+    {
+        // Split textures are always block compressed or plain RGB(A); palettes are not supported
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+    }
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if ( convFlags & CONV_FLAGS_DX10 )
+        offset += sizeof(DDS_HEADER_DXT10);
+
+    // Position of the small mips inside the header fragment
+    tailOffset = static_cast<DWORD>( offset - magicBias );
+    if ( headerFileSize < tailOffset )
+        return E_FAIL;
+
+    tailSize = headerFileSize - tailOffset;
+
+    LARGE_INTEGER filePos = { tailOffset, 0 };
+    if ( !SetFilePointerEx( hFile, filePos, 0, FILE_BEGIN ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT GetMetadataFromSplitDDS( LPCWSTR szHeaderFile, DWORD flags, TexMetadata& metadata )
+{
+    if ( !szHeaderFile )
+        return E_INVALIDARG;
+
+    ScopedHandle hFile( _OpenSplitFragment( szHeaderFile ) );
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    DWORD convFlags, tailOffset, tailSize;
+    return _ReadSplitHeader( hFile.get(), flags, metadata, convFlags, tailOffset, tailSize );
+}
+
+_Use_decl_annotations_
+HRESULT LoadFromSplitDDS( LPCWSTR szHeaderFile, const LPCWSTR* szParts, size_t nParts, DWORD flags, TexMetadata* metadata, ScratchImage& image )
+{
+    if ( !szHeaderFile || ( nParts > 0 && !szParts ) )
+        return E_INVALIDARG;
+
+    image.Release();
+
+    ScopedHandle hFile( _OpenSplitFragment( szHeaderFile ) );
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    DWORD convFlags, tailOffset, tailSize;
+    TexMetadata mdata;
+    HRESULT hr = _ReadSplitHeader( hFile.get(), flags, mdata, convFlags, tailOffset, tailSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Open all mip parts up front so the total size is known before allocating
+    std::unique_ptr<ScopedHandle[]> hParts;
+    std::unique_ptr<DWORD[]> partSizes;
+    if ( nParts > 0 )
+    {
+        hParts.reset( new (std::nothrow) ScopedHandle[ nParts ] );
+        partSizes.reset( new (std::nothrow) DWORD[ nParts ] );
+        if ( !hParts || !partSizes )
+            return E_OUTOFMEMORY;
+    }
+
+    uint64_t total = tailSize;
+    for( size_t i = 0; i < nParts; ++i )
+    {
+        if ( !szParts[ i ] )
+            return E_INVALIDARG;
+
+        hParts[ i ].reset( _OpenSplitFragment( szParts[ i ] ) );
+        if ( !hParts[ i ] )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        hr = _GetSplitFragmentSize( hParts[ i ].get(), partSizes[ i ] );
+        if ( FAILED(hr) )
+            return hr;
+
+        total += partSizes[ i ];
+    }
+
+    if ( total == 0 )
+        return E_FAIL;
+
+    if ( total > UINT32_MAX )
+        return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+    hr = image.Initialize( mdata );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Without legacy expansion the DDS pixel stream has exactly the ScratchImage layout,
+    // so every fragment is read straight into its place in the subresource memory.
+    bool direct = !( (convFlags & CONV_FLAGS_EXPAND) || (flags & DDS_FLAGS_LEGACY_DWORD) );
+
+    std::unique_ptr<uint8_t[]> temp;
+    uint8_t* pDest = image.GetPixels();
+    size_t capacity = image.GetPixelsSize();
+
+    if ( direct )
+    {
+        if ( total < capacity )
+        {
+            image.Release();
+            return E_FAIL;
+        }
+    }
+    else
+    {
+        temp.reset( new (std::nothrow) uint8_t[ static_cast<size_t>( total ) ] );
+        if ( !temp )
+        {
+            image.Release();
+            return E_OUTOFMEMORY;
+        }
+
+        pDest = temp.get();
+        capacity = static_cast<size_t>( total );
+    }
+
+    size_t filled = 0;
+    for( size_t i = 0; i < nParts && filled < capacity; ++i )
+    {
+        DWORD count = static_cast<DWORD>( std::min<size_t>( partSizes[ i ], capacity - filled ) );
+        hr = _ReadSplitFragment( hParts[ i ].get(), pDest + filled, count );
+        if ( FAILED(hr) )
+        {
+            image.Release();
+            return hr;
+        }
+        filled += count;
+
+        hParts[ i ].reset();
+    }
+
+    if ( filled < capacity )
+    {
+        DWORD count = static_cast<DWORD>( std::min<size_t>( tailSize, capacity - filled ) );
+        hr = _ReadSplitFragment( hFile.get(), pDest + filled, count );
+        if ( FAILED(hr) )
+        {
+            image.Release();
+            return hr;
+        }
+        filled += count;
+    }
+
+    if ( direct )
+    {
+        if ( convFlags & (CONV_FLAGS_SWIZZLE|CONV_FLAGS_NOALPHA) )
+        {
+            // Swizzle/copy image in place
+            hr = _CopyImageInPlace( convFlags, image );
+        }
+    }
+    else
+    {
+        hr = _CopyImage( temp.get(), filled, mdata,
+                         (flags & DDS_FLAGS_LEGACY_DWORD) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE,
+                         convFlags, nullptr, image );
+    }
+
+    if ( FAILED(hr) )
+    {
+        image.Release();
+        return hr;
+    }
+
+    if ( metadata )
+        memcpy( metadata, &mdata, sizeof(TexMetadata) );
+
+    return S_OK;
+}
+
+
+
+//-------------------------------------------------------------------------------------
+// Copy a subset of a split (or whole) DDS to a new DDS in memory, without decoding
+//-------------------------------------------------------------------------------------
+struct SplitSegment
+{
+    HANDLE      hFile;
+    uint64_t    fileOffset;
+    uint64_t    size;
+};
+
+// Reads 'size' bytes from 'offset' of the pixel stream the segments make up in order
+static HRESULT _ReadSplitRange( _In_reads_(nSegments) const SplitSegment* segments, _In_ size_t nSegments, _In_ uint64_t offset,
+                                _Out_writes_bytes_(size) uint8_t* pDest, _In_ size_t size )
+{
+    for( size_t i = 0; i < nSegments && size > 0; ++i )
+    {
+        if ( offset >= segments[ i ].size )
+        {
+            offset -= segments[ i ].size;
+            continue;
+        }
+
+        LARGE_INTEGER filePos;
+        filePos.QuadPart = static_cast<LONGLONG>( segments[ i ].fileOffset + offset );
+        if ( !SetFilePointerEx( segments[ i ].hFile, filePos, 0, FILE_BEGIN ) )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        DWORD count = static_cast<DWORD>( std::min<uint64_t>( segments[ i ].size - offset, size ) );
+        HRESULT hr = _ReadSplitFragment( segments[ i ].hFile, pDest, count );
+        if ( FAILED(hr) )
+            return hr;
+
+        pDest += count;
+        size -= count;
+        offset = 0;
+    }
+
+    return ( size == 0 ) ? S_OK : E_FAIL;
+}
+
+_Use_decl_annotations_
+HRESULT CopySplitDDSToMemory( LPCWSTR szHeaderFile, const LPCWSTR* szParts, size_t nParts, DWORD flags,
+                              const TexMetadata& metadata, size_t firstItem, DWORD saveFlags, Blob& blob )
+{
+    if ( !szHeaderFile || ( nParts > 0 && !szParts ) )
+        return E_INVALIDARG;
+
+    blob.Release();
+
+    ScopedHandle hFile( _OpenSplitFragment( szHeaderFile ) );
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    DWORD convFlags, tailOffset, tailSize;
+    TexMetadata mdata;
+    HRESULT hr = _ReadSplitHeader( hFile.get(), flags, mdata, convFlags, tailOffset, tailSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Only a pixel stream that is loaded without any conversion can be copied as it is
+    if ( (convFlags & (CONV_FLAGS_EXPAND|CONV_FLAGS_SWIZZLE|CONV_FLAGS_NOALPHA)) || (flags & DDS_FLAGS_LEGACY_DWORD) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    // Same format and top level, a leading run of the mip levels and a run of the items
+    if ( metadata.format != mdata.format || metadata.dimension != mdata.dimension
+         || metadata.width != mdata.width || metadata.height != mdata.height || metadata.depth != mdata.depth
+         || metadata.IsCubemap() != mdata.IsCubemap()
+         || !metadata.mipLevels || metadata.mipLevels > mdata.mipLevels
+         || !metadata.arraySize || ( firstItem + metadata.arraySize ) > mdata.arraySize )
+        return E_INVALIDARG;
+
+    if ( mdata.IsCubemap() && ( (firstItem % 6) != 0 || (metadata.arraySize % 6) != 0 ) )
+        return E_INVALIDARG;
+
+    // Bytes of one item (all of its mips) in the source, and of the mips kept
+    uint64_t itemBytes = 0;
+    uint64_t keptBytes = 0;
+    size_t width = mdata.width;
+    size_t height = mdata.height;
+    size_t depth = mdata.depth;
+    for( size_t level = 0; level < mdata.mipLevels; ++level )
+    {
+        size_t rowPitch, slicePitch;
+        ComputePitch( mdata.format, width, height, rowPitch, slicePitch, CP_FLAGS_NONE );
+
+        uint64_t bytes = uint64_t( slicePitch ) * ( ( mdata.dimension == TEX_DIMENSION_TEXTURE3D ) ? depth : 1 );
+        itemBytes += bytes;
+        if ( level < metadata.mipLevels )
+            keptBytes += bytes;
+
+        if ( width > 1 )
+            width >>= 1;
+        if ( height > 1 )
+            height >>= 1;
+        if ( depth > 1 )
+            depth >>= 1;
+    }
+
+    // Pixel stream: the mip parts in order, then the small mips in the header fragment
+    std::unique_ptr<ScopedHandle[]> hParts;
+    std::unique_ptr<SplitSegment[]> segments( new (std::nothrow) SplitSegment[ nParts + 1 ] );
+    if ( !segments )
+        return E_OUTOFMEMORY;
+
+    if ( nParts > 0 )
+    {
+        hParts.reset( new (std::nothrow) ScopedHandle[ nParts ] );
+        if ( !hParts )
+            return E_OUTOFMEMORY;
+    }
+
+    uint64_t total = tailSize;
+    for( size_t i = 0; i < nParts; ++i )
+    {
+        if ( !szParts[ i ] )
+            return E_INVALIDARG;
+
+        hParts[ i ].reset( _OpenSplitFragment( szParts[ i ] ) );
+        if ( !hParts[ i ] )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        DWORD partSize = 0;
+        hr = _GetSplitFragmentSize( hParts[ i ].get(), partSize );
+        if ( FAILED(hr) )
+            return hr;
+
+        segments[ i ].hFile = hParts[ i ].get();
+        segments[ i ].fileOffset = 0;
+        segments[ i ].size = partSize;
+        total += partSize;
+    }
+
+    segments[ nParts ].hFile = hFile.get();
+    segments[ nParts ].fileOffset = tailOffset;
+    segments[ nParts ].size = tailSize;
+
+    if ( total < itemBytes * mdata.arraySize )
+        return E_FAIL;
+
+    size_t headerSize = 0;
+    hr = _EncodeDDSHeader( metadata, saveFlags, nullptr, 0, headerSize );
+    if ( FAILED(hr) )
+        return hr;
+
+    uint64_t required = headerSize + keptBytes * metadata.arraySize;
+    if ( required > UINT32_MAX )
+        return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+    hr = blob.Initialize( static_cast<size_t>( required ) );
+    if ( FAILED(hr) )
+        return hr;
+
+    auto pDestination = reinterpret_cast<uint8_t*>( blob.GetBufferPointer() );
+    hr = _EncodeDDSHeader( metadata, saveFlags, pDestination, blob.GetBufferSize(), headerSize );
+    if ( FAILED(hr) )
+    {
+        blob.Release();
+        return hr;
+    }
+    pDestination += headerSize;
+
+    // The kept mips of an item are one contiguous run at its start
+    for( size_t item = 0; item < metadata.arraySize; ++item )
+    {
+        hr = _ReadSplitRange( segments.get(), nParts + 1, ( firstItem + item ) * itemBytes, pDestination, static_cast<size_t>( keptBytes ) );
+        if ( FAILED(hr) )
+        {
+            blob.Release();
+            return hr;
+        }
+        pDestination += keptBytes;
+    }
+
+    return S_OK;
+}
+
 //-------------------------------------------------------------------------------------
 // Save a DDS file to memory
 //-------------------------------------------------------------------------------------
@@ -322,7 +322,7 @@ HRESULT ScratchImage::Initialize( const TexMetadata& mdata, DWORD flags )
     _nimages = nimages;
     memset( _image, 0, sizeof(Image) * nimages );
 
-    _memory = reinterpret_cast<uint8_t*>( _aligned_malloc( pixelSize, 16 ) );
+    _memory = reinterpret_cast<uint8_t*>( _PoolAlloc( pixelSize ) );
     if ( !_memory )
     {
         Release();
@@ -388,7 +388,7 @@ HRESULT ScratchImage::Initialize2D( DXGI_FORMAT fmt, size_t width, size_t height
     _nimages = nimages;
     memset( _image, 0, sizeof(Image) * nimages );
 
-    _memory = reinterpret_cast<uint8_t*>( _aligned_malloc( pixelSize, 16 ) );
+    _memory = reinterpret_cast<uint8_t*>( _PoolAlloc( pixelSize ) );
     if ( !_memory )
     {
         Release();
@@ -440,7 +440,7 @@ HRESULT ScratchImage::Initialize3D( DXGI_FORMAT fmt, size_t width, size_t height
     _nimages = nimages;
     memset( _image, 0, sizeof(Image) * nimages );
 
-    _memory = reinterpret_cast<uint8_t*>( _aligned_malloc( pixelSize, 16 ) );
+    _memory = reinterpret_cast<uint8_t*>( _PoolAlloc( pixelSize ) );
     if ( !_memory )
     {
         Release();
@@ -649,7 +649,6 @@ HRESULT ScratchImage::Initialize3DFromImages( const Image* images, size_t depth,
 void ScratchImage::Release()
 {
     _nimages = 0;
-    _size = 0;
 
     if ( _image )
     {
@@ -659,9 +658,10 @@ void ScratchImage::Release()
 
     if ( _memory )
     {
-        _aligned_free( _memory );
+        _PoolFree( _memory, _size );
         _memory = 0;
     }
+    _size = 0;
     
     memset(&_metadata, 0, sizeof(_metadata));
 }
@@ -223,6 +223,12 @@ namespace DirectX
     void __cdecl _ConvertScanline( _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count,
                                    _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat, _In_ DWORD flags );
 
+    //---------------------------------------------------------------------------------
+    // Image memory pool (ScratchImage and Blob pixel memory)
+    _Ret_maybenull_ void* __cdecl _PoolAlloc( _In_ size_t size );
+    void __cdecl _PoolFree( _In_opt_ void* ptr, _In_ size_t size );
+        // 'size' must be the size passed to _PoolAlloc
+
     //---------------------------------------------------------------------------------
     // DDS helper functions
     HRESULT __cdecl _EncodeDDSHeader( _In_ const TexMetadata& metadata, DWORD flags,
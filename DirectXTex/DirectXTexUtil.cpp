@@ -1399,6 +1399,200 @@ size_t TexMetadata::ComputeIndex( size_t mip, size_t item, size_t slice ) const
 }
 
 
+//=====================================================================================
+// Image memory pool
+//=====================================================================================
+
+namespace
+{
+    // Buffers of 64K or less come straight from the heap. Larger ones are rounded up to a
+    // size class (2^k or 3*2^(k-2)), so a buffer can be used again by any request of the
+    // same class and no more than a third of it is ever wasted.
+    const size_t POOL_MIN_SIZE = 64 * 1024;
+    const size_t POOL_CLASSES = 64;
+    const size_t POOL_DEFAULT_LIMIT = size_t(512) * 1024 * 1024;
+
+    // Free buffers are kept in a per-class LIFO list linked through their first bytes, so the
+    // buffer a stage has just released is the next one handed out. Everything here is plain
+    // data and is never destroyed, so ScratchImage objects may outlive static destruction.
+    struct PoolState
+    {
+        SRWLOCK     lock;
+        void*       freeList[ POOL_CLASSES ];
+        size_t      limit;
+        size_t      hits;
+        size_t      misses;
+        size_t      bytesInUse;
+        size_t      peakBytesInUse;
+        size_t      bytesCached;
+        size_t      peakBytesCached;
+    };
+
+    PoolState g_Pool = { SRWLOCK_INIT, { nullptr }, POOL_DEFAULT_LIMIT, 0, 0, 0, 0, 0, 0 };
+
+    class PoolLock
+    {
+    public:
+        PoolLock() { AcquireSRWLockExclusive( &g_Pool.lock ); }
+        ~PoolLock() { ReleaseSRWLockExclusive( &g_Pool.lock ); }
+
+    private:
+        PoolLock( const PoolLock& );
+        PoolLock& operator=( const PoolLock& );
+    };
+
+    // Returns false for sizes that bypass the pool
+    bool _PoolClass( size_t size, size_t& index, size_t& classSize )
+    {
+        if ( size <= POOL_MIN_SIZE )
+            return false;
+
+        size_t k = 17;
+        size_t p = size_t(1) << k;
+        while ( p < size )
+        {
+            if ( k >= sizeof(size_t) * 8 - 1 )
+                return false;
+            ++k;
+            p <<= 1;
+        }
+
+        size_t threeQuarters = ( p >> 2 ) * 3;
+        if ( threeQuarters >= size )
+        {
+            index = ( k - 17 ) * 2;
+            classSize = threeQuarters;
+        }
+        else
+        {
+            index = ( k - 17 ) * 2 + 1;
+            classSize = p;
+        }
+
+        return ( index < POOL_CLASSES );
+    }
+
+    // Caller holds the lock
+    void _PoolTrim( size_t maxCached )
+    {
+        for( size_t index = POOL_CLASSES; index > 0 && g_Pool.bytesCached > maxCached; --index )
+        {
+            size_t k = 17 + ( index - 1 ) / 2;
+            size_t classSize = ( ( index - 1 ) & 1 ) ? ( size_t(1) << k ) : ( ( size_t(1) << ( k - 2 ) ) * 3 );
+
+            while ( g_Pool.freeList[ index - 1 ] && g_Pool.bytesCached > maxCached )
+            {
+                void* ptr = g_Pool.freeList[ index - 1 ];
+                g_Pool.freeList[ index - 1 ] = *reinterpret_cast<void**>( ptr );
+                g_Pool.bytesCached -= classSize;
+                _aligned_free( ptr );
+            }
+        }
+    }
+}
+
+_Use_decl_annotations_
+void* __cdecl _PoolAlloc( size_t size )
+{
+    size_t index, classSize;
+    if ( !_PoolClass( size, index, classSize ) )
+        return _aligned_malloc( size, 16 );
+
+    {
+        PoolLock lock;
+
+        void* ptr = g_Pool.freeList[ index ];
+        if ( ptr )
+        {
+            g_Pool.freeList[ index ] = *reinterpret_cast<void**>( ptr );
+            g_Pool.bytesCached -= classSize;
+            ++g_Pool.hits;
+        }
+        else
+        {
+            ++g_Pool.misses;
+        }
+
+        g_Pool.bytesInUse += classSize;
+        if ( g_Pool.bytesInUse > g_Pool.peakBytesInUse )
+            g_Pool.peakBytesInUse = g_Pool.bytesInUse;
+
+        if ( ptr )
+            return ptr;
+    }
+
+    void* ptr = _aligned_malloc( classSize, 16 );
+    if ( !ptr )
+    {
+        PoolLock lock;
+        g_Pool.bytesInUse -= classSize;
+    }
+
+    return ptr;
+}
+
+_Use_decl_annotations_
+void __cdecl _PoolFree( void* ptr, size_t size )
+{
+    if ( !ptr )
+        return;
+
+    size_t index, classSize;
+    if ( !_PoolClass( size, index, classSize ) )
+    {
+        _aligned_free( ptr );
+        return;
+    }
+
+    {
+        PoolLock lock;
+
+        g_Pool.bytesInUse -= classSize;
+
+        if ( g_Pool.bytesCached + classSize <= g_Pool.limit )
+        {
+            *reinterpret_cast<void**>( ptr ) = g_Pool.freeList[ index ];
+            g_Pool.freeList[ index ] = ptr;
+            g_Pool.bytesCached += classSize;
+            if ( g_Pool.bytesCached > g_Pool.peakBytesCached )
+                g_Pool.peakBytesCached = g_Pool.bytesCached;
+            return;
+        }
+    }
+
+    _aligned_free( ptr );
+}
+
+_Use_decl_annotations_
+void __cdecl GetImagePoolStats( ImagePoolStats& stats )
+{
+    PoolLock lock;
+
+    stats.hits = g_Pool.hits;
+    stats.misses = g_Pool.misses;
+    stats.bytesInUse = g_Pool.bytesInUse;
+    stats.peakBytesInUse = g_Pool.peakBytesInUse;
+    stats.bytesCached = g_Pool.bytesCached;
+    stats.peakBytesCached = g_Pool.peakBytesCached;
+}
+
+_Use_decl_annotations_
+void __cdecl SetImagePoolLimit( size_t maxCachedBytes )
+{
+    PoolLock lock;
+
+    g_Pool.limit = maxCachedBytes;
+    _PoolTrim( maxCachedBytes );
+}
+
+void __cdecl TrimImagePool()
+{
+    PoolLock lock;
+
+    _PoolTrim( 0 );
+}
+
+
 //=====================================================================================
 // Blob - Bitmap image container
 //=====================================================================================
@@ -1422,7 +1616,7 @@ void Blob::Release()
 {
     if ( _buffer )
     {
-        _aligned_free( _buffer );
+        _PoolFree( _buffer, _size );
         _buffer = nullptr;
     }
 
@@ -1437,7 +1631,7 @@ HRESULT Blob::Initialize( size_t size )
 
     Release();
 
-    _buffer = _aligned_malloc( size, 16 );
+    _buffer = _PoolAlloc( size );
     if ( !_buffer )
     {
         Release();
@@ -0,0 +1,167 @@
+//--------------------------------------------------------------------------------------
+// File: BCBench.cpp
+//
+// Speed and error of the BC1-3 color encoder tiers, for the -bcbench command line.
+//--------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "BCBench.h"
+#include "FileIO.h"
+#include "directxtex.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	struct SBenchTier
+	{
+		const char*	name;
+		DWORD		dwCompress;
+	};
+
+	const SBenchTier s_tiers[] =
+	{
+		{ "reference",	TEX_COMPRESS_DEFAULT },
+		{ "fast",		TEX_COMPRESS_BC_FAST },
+		{ "normal",		TEX_COMPRESS_BC_NORMAL },
+		{ "high",		TEX_COMPRESS_BC_HIGH },
+	};
+
+	struct SBenchFormat
+	{
+		const char*	name;
+		DXGI_FORMAT	format;
+	};
+
+	const SBenchFormat s_formats[] =
+	{
+		{ "BC1", DXGI_FORMAT_BC1_UNORM },
+		{ "BC3", DXGI_FORMAT_BC3_UNORM },
+	};
+
+	HRESULT LoadBenchImage(const wstring &path, ScratchImage &image)
+	{
+		WCHAR ext[_MAX_EXT];
+		_wsplitpath_s(path.c_str(), nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+
+		TexMetadata info;
+		if (_wcsicmp(ext, L".dds") == 0)
+			return LoadFromDDSFile(path.c_str(), DDS_FLAGS_NONE, &info, image);
+		if (_wcsicmp(ext, L".tga") == 0)
+			return LoadFromTGAFile(path.c_str(), &info, image);
+		return LoadFromWICFile(path.c_str(), WIC_FLAGS_NONE, &info, image);
+	}
+
+	// Top mip of the first item, as R8G8B8A8_UNORM.
+	HRESULT PrepareBenchImage(const ScratchImage &loaded, ScratchImage &source)
+	{
+		const Image* img = loaded.GetImage(0, 0, 0);
+		if (!img)
+			return E_FAIL;
+
+		ScratchImage decoded;
+		if (IsCompressed(img->format))
+		{
+			HRESULT hr = Decompress(*img, DXGI_FORMAT_R8G8B8A8_UNORM, decoded);
+			if (FAILED(hr))
+				return hr;
+			img = decoded.GetImage(0, 0, 0);
+		}
+
+		if (img->format == DXGI_FORMAT_R8G8B8A8_UNORM)
+			return source.InitializeFromImage(*img);
+		return Convert(*img, DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT, 0.5f, source);
+	}
+
+	// RGB root mean square error of the encoded image, in 0-255 steps.
+	double EncodedError(const Image &source, const ScratchImage &encoded)
+	{
+		ScratchImage decoded;
+		float mse = 0.f;
+		float mseV[4] = { 0.f, 0.f, 0.f, 0.f };
+		if (FAILED(Decompress(*encoded.GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, decoded))
+			|| FAILED(ComputeMSE(source, *decoded.GetImage(0, 0, 0), mse, mseV)))
+		{
+			return -1.0;
+		}
+		return sqrt((mseV[0] + mseV[1] + mseV[2]) / 3.0) * 255.0;
+	}
+}
+
+int RunBCBench(int argc, wchar_t* argv[])
+{
+	wstring sPath;
+	double seconds = 2.0;
+	for (int iArg = 2; iArg < argc; iArg++)
+	{
+		if (_wcsicmp(argv[iArg], L"-seconds") == 0 && iArg + 1 < argc)
+			seconds = _wtof(argv[++iArg]);
+		else if (sPath.empty())
+			sPath = argv[iArg];
+		else
+			sPath.clear();
+	}
+	if (sPath.empty() || seconds <= 0.0)
+	{
+		std::cout << " Usage: sctexconv -bcbench <image> [-seconds <n>]" << std::endl;
+		return 1;
+	}
+
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	ScratchImage loaded, source;
+	HRESULT hr = LoadBenchImage(sPath, loaded);
+	if (SUCCEEDED(hr))
+		hr = PrepareBenchImage(loaded, source);
+	if (FAILED(hr))
+	{
+		std::cout << " ERROR: cannot read the benchmark image (" << std::hex << hr << std::dec << ")" << std::endl;
+		return 1;
+	}
+
+	const Image& src = *source.GetImage(0, 0, 0);
+	const double megapixels = double(src.width) * double(src.height) / 1e6;
+	std::cout << " BC encoder benchmark: " << src.width << " x " << src.height << ", one thread, "
+			  << seconds << " s per tier" << std::endl;
+	std::cout << " format  quality       MP/s   speed-up   RGB RMSE" << std::endl;
+
+	for (const auto &fmt : s_formats)
+	{
+		double referenceRate = 0.0;
+		for (const auto &tier : s_tiers)
+		{
+			ScratchImage encoded;
+			size_t runs = 0;
+			long long start = IOTimestamp();
+			double elapsed = 0.0;
+			do
+			{
+				hr = Compress(src, fmt.format, tier.dwCompress, 0.5f, encoded);
+				runs++;
+				elapsed = IOSeconds(IOTimestamp() - start);
+			} while (SUCCEEDED(hr) && elapsed < seconds);
+
+			if (FAILED(hr))
+			{
+				std::cout << " " << fmt.name << "     " << tier.name << " FAILED (" << std::hex << hr << std::dec << ")" << std::endl;
+				continue;
+			}
+
+			double rate = megapixels * runs / elapsed;
+			if (tier.dwCompress == TEX_COMPRESS_DEFAULT)
+				referenceRate = rate;
+
+			std::cout << " " << std::left << std::setw(8) << fmt.name << std::setw(10) << tier.name << std::right
+					  << std::fixed << std::setprecision(2) << std::setw(10) << rate
+					  << std::setw(10) << (referenceRate > 0.0 ? rate / referenceRate : 0.0) << "x"
+					  << std::setw(11) << EncodedError(src, encoded) << std::endl;
+			std::cout.unsetf(std::ios::fixed);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// sctexconv.exe -bcbench <image> [-seconds <n>]
+// Encodes the top mip of the image to BC1 and BC3 with the reference encoder and each BC
+// quality tier on one thread, and prints megapixels per second and the RGB error of each.
+// Returns 0, or 1 if the image could not be read.
+int RunBCBench(int argc, wchar_t* argv[]);
@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------
+// File: Batch.cpp
+//
+// Job manifest and result file of the headless -batch mode.
+//--------------------------------------------------------------------------------------
+
+#include <Windows.h>
+#include <fstream>
+#include "Batch.h"
+#include "FileIO.h"
+#include "Timing.h"
+
+namespace
+{
+	// Next token of 'line' from 'pos': a "quoted string" or a run of non-blanks.
+	bool NextToken(const string &line, size_t &pos, string &token)
+	{
+		pos = line.find_first_not_of(" \t\r", pos);
+		if (pos == string::npos)
+			return false;
+
+		if (line[pos] == '"')
+		{
+			size_t end = line.find('"', pos + 1);
+			if (end == string::npos)
+				return false;
+			token = line.substr(pos + 1, end - pos - 1);
+			pos = end + 1;
+			return true;
+		}
+
+		size_t end = line.find_first_of(" \t\r", pos);
+		token = line.substr(pos, end == string::npos ? string::npos : end - pos);
+		pos = end;
+		return true;
+	}
+
+	bool ParseBool(const string &value, int &result)
+	{
+		if (value == "true")
+			result = 1;
+		else if (value == "false")
+			result = 0;
+		else
+			return false;
+		return true;
+	}
+
+	const char* RecordStatus(const SBatchRecord &record)
+	{
+		if (record.failures > 0)
+			return "failed";
+		return (record.bConverted ? "converted" : "skipped");
+	}
+}
+
+bool LoadBatchManifest(const string &path, vector<SBatchEntry> &entries, string &error)
+{
+	std::ifstream ifs(path);
+	if (!ifs)
+	{
+		error = "cannot open job manifest " + path;
+		return false;
+	}
+
+	string line;
+	int nLine = 0;
+	while (std::getline(ifs, line))
+	{
+		nLine++;
+		size_t pos = 0;
+		string token;
+		if (!NextToken(line, pos, token) || token[0] == '#')
+			continue;
+
+		SBatchEntry entry;
+		entry.nLine = nLine;
+		entry.sPath = token;
+
+		while (NextToken(line, pos, token))
+		{
+			size_t eq = token.find('=');
+			string key = token.substr(0, eq);
+			string value = (eq == string::npos ? "" : token.substr(eq + 1));
+
+			bool ok = !value.empty();
+			if (key == "format")
+				entry.sFileType = value;
+			else if (key == "pixel_format")
+				entry.sPixelFormat = value;
+			else if (key == "merge_gloss")
+				ok = ParseBool(value, entry.nMergeGloss);
+			else if (key == "recursive")
+				ok = ParseBool(value, entry.nRecursive);
+			else
+				ok = false;
+
+			if (!ok)
+			{
+				error = "line " + to_string(nLine) + ": '" + token + "' not recognized as a valid option";
+				return false;
+			}
+		}
+		entries.push_back(entry);
+	}
+
+	if (entries.empty())
+	{
+		error = "no entries in job manifest " + path;
+		return false;
+	}
+	return true;
+}
+
+bool SplitBatchTarget(const string &path, string &directory, string &pattern)
+{
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		directory = path;
+		pattern.clear();
+		return true;
+	}
+
+	size_t slash = path.find_last_of("\\/");
+	directory = (slash == string::npos ? "." : path.substr(0, slash));
+	pattern = path.substr(slash == string::npos ? 0 : slash + 1);
+	if (pattern.empty())
+		return false;
+
+	if (pattern.find_first_of("*?") != string::npos)
+	{
+		attributes = GetFileAttributesA(directory.c_str());
+		return (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY));
+	}
+	return (attributes != INVALID_FILE_ATTRIBUTES);
+}
+
+//--------------------------------------------------------------------------------------
+// CBatchResults
+//--------------------------------------------------------------------------------------
+void CBatchResults::Add(const SBatchRecord &record)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_records.push_back(record);
+}
+
+void CBatchResults::AddEntryError(size_t entry, const string &error)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entryErrors.push_back(make_pair(entry, error));
+}
+
+size_t CBatchResults::Textures() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_records.size();
+}
+
+size_t CBatchResults::Failed() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t failed = m_entryErrors.size();
+	for (const auto &record : m_records) { failed += (record.failures > 0 ? 1 : 0); }
+	return failed;
+}
+
+bool CBatchResults::Write(const string &path, const vector<SBatchEntry> &entries, int exitCode, double seconds) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Written beside 'path' and renamed onto it, like every other output.
+	string temp = TempPathFor(path);
+	std::ofstream json(temp, std::ofstream::out | std::ofstream::trunc);
+	if (!json)
+		return false;
+
+	size_t converted = 0, skipped = 0, failed = 0;
+	for (const auto &record : m_records)
+	{
+		if (record.failures > 0)
+			failed++;
+		else if (record.bConverted)
+			converted++;
+		else
+			skipped++;
+	}
+
+	json << "{\n  \"exitCode\": " << exitCode << ",\n  \"seconds\": " << seconds
+		 << ",\n  \"textures\": " << m_records.size() << ",\n  \"converted\": " << converted
+		 << ",\n  \"skipped\": " << skipped << ",\n  \"failed\": " << failed << ",\n  \"entries\": [\n";
+	for (size_t e = 0; e < entries.size(); e++)
+	{
+		size_t textures = 0, failures = 0;
+		for (const auto &record : m_records)
+		{
+			if (record.entry != e)
+				continue;
+			textures++;
+			failures += (record.failures > 0 ? 1 : 0);
+		}
+
+		json << "    { \"line\": " << entries[e].nLine << ", \"path\": " << JsonString(entries[e].sPath)
+			 << ", \"textures\": " << textures << ", \"failed\": " << failures << ", \"errors\": [";
+		bool bFirst = true;
+		for (const auto &err : m_entryErrors)
+		{
+			if (err.first != e)
+				continue;
+			json << (bFirst ? "" : ", ") << JsonString(err.second);
+			bFirst = false;
+		}
+		json << "] }" << (e + 1 < entries.size() ? ",\n" : "\n");
+	}
+
+	json << "  ],\n  \"results\": [\n";
+	for (size_t i = 0; i < m_records.size(); i++)
+	{
+		const SBatchRecord &r = m_records[i];
+		json << "    { \"entry\": " << r.entry << ", \"header\": " << JsonString(r.sHeader) << ", \"output\": " << JsonString(r.sOutput)
+			 << ", \"status\": \"" << RecordStatus(r) << "\", \"failures\": " << r.failures << ", \"seconds\": " << r.seconds << " }"
+			 << (i + 1 < m_records.size() ? ",\n" : "\n");
+	}
+	json << "  ]\n}\n";
+
+	// Closed before checking, so errors while writing out the buffer are seen too.
+	json.close();
+	if (json.fail() || !PublishFile(temp, path))
+	{
+		DiscardFile(temp);
+		return false;
+	}
+	return true;
+}
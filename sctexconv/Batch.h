@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Process exit codes of a -batch run.
+enum BATCH_EXIT
+{
+	BATCH_EXIT_OK = 0,
+	BATCH_EXIT_FAILED,			//  Some textures or manifest entries failed, the rest were converted.
+	BATCH_EXIT_USAGE,			//  Bad command line, or the job manifest could not be read.
+	BATCH_EXIT_CONFIG,			//  config.txt is invalid.
+	BATCH_EXIT_NO_FILES,		//  No entry found a single texture.
+	BATCH_EXIT_RESULT			//  Everything ran, but the result file could not be written.
+};
+
+// One line of a job manifest:
+//    <directory | file | pattern> [format=tif] [merge_gloss=true] [pixel_format=R8G8B8A8_UNORM] [recursive=false]
+// Paths with spaces go in double quotes. Options left out come from config.txt.
+struct SBatchEntry
+{
+	int		nLine;
+	string	sPath;
+	string	sFileType;			//  Empty = config.txt 'format'.
+	string	sPixelFormat;		//  DXGI format name without DXGI_FORMAT_, empty = by texture type. Normal
+								//  maps and masked textures keep their forced formats.
+	int		nMergeGloss;		//  -1 = config.txt, else 0 / 1.
+	int		nRecursive;			//  -1 = config.txt for directories, off for files and patterns.
+
+	SBatchEntry() : nLine(0), nMergeGloss(-1), nRecursive(-1) {}
+};
+
+// Returns false, with the offending line in 'error', if the manifest cannot be read or parsed.
+bool LoadBatchManifest(const string &path, vector<SBatchEntry> &entries, string &error);
+
+// Splits an entry path into the directory to crawl and a file name pattern (* and ?) for
+// the headers in it: empty for a directory, the name itself for a single file.
+// Returns false if neither the directory nor the file exists.
+bool SplitBatchTarget(const string &path, string &directory, string &pattern);
+
+// Outcome of one texture of a batch run.
+struct SBatchRecord
+{
+	size_t		entry;			//  Index into the manifest entries.
+	string		sHeader;
+	string		sOutput;
+	bool		bConverted;		//  False when skipped (unchanged, already converted, nothing to do).
+	int			failures;
+	double		seconds;
+};
+
+// Collects the records of every worker and writes them as JSON for the calling script.
+class CBatchResults
+{
+public:
+	CBatchResults() {}
+
+	void Add(const SBatchRecord &record);
+	void AddEntryError(size_t entry, const string &error);
+
+	size_t Textures() const;
+	size_t Failed() const;			//  Textures with failures, plus entry errors.
+
+	bool Write(const string &path, const vector<SBatchEntry> &entries, int exitCode, double seconds) const;
+
+private:
+	mutable std::mutex					m_mutex;
+	vector<SBatchRecord>				m_records;
+	vector<pair<size_t, string>>		m_entryErrors;
+
+	CBatchResults(const CBatchResults&);
+	CBatchResults& operator=(const CBatchResults&);
+};
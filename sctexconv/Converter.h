@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <d3d11.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <wrl\client.h>
+#include "directxtex.h"
+#include "OutputWriter.h"
+#include "Unsplit.h"
+
+using namespace std;
+
+struct SConversion
+{
+	WCHAR szSrc [MAX_PATH];
+	WCHAR szDest[MAX_PATH];
+};
+
+// Converter settings, the parsed form of the texconv style command line.
+struct SConvertSettings
+{
+	size_t		width;			//  -w, 0 = source width.
+	size_t		height;			//  -h, 0 = source height.
+	size_t		mipLevels;		//  -m, 0 = full chain.
+	DXGI_FORMAT	format;			//  -f, DXGI_FORMAT_UNKNOWN = source format.
+	DWORD		dwFilter;		//  -if
+	DWORD		dwSRGB;			//  -srgb / -srgbi / -srgbo
+	DWORD		dwCompress;		//  -bcuniform / -bcmax / -bcdither
+	DWORD		dwFilterOpts;	//  -sepalpha / -wrap / -mirror
+	DWORD		FileType;		//  -ft, CODEC_DDS / CODEC_TGA or a WICCodecs value.
+	DWORD		maxSize;		//  -fl
+	float		alphaWeight;	//  -aw
+	DWORD		dwNormalMap;	//  -nmap, CNMAP_* flags.
+	float		nmapAmplitude;	//  -nmapamp
+	DWORD64		dwOptions;		//  One bit per OPT_* given.
+	wstring		sOutputDir;		//  -o
+	wstring		sPrefix;		//  -px
+	wstring		sSuffix;		//  -sx
+	wstring		sExtension;		//  ".tif", ".dds"... follows FileType.
+
+	SConvertSettings();
+};
+
+// One texture for CConverterContext::Convert. Anything left at its default uses the
+// context's settings.
+struct SConvertJob
+{
+	string				sSource;
+	string				sOutputDir;
+	DXGI_FORMAT			format;			//  Pixel format before compression / saving.
+	DWORD				dwNormalMap;	//  CNMAP_* flags: build a normal map from the source.
+	float				nmapAmplitude;
+	const SSplitSource*	split;			//  Read the fragments directly instead of sSource.
+	DirectX::ScratchImage* result;		//  Hand the converted image back instead of saving it.
+	bool				bTiled;			//  Strip at a time where possible (-tiled), to save memory.
+	vector<SEncodedFile>* outputs;		//  Encode the output file in memory and add it here, for the writer stage.
+
+	SConvertJob() : format(DXGI_FORMAT_UNKNOWN), dwNormalMap(0), nmapAmplitude(1.f), split(nullptr), result(nullptr), bTiled(false),
+					outputs(nullptr) {}
+};
+
+// Long lived converter: options are parsed once, COM is initialised once per worker
+// thread and the DirectCompute device (BC6H / BC7 only) is created once and shared.
+// Convert may be called from several threads at once.
+class CConverterContext
+{
+public:
+	CConverterContext() : m_activeRuns(0) {}
+
+	// texconv style options. Any file names among them are added to 'files'.
+	bool SetOptions(int argc, wchar_t* argv[], std::list<SConversion> &files, std::string &logfile, int &failcount);
+	bool SetFileType(const string &fileType);
+	void SetTiled(bool bTiled);			//  As -tiled.
+	void SetBCQuality(DWORD dwQuality);	//  TEX_COMPRESS_BC_* tier of the BC1-3 color encoder, 0 = reference.
+	const SConvertSettings& Settings() const { return m_settings; }
+
+	// Returns 0 when the texture was processed (failures are counted in 'failcount'),
+	// 1 when converting had to stop altogether.
+	int Convert(const SConvertJob &job, std::string &logfile, int &failcount);
+	int Convert(std::list<SConversion> &files, std::string &logfile, int &failcount,
+				const SSplitSource *split = nullptr, DirectX::ScratchImage *result = nullptr);
+
+	// Whether Convert would run 'job' strip at a time, judged from the source header 'info'.
+	// For the memory planner, which has to reserve the whole-image footprint otherwise.
+	bool WouldTile(const SConvertJob &job, const DirectX::TexMetadata &info);
+
+private:
+	SConvertSettings JobSettings(const SConvertJob &job) const;
+	bool CanTile(const SConvertSettings &settings, const DirectX::TexMetadata &info, DXGI_FORMAT tformat,
+				 size_t twidth, size_t theight, size_t tMips);
+	int Run(const SConvertSettings &settings, std::list<SConversion> &conversion, std::string &logfile, int &failcount,
+			const SSplitSource *split, DirectX::ScratchImage *result, vector<SEncodedFile> *outputs);
+	ID3D11Device* ComputeDevice(bool bAllowGpu);
+
+	SConvertSettings						m_settings;
+	std::once_flag							m_deviceOnce;
+	Microsoft::WRL::ComPtr<ID3D11Device>	m_device;
+	std::mutex								m_deviceMutex;		//  One GPU compress at a time on the immediate context.
+	std::atomic<unsigned>					m_activeRuns;		//  Convert calls in progress, to share the cores between their strips.
+
+	CConverterContext(const CConverterContext&);
+	CConverterContext& operator=(const CConverterContext&);
+};
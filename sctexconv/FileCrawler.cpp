@@ -0,0 +1,207 @@
+//--------------------------------------------------------------------------------------
+// File: FileCrawler.cpp
+//
+// Multi-threaded directory walk feeding the converter through a bounded queue.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <Shlwapi.h>
+#include "FileCrawler.h"
+#include "FileIO.h"
+
+#pragma comment(lib, "Shlwapi.lib")
+
+CFileCrawler::CFileCrawler(CFileIndex &index, CBoundedQueue<string> &headers, bool isRecursive)
+	: m_index(index)
+	, m_headers(headers)
+	, m_isRecursive(isRecursive)
+	, m_busy(0)
+	, m_cancel(false)
+	, m_running(0)
+	, m_discovered(0)
+	, m_finished(false)
+{
+}
+
+CFileCrawler::~CFileCrawler()
+{
+	Cancel();
+	Wait();
+}
+
+void CFileCrawler::Start(const string &rootDir, size_t threadCount)
+{
+	string dir = rootDir;
+	if (!dir.empty() && dir[dir.length() - 1] != '\\')
+		dir += "\\";
+
+	if (threadCount == 0)
+	{
+		// Listing is latency bound, so run more threads than cores - but not unbounded.
+		threadCount = std::min<size_t>(std::max<size_t>(std::thread::hardware_concurrency() * 2, 2), 16);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending.push_back(dir);
+	}
+
+	m_running = threadCount;
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&CFileCrawler::Worker, this));
+	}
+}
+
+void CFileCrawler::Cancel()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cancel = true;
+	}
+	m_cv.notify_all();
+	m_headers.Close();
+}
+
+void CFileCrawler::Wait()
+{
+	for (auto &t : m_threads)
+	{
+		if (t.joinable())
+			t.join();
+	}
+	m_threads.clear();
+}
+
+void CFileCrawler::TakeErrors(vector<string> &errors)
+{
+	std::lock_guard<std::mutex> lock(m_errorMutex);
+	errors.insert(errors.end(), m_errors.begin(), m_errors.end());
+	m_errors.clear();
+}
+
+void CFileCrawler::AddError(const string &error)
+{
+	std::lock_guard<std::mutex> lock(m_errorMutex);
+	m_errors.push_back(error);
+}
+
+void CFileCrawler::Worker()
+{
+	for (;;)
+	{
+		string dir;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this] { return m_cancel || !m_pending.empty() || m_busy == 0; });
+
+			if (m_cancel || m_pending.empty())
+				break;		// Cancelled, or nothing pending and nobody left to produce more.
+
+			dir = m_pending.back();
+			m_pending.pop_back();
+			m_busy++;
+		}
+
+		ListDirectory(dir);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busy--;
+		}
+		m_cv.notify_all();
+	}
+
+	// Last worker out closes the queue so the consumer sees the end of the stream.
+	if (--m_running == 0)
+	{
+		m_finished = true;
+		m_headers.Close();
+	}
+}
+
+void CFileCrawler::ListDirectory(const string &dir)
+{
+	// Three characters are for the "\*" plus NULL.
+	if (dir.length() > (MAX_PATH - 3))
+	{
+		AddError("\n FILE SEARCH ERROR: Directory path is too long - " + dir + "\n");
+		return;
+	}
+
+	WIN32_FIND_DATAA ffd;
+	string search = dir + "*";
+	HANDLE hFind = FindFirstFileExA(search.c_str(), FindExInfoBasic, &ffd, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+
+	if (INVALID_HANDLE_VALUE == hFind)
+	{
+		AddError("\n FILE SEARCH ERROR: FindFirstFile() returned an error in: " + dir + "\n");
+		return;
+	}
+
+	CFileIndex::FileList files;
+	vector<string> headers;
+	vector<string> subdirs;
+
+	do
+	{
+		string sName = ffd.cFileName;
+
+		if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (m_isRecursive && sName != "." && sName != "..")
+			{
+				subdirs.push_back(dir + sName + "\\");
+			}
+		}
+		else if ((ffd.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)) == 0)
+		{
+			SFileStamp stamp;
+			stamp.size  = ((unsigned long long)ffd.nFileSizeHigh << 32) | ffd.nFileSizeLow;
+			stamp.mtime = ((unsigned long long)ffd.ftLastWriteTime.dwHighDateTime << 32) | ffd.ftLastWriteTime.dwLowDateTime;
+			files.push_back(make_pair(sName, stamp));
+
+			if (IsHeaderFragment(sName) && (m_filter.empty() || PathMatchSpecA(sName.c_str(), m_filter.c_str())))
+			{
+				headers.push_back(dir + sName);
+			}
+		}
+	} while (FindNextFileA(hFind, &ffd));
+
+	FindClose(hFind);
+
+	if (!subdirs.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pending.insert(m_pending.end(), subdirs.rbegin(), subdirs.rend());
+		}
+		m_cv.notify_all();
+	}
+
+	// The whole directory is indexed before any of its headers reach the converter.
+	m_index.AddDirectory(dir, files);
+
+	for (auto &header : headers)
+	{
+		m_discovered++;
+		if (!m_headers.Push(header))
+			return;		// Queue closed - the consumer has stopped.
+	}
+}
+
+bool IsHeaderFragment(const string &fileName)
+{
+	if (fileName.length() < 3)
+		return false;
+
+	if (fileName.find("_cm") != string::npos)	// Ignore cubemaps
+		return false;
+
+	if (fileName.find(PARTIAL_TAG) != string::npos)	// Left behind by an interrupted run
+		return false;
+
+	size_t len = fileName.length();
+	return (fileName.find(".dds.0") != string::npos)
+		|| (fileName[len - 1] == 's' && fileName[len - 2] == 'd' && fileName[len - 3] == 'd');
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FileIndex.h"
+#include "WorkQueue.h"
+
+using namespace std;
+
+// Header paths buffered between the crawler and the converter. Scanning runs this far ahead.
+const size_t CRAWL_QUEUE_DEPTH = 4096;
+
+// Parallel directory walker. Idle threads take the next pending directory from a shared
+// stack, list it once into the index, push its subdirectories back onto the stack and
+// stream its DDS header fragments into 'headers' as soon as the listing is complete.
+// The header queue is closed when the whole tree has been walked (or on Cancel).
+class CFileCrawler
+{
+public:
+	CFileCrawler(CFileIndex &index, CBoundedQueue<string> &headers, bool isRecursive);
+	~CFileCrawler();
+
+	// Before Start: queue only the headers whose file name matches 'pattern' (* and ?). Empty = all.
+	void SetFilter(const string &pattern) { m_filter = pattern; }
+	void Start(const string &rootDir, size_t threadCount = 0);	// 0 = pick from the core count.
+	void Cancel();
+	void Wait();
+
+	size_t Discovered() const { return m_discovered; }		//  Header fragments queued so far.
+	bool IsFinished() const { return m_finished; }
+
+	// Errors are collected here and logged by the caller's thread.
+	void TakeErrors(vector<string> &errors);
+
+private:
+	void Worker();
+	void ListDirectory(const string &dir);
+	void AddError(const string &error);
+
+	CFileIndex&					m_index;
+	CBoundedQueue<string>&		m_headers;
+	bool						m_isRecursive;
+	string						m_filter;
+
+	std::mutex					m_mutex;
+	std::condition_variable		m_cv;
+	vector<string>				m_pending;		//  Directories waiting to be listed (LIFO = depth first).
+	size_t						m_busy;			//  Workers currently listing a directory.
+	bool						m_cancel;
+
+	vector<std::thread>			m_threads;
+	std::atomic<size_t>			m_running;
+	std::atomic<size_t>			m_discovered;
+	std::atomic<bool>			m_finished;
+
+	std::mutex					m_errorMutex;
+	vector<string>				m_errors;
+
+	CFileCrawler(const CFileCrawler&);
+	CFileCrawler& operator=(const CFileCrawler&);
+};
+
+// True for file names the converter treats as a texture header: *.dds and *.dds.0, no cubemaps.
+bool IsHeaderFragment(const string &fileName);
@@ -0,0 +1,380 @@
+//--------------------------------------------------------------------------------------
+// File: FileIO.cpp
+//
+// Bulk and memory-mapped file I/O for the Unsplit reassembly path.
+//--------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdio>
+#include "FileIO.h"
+
+namespace
+{
+	std::atomic<unsigned long long>	s_bytesRead(0);
+	std::atomic<unsigned long long>	s_bytesWritten(0);
+	std::atomic<long long>			s_ioTicks(0);
+
+	long long QpcFrequency()
+	{
+		static long long s_freq = 0;
+		if (!s_freq)
+		{
+			LARGE_INTEGER freq;
+			s_freq = QueryPerformanceFrequency(&freq) ? freq.QuadPart : 1;
+		}
+		return s_freq;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// CMappedFile
+//--------------------------------------------------------------------------------------
+bool CMappedFile::Open(const string &path)
+{
+	Close();
+
+	m_hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+						  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_hFile, &fileSize) || (unsigned long long)fileSize.QuadPart > SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+	m_size = (size_t)fileSize.QuadPart;
+
+	// Zero length files cannot be mapped, but are still valid (empty) inputs.
+	if (m_size == 0)
+		return true;
+
+	m_hMap = CreateFileMapping(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_hMap)
+	{
+		Close();
+		return false;
+	}
+
+	m_pView = (const unsigned char*)MapViewOfFile(m_hMap, FILE_MAP_READ, 0, 0, 0);
+	if (!m_pView)
+	{
+		Close();
+		return false;
+	}
+
+	s_bytesRead += m_size;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if (m_pView)
+	{
+		UnmapViewOfFile(m_pView);
+		m_pView = nullptr;
+	}
+	if (m_hMap)
+	{
+		CloseHandle(m_hMap);
+		m_hMap = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+//--------------------------------------------------------------------------------------
+// COutFile
+//--------------------------------------------------------------------------------------
+bool COutFile::Create(const string &path)
+{
+	Close();
+
+	m_hFile = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+						  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	m_written = 0;
+	m_positional = false;
+
+	return (m_hFile != INVALID_HANDLE_VALUE);
+}
+
+bool COutFile::CreateSized(const string &path, unsigned long long size)
+{
+	Close();
+
+	m_hFile = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+						  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(m_hFile, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_hFile))
+	{
+		Close();
+		return false;
+	}
+
+	m_written = size;
+	m_positional = true;
+	return true;
+}
+
+bool COutFile::WriteAt(unsigned long long offset, const void* data, size_t size)
+{
+	if (m_hFile == INVALID_HANDLE_VALUE || !m_positional)
+		return false;
+
+	HANDLE hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (!hEvent)
+		return false;
+
+	const unsigned char* ptr = (const unsigned char*)data;
+	bool ok = true;
+	while (ok && size > 0)
+	{
+		DWORD chunk = (size > IO_BLOCK_SIZE) ? IO_BLOCK_SIZE : (DWORD)size;
+		DWORD bytesWritten = 0;
+
+		OVERLAPPED ov = {};
+		ov.Offset	  = (DWORD)(offset & 0xFFFFFFFF);
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+		ov.hEvent	  = hEvent;
+
+		if (!WriteFile(m_hFile, ptr, chunk, nullptr, &ov) && GetLastError() != ERROR_IO_PENDING)
+			ok = false;
+		else if (!GetOverlappedResult(m_hFile, &ov, &bytesWritten, TRUE) || bytesWritten != chunk)
+			ok = false;
+
+		ptr		+= chunk;
+		size	-= chunk;
+		offset	+= chunk;
+		s_bytesWritten += bytesWritten;
+	}
+
+	CloseHandle(hEvent);
+	return ok;
+}
+
+bool COutFile::AppendAt(unsigned long long offset, const string &path, unsigned long long srcOffset, unsigned long long size)
+{
+	CMappedFile src;
+	if (!src.Open(path) || srcOffset > src.Size())
+		return false;
+
+	// The slot was planned from an earlier size; a file that changed since would spill into the next one.
+	if (src.Size() - srcOffset != size)
+		return false;
+
+	return WriteAt(offset, src.Data() + srcOffset, (size_t)size);
+}
+
+bool COutFile::Write(const void* data, size_t size)
+{
+	if (m_hFile == INVALID_HANDLE_VALUE || m_positional)
+		return false;
+
+	const unsigned char* ptr = (const unsigned char*)data;
+	while (size > 0)
+	{
+		DWORD chunk = (size > IO_BLOCK_SIZE) ? IO_BLOCK_SIZE : (DWORD)size;
+		DWORD bytesWritten = 0;
+
+		if (!WriteFile(m_hFile, ptr, chunk, &bytesWritten, nullptr) || bytesWritten != chunk)
+			return false;
+
+		ptr			+= chunk;
+		size		-= chunk;
+		m_written	+= chunk;
+		s_bytesWritten += chunk;
+	}
+	return true;
+}
+
+bool COutFile::Append(const string &path, unsigned long long offset)
+{
+	CMappedFile src;
+	if (!src.Open(path) || offset > src.Size())
+		return false;
+
+	return Write(src.Data() + offset, src.Size() - (size_t)offset);
+}
+
+void COutFile::Close()
+{
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_positional = false;
+}
+
+//--------------------------------------------------------------------------------------
+// Whole-file (or leading maxBytes) read in IO_BLOCK_SIZE chunks.
+//--------------------------------------------------------------------------------------
+bool ReadFileBytes(const string &path, std::vector<unsigned char> &data, size_t maxBytes, unsigned long long *fileSize)
+{
+	data.clear();
+	if (fileSize)
+		*fileSize = 0;
+
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || (unsigned long long)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+	if (fileSize)
+		*fileSize = (unsigned long long)size.QuadPart;
+
+	size_t wanted = (size_t)size.QuadPart;
+	if (maxBytes > 0 && maxBytes < wanted)
+		wanted = maxBytes;
+
+	data.resize(wanted);
+
+	size_t offset = 0;
+	while (offset < data.size())
+	{
+		size_t remain = data.size() - offset;
+		DWORD chunk = (remain > IO_BLOCK_SIZE) ? IO_BLOCK_SIZE : (DWORD)remain;
+		DWORD bytesRead = 0;
+
+		if (!ReadFile(hFile, &data[offset], chunk, &bytesRead, nullptr) || bytesRead == 0)
+			break;
+
+		offset += bytesRead;
+	}
+	CloseHandle(hFile);
+
+	data.resize(offset);
+	s_bytesRead += offset;
+
+	return (offset == wanted);
+}
+
+//--------------------------------------------------------------------------------------
+// File operations
+//--------------------------------------------------------------------------------------
+namespace
+{
+	bool CopyAcrossVolumes(const string &from, const string &to)
+	{
+		string temp = TempPathFor(to);
+
+		COutFile fout;
+		bool ok = fout.Create(temp) && fout.Append(from);
+		fout.Close();
+
+		if (!ok || !PublishFile(temp, to))
+		{
+			DiscardFile(temp);
+			return false;
+		}
+		return true;
+	}
+}
+
+bool MovePath(const string &from, const string &to)
+{
+	if (MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING))
+		return true;
+
+	if (GetLastError() != ERROR_NOT_SAME_DEVICE)
+		return false;
+
+	return CopyAcrossVolumes(from, to) && DeleteFileA(from.c_str());
+}
+
+bool LinkOrCopyPath(const string &from, const string &to)
+{
+	// The link goes to the temp name too, so an existing 'to' is only replaced once it worked.
+	string temp = TempPathFor(to);
+	DiscardFile(temp);
+	if (CreateHardLinkA(temp.c_str(), from.c_str(), nullptr))
+	{
+		if (PublishFile(temp, to))
+			return true;
+		DiscardFile(temp);
+		return false;
+	}
+
+	return CopyAcrossVolumes(from, to);
+}
+
+string TempPathFor(const string &path)
+{
+	size_t slash = path.find_last_of("\\/");
+	size_t dot = path.rfind('.');
+
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return path + PARTIAL_TAG;
+
+	return path.substr(0, dot) + PARTIAL_TAG + path.substr(dot);
+}
+
+bool PublishFile(const string &temp, const string &path)
+{
+	return MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+void DiscardFile(const string &temp)
+{
+	DeleteFileA(temp.c_str());
+}
+
+//--------------------------------------------------------------------------------------
+// I/O statistics
+//--------------------------------------------------------------------------------------
+long long IOTimestamp()
+{
+	LARGE_INTEGER now;
+	return QueryPerformanceCounter(&now) ? now.QuadPart : 0;
+}
+
+double IOSeconds(long long ticks)
+{
+	return double(ticks) / double(QpcFrequency());
+}
+
+void AddIOStats(unsigned long long bytesRead, unsigned long long bytesWritten, long long ticks)
+{
+	s_bytesRead += bytesRead;
+	s_bytesWritten += bytesWritten;
+	s_ioTicks += ticks;
+}
+
+SIOStats GetIOStats()
+{
+	SIOStats stats;
+	stats.bytesRead = s_bytesRead;
+	stats.bytesWritten = s_bytesWritten;
+	stats.seconds = IOSeconds(s_ioTicks);
+	return stats;
+}
+
+double ThroughputMBs(unsigned long long bytes, double seconds)
+{
+	if (seconds <= 0.0)
+		return 0.0;
+
+	return (double(bytes) / (1024.0 * 1024.0)) / seconds;
+}
+
+string FormatThroughput(unsigned long long bytes, double seconds)
+{
+	char buffer[64];
+	sprintf_s(buffer, "%.2f MB @ %.1f MB/s", double(bytes) / (1024.0 * 1024.0), ThroughputMBs(bytes, seconds));
+	return string(buffer);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Size of each ReadFile / WriteFile call. Large enough that the per-call
+// overhead disappears, small enough to stay under the 4GB DWORD limit.
+const DWORD IO_BLOCK_SIZE = 16 * 1024 * 1024;
+
+// Running totals for the Unsplit read/write path (used for MB/s reporting).
+struct SIOStats
+{
+	unsigned long long	bytesRead;
+	unsigned long long	bytesWritten;
+	double				seconds;		//  Wall time spent inside timed I/O sections.
+};
+
+// Read-only memory-mapped view of a whole file.
+class CMappedFile
+{
+public:
+	CMappedFile() : m_hFile(INVALID_HANDLE_VALUE), m_hMap(nullptr), m_pView(nullptr), m_size(0) {}
+	~CMappedFile() { Close(); }
+
+	bool Open(const string &path);
+	void Close();
+
+	const unsigned char* Data() const { return m_pView; }
+	size_t Size() const { return m_size; }
+
+private:
+	HANDLE					m_hFile;
+	HANDLE					m_hMap;
+	const unsigned char*	m_pView;
+	size_t					m_size;
+
+	CMappedFile(const CMappedFile&);
+	CMappedFile& operator=(const CMappedFile&);
+};
+
+// Output file written in large blocks straight through the Win32 API.
+// CreateSized opens the file for positional writes instead: its final size is set up front
+// and WriteAt / AppendAt may then be called from several threads at once.
+class COutFile
+{
+public:
+	COutFile() : m_hFile(INVALID_HANDLE_VALUE), m_written(0), m_positional(false) {}
+	~COutFile() { Close(); }
+
+	bool Create(const string &path);
+	bool Write(const void* data, size_t size);
+	bool Append(const string &path, unsigned long long offset = 0);	// Copies 'path' from 'offset' to its end onto the end of this file.
+
+	bool CreateSized(const string &path, unsigned long long size);
+	bool WriteAt(unsigned long long offset, const void* data, size_t size);
+	bool AppendAt(unsigned long long offset, const string &path, unsigned long long srcOffset, unsigned long long size);	// Fails unless 'path' holds exactly 'size' bytes from 'srcOffset'.
+
+	void Close();
+
+	bool IsOpen() const { return m_hFile != INVALID_HANDLE_VALUE; }
+	unsigned long long BytesWritten() const { return m_written; }
+
+private:
+	HANDLE				m_hFile;
+	unsigned long long	m_written;
+	bool				m_positional;
+
+	COutFile(const COutFile&);
+	COutFile& operator=(const COutFile&);
+};
+
+// Reads the whole file, or only its first maxBytes when maxBytes > 0.
+bool ReadFileBytes(const string &path, std::vector<unsigned char> &data, size_t maxBytes = 0, unsigned long long *fileSize = nullptr);
+
+// File operations. Same-volume moves are a rename and same-volume copies a hard link;
+// data is only copied (in IO_BLOCK_SIZE blocks) when the two paths are on different volumes.
+const string PARTIAL_TAG = ".partial";
+
+bool MovePath(const string &from, const string &to);			// Replaces 'to' if it exists.
+bool LinkOrCopyPath(const string &from, const string &to);		// Keeps 'from'; 'to' is only replaced on success.
+
+// Outputs are written to TempPathFor(path) and only renamed onto 'path' once complete,
+// so an interrupted run never leaves a truncated file under the real name.
+string TempPathFor(const string &path);		// "dir\name.ext" -> "dir\name.partial.ext"
+bool PublishFile(const string &temp, const string &path);
+void DiscardFile(const string &temp);
+
+// I/O timing and throughput counters
+long long IOTimestamp();
+double IOSeconds(long long ticks);
+void AddIOStats(unsigned long long bytesRead, unsigned long long bytesWritten, long long ticks);
+SIOStats GetIOStats();
+double ThroughputMBs(unsigned long long bytes, double seconds);
+string FormatThroughput(unsigned long long bytes, double seconds);
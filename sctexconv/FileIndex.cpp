@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------------
+// File: FileIndex.cpp
+//
+// In-memory index of split DDS fragment sets, built from one directory walk.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cctype>
+#include "FileIndex.h"
+
+namespace
+{
+	string ToLower(string s)
+	{
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)tolower(c); });
+		return s;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// SFragmentSet
+//--------------------------------------------------------------------------------------
+const SFileStamp* SFragmentSet::Find(const string &suffix) const
+{
+	auto it = files.find(ToLower(suffix));
+	return (it != files.end()) ? &it->second : nullptr;
+}
+
+unsigned long long SFragmentSet::SizeOf(const string &suffix) const
+{
+	const SFileStamp* stamp = Find(suffix);
+	return stamp ? stamp->size : 0;
+}
+
+void SFragmentSet::Rename(const string &oldSuffix, const string &newSuffix)
+{
+	auto it = files.find(ToLower(oldSuffix));
+	if (it == files.end())
+		return;
+
+	SFileStamp stamp = it->second;
+	files.erase(it);
+	files[ToLower(newSuffix)] = stamp;
+}
+
+void SFragmentSet::Remove(const string &suffix)
+{
+	files.erase(ToLower(suffix));
+}
+
+//--------------------------------------------------------------------------------------
+// CFileIndex
+//--------------------------------------------------------------------------------------
+void CFileIndex::AddDirectory(const string &directory, const FileList &files)
+{
+	string baseName, suffix;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto &file : files)
+	{
+		SplitFragmentName(file.first, baseName, suffix);
+
+		SFragmentSet &set = m_sets[ToLower(directory + baseName)];
+		if (set.sBaseName.empty())
+		{
+			set.sDirectory = directory;
+			set.sBaseName = baseName;
+		}
+
+		set.files[ToLower(suffix)] = file.second;
+	}
+
+	m_fileCount += files.size();
+	m_dirCount++;
+}
+
+SFragmentSet* CFileIndex::FindSet(const string &directory, const string &baseName)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_sets.find(ToLower(directory + baseName));
+	return (it != m_sets.end()) ? &it->second : nullptr;
+}
+
+const SFileStamp* CFileIndex::FindFile(const string &path) const
+{
+	size_t slash = path.find_last_of("\\/");
+	string directory = (slash == string::npos) ? "" : path.substr(0, slash + 1);
+	string fileName = (slash == string::npos) ? path : path.substr(slash + 1);
+
+	string baseName, suffix;
+	SplitFragmentName(fileName, baseName, suffix);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_sets.find(ToLower(directory + baseName));
+	return (it != m_sets.end()) ? it->second.Find(suffix) : nullptr;
+}
+
+void CFileIndex::Claim(const SFragmentSet *fragments)
+{
+	if (!fragments)
+		return;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_released.wait(lock, [this, fragments] { return m_claimed.find(fragments) == m_claimed.end(); });
+	m_claimed.insert(fragments);
+}
+
+void CFileIndex::Release(const SFragmentSet *fragments)
+{
+	if (!fragments)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_claimed.erase(fragments);
+	}
+	m_released.notify_all();
+}
+
+size_t CFileIndex::FileCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_fileCount;
+}
+
+size_t CFileIndex::DirectoryCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_dirCount;
+}
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+void SplitFragmentName(const string &fileName, string &baseName, string &suffix)
+{
+	size_t pos = ToLower(fileName).rfind(".dds");
+	if (pos == string::npos)
+	{
+		baseName = fileName;
+		suffix = "";
+		return;
+	}
+
+	baseName = fileName.substr(0, pos + 4);
+	suffix = fileName.substr(pos + 4);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Windows.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Size and last-write time of one file, as reported by the directory listing.
+struct SFileStamp
+{
+	unsigned long long	size;
+	unsigned long long	mtime;		//  FILETIME as a 64-bit count of 100ns ticks.
+};
+
+// Every file in one directory that shares a base name, keyed by the suffix after it.
+// For base "rock.dds": "" (header), ".0", ".1" ... ".12", ".a", ".0a", ".1a" ...
+struct SFragmentSet
+{
+	string					sDirectory;		//  Directory path including the trailing '\'
+	string					sBaseName;		//  Base name as found on disk, e.g. "rock.dds"
+	map<string, SFileStamp>	files;			//  Lower case suffix -> stamp
+
+	const SFileStamp* Find(const string &suffix) const;
+	bool Has(const string &suffix) const { return Find(suffix) != nullptr; }
+	unsigned long long SizeOf(const string &suffix) const;		// 0 if the fragment does not exist.
+
+	// Keep the set in step with renames / deletes made while processing it.
+	void Rename(const string &oldSuffix, const string &newSuffix);
+	void Remove(const string &suffix);
+};
+
+// Snapshot of the target tree. Filled one directory at a time by the crawler threads
+// while the converter is already reading it, so every access takes the lock.
+class CFileIndex
+{
+public:
+	typedef vector<pair<string, SFileStamp>> FileList;		//  File name + stamp, one directory listing
+
+	CFileIndex() : m_fileCount(0), m_dirCount(0) {}
+
+	void AddDirectory(const string &directory, const FileList &files);
+
+	SFragmentSet* FindSet(const string &directory, const string &baseName);
+	const SFileStamp* FindFile(const string &path) const;
+
+	// Exclusive use of one fragment set by a pipeline worker. Claim blocks while another
+	// worker holds the set; both accept nullptr and then do nothing.
+	void Claim(const SFragmentSet *fragments);
+	void Release(const SFragmentSet *fragments);
+
+	size_t FileCount() const;
+	size_t DirectoryCount() const;
+
+private:
+	mutable std::mutex			m_mutex;
+	map<string, SFragmentSet>	m_sets;		//  Lower case directory + base name -> fragments
+	set<const SFragmentSet*>	m_claimed;
+	std::condition_variable		m_released;
+	size_t						m_fileCount;
+	size_t						m_dirCount;
+
+	CFileIndex(const CFileIndex&);
+	CFileIndex& operator=(const CFileIndex&);
+};
+
+// Splits "rock.dds.2a" into base "rock.dds" and suffix ".2a". Names without ".dds" have an empty suffix.
+void SplitFragmentName(const string &fileName, string &baseName, string &suffix);
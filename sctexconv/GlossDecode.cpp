@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------
+// File: GlossDecode.cpp
+//
+// In-process BC4 / ATI1 decoding for gloss and mask-alpha maps, so they no longer
+// need a round trip through nvdecompress.exe and a TGA file.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "directxtexp.h"
+#include "BC.h"
+#include "DDS.h"
+#include "GlossDecode.h"
+#include "FileIO.h"
+#include "Timing.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const size_t BC4_BLOCK_SIZE = 8;
+
+	bool IsBC4(const DDS_HEADER &header, const std::vector<unsigned char> &file, size_t &offset)
+	{
+		uint32_t fourcc = header.ddspf.dwFourCC;
+		if (fourcc == MAKEFOURCC('A', 'T', 'I', '1') || fourcc == MAKEFOURCC('B', 'C', '4', 'U'))
+			return true;
+
+		if (fourcc != MAKEFOURCC('D', 'X', '1', '0') || file.size() < offset + sizeof(DDS_HEADER_DXT10))
+			return false;
+
+		DDS_HEADER_DXT10 ext;
+		memcpy(&ext, &file[offset], sizeof(ext));
+		offset += sizeof(ext);
+		return (ext.dxgiFormat == DXGI_FORMAT_BC4_UNORM || ext.dxgiFormat == DXGI_FORMAT_BC4_TYPELESS);
+	}
+}
+
+HRESULT DecodeGlossMap(const string &path, ScratchImage &image)
+{
+	std::vector<unsigned char> file;
+	CStageClock loadClock(STAGE_LOAD, path, nullptr);
+	if (!ReadFileBytes(path, file))
+		return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+	loadClock.SetInputBytes(file.size());
+	loadClock.Done(file.size(), 0);
+
+	// Headers cut from split files can lack the magic word (see GetFileData).
+	size_t offset = 0;
+	uint32_t magic = 0;
+	if (file.size() >= sizeof(magic))
+	{
+		memcpy(&magic, file.data(), sizeof(magic));
+		offset = (magic == DDS_MAGIC) ? sizeof(magic) : 0;
+	}
+
+	if (file.size() < offset + sizeof(DDS_HEADER))
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+	DDS_HEADER header;
+	memcpy(&header, &file[offset], sizeof(header));
+	offset += sizeof(header);
+
+	if (!IsBC4(header, file, offset))
+		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+	size_t width = header.dwWidth;
+	size_t height = header.dwHeight;
+	size_t blocksWide = std::max<size_t>(1, (width + 3) / 4);
+	size_t blocksHigh = std::max<size_t>(1, (height + 3) / 4);
+	if (!width || !height || (file.size() - offset) < blocksWide * blocksHigh * BC4_BLOCK_SIZE)
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+	CStageClock decodeClock(STAGE_DECOMPRESS, path, nullptr);
+	decodeClock.SetInputBytes(blocksWide * blocksHigh * BC4_BLOCK_SIZE);
+
+	HRESULT hr = image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1);
+	if (FAILED(hr))
+		return hr;
+
+	const Image* img = image.GetImage(0, 0, 0);
+	const uint8_t* pBC = &file[offset];
+	XMVECTOR block[NUM_PIXELS_PER_BLOCK];
+
+	for (size_t by = 0; by < blocksHigh; by++)
+	{
+		for (size_t bx = 0; bx < blocksWide; bx++, pBC += BC4_BLOCK_SIZE)
+		{
+			D3DXDecodeBC4U(block, pBC);
+
+			for (size_t py = 0; py < 4 && (by * 4 + py) < height; py++)
+			{
+				uint8_t* dst = img->pixels + (by * 4 + py) * img->rowPitch + bx * 16;
+				for (size_t px = 0; px < 4 && (bx * 4 + px) < width; px++, dst += 4)
+				{
+					float value = XMVectorGetX(XMVectorSaturate(block[py * 4 + px]));
+					dst[0] = dst[1] = dst[2] = (uint8_t)(value * 255.f + 0.5f);
+					dst[3] = 255;
+				}
+			}
+		}
+	}
+	decodeClock.Done(&image);
+	return S_OK;
+}
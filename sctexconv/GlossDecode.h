@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include "directxtex.h"
+
+using namespace std;
+
+// Decodes the top mip of a CIG gloss / mask-alpha map (BC4 or ATI1, with or without the
+// "DDS " magic word) to R8G8B8A8_UNORM, with the gloss value in R, G and B.
+// Returns HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) for any other format.
+HRESULT DecodeGlossMap(const string &path, DirectX::ScratchImage &image);
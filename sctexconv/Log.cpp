@@ -0,0 +1,258 @@
+//--------------------------------------------------------------------------------------
+// File: Log.cpp
+//
+// Asynchronous log sink: per-thread buffers, one background flusher, one open file.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include "Log.h"
+#include "FileIO.h"
+
+namespace
+{
+	const char* LEVEL_NAMES[] = { "debug", "info", "warning", "error" };
+
+	// Thread local handle on this thread's buffer in the current sink generation.
+	struct SLocalBuffer
+	{
+		unsigned	generation;
+		void*		buffer;
+	};
+	thread_local SLocalBuffer t_local = { 0, nullptr };
+
+	string CsvField(const string &value)
+	{
+		if (value.find_first_of(",\"\n") == string::npos)
+			return value;
+
+		string quoted = "\"";
+		for (char c : value)
+		{
+			if (c == '"')
+				quoted += '"';
+			quoted += (c == '\n') ? ' ' : c;
+		}
+		return quoted + "\"";
+	}
+}
+
+CLogSink& CLogSink::Instance()
+{
+	static CLogSink s_sink;
+	return s_sink;
+}
+
+bool CLogSink::Open(const string &path, LOG_LEVEL minLevel)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock(m_registryMutex);
+	m_log.open(path, ios::out | ios::app | ios::binary);
+	if (!m_log.good())
+		return false;
+
+	size_t dot = path.rfind('.');
+	m_path = path;
+	m_recordsPath = ((dot == string::npos) ? path : path.substr(0, dot)) + "_records.csv";
+	m_minLevel = minLevel;
+	m_buffers.clear();
+	m_held.clear();
+	m_nextSequence = m_sequence;
+	m_generation++;
+	m_stop = false;
+	m_open = true;
+
+	m_flusher = std::thread(&CLogSink::FlushLoop, this);
+	return true;
+}
+
+void CLogSink::Close()
+{
+	if (!m_open)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	if (m_flusher.joinable())
+		m_flusher.join();
+
+	m_open = false;
+	Drain(true);
+
+	std::lock_guard<std::mutex> lock(m_registryMutex);
+	m_log.close();
+	if (m_records.is_open())
+		m_records.close();
+}
+
+bool CLogSink::IsOpenFor(const string &path) const
+{
+	return m_open && m_path == path;
+}
+
+void CLogSink::Write(LOG_LEVEL level, const string &message)
+{
+	if (!Accepts(level))
+	{
+		m_dropped++;
+		return;
+	}
+
+	SLogRecord record;
+	record.level = level;
+	record.message = message;
+	record.hr = S_OK;
+	record.seconds = 0.0;
+	record.bStructured = false;
+	Push(record);
+}
+
+void CLogSink::Write(LOG_LEVEL level, const string &stage, const string &file, HRESULT hr, double seconds, const string &message)
+{
+	if (!Accepts(level))
+	{
+		m_dropped++;
+		return;
+	}
+
+	SLogRecord record;
+	record.level = level;
+	record.message = message;
+	record.stage = stage;
+	record.file = file;
+	record.hr = hr;
+	record.seconds = seconds;
+	record.bStructured = true;
+	Push(record);
+}
+
+CLogSink::SThreadBuffer& CLogSink::LocalBuffer()
+{
+	if (t_local.buffer && t_local.generation == m_generation)
+		return *static_cast<SThreadBuffer*>(t_local.buffer);
+
+	// First record from this thread since Open: register a buffer for it.
+	std::lock_guard<std::mutex> lock(m_registryMutex);
+	m_buffers.push_back(unique_ptr<SThreadBuffer>(new SThreadBuffer()));
+	t_local.generation = m_generation;
+	t_local.buffer = m_buffers.back().get();
+	return *m_buffers.back();
+}
+
+void CLogSink::Push(SLogRecord &record)
+{
+	SThreadBuffer &buffer = LocalBuffer();
+	record.ticks = IOTimestamp();
+
+	std::lock_guard<std::mutex> lock(buffer.lock);
+	record.sequence = m_sequence++;
+	buffer.records.push_back(std::move(record));
+}
+
+void CLogSink::FlushLoop()
+{
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	while (!m_stop)
+	{
+		m_wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+		lock.unlock();
+		Drain(false);
+		lock.lock();
+	}
+}
+
+void CLogSink::Drain(bool bAll)
+{
+	std::lock_guard<std::mutex> lock(m_registryMutex);
+
+	vector<SLogRecord> pending;
+	pending.swap(m_held);
+	for (auto &buffer : m_buffers)
+	{
+		vector<SLogRecord> taken;
+		{
+			std::lock_guard<std::mutex> bufferLock(buffer->lock);
+			taken.swap(buffer->records);
+		}
+		std::move(taken.begin(), taken.end(), std::back_inserter(pending));
+	}
+	if (pending.empty())
+		return;
+
+	// Sequence numbers are taken under each buffer's lock, so sorting restores write order among
+	// the records taken. A record numbered just before the sweep may still be going into a buffer
+	// already passed: everything after such a gap is held for the next drain, which fills it.
+	std::sort(pending.begin(), pending.end(), [](const SLogRecord &a, const SLogRecord &b) { return a.sequence < b.sequence; });
+
+	size_t ready = 0;
+	while (ready < pending.size() && (bAll || pending[ready].sequence == m_nextSequence))
+	{
+		m_nextSequence = pending[ready].sequence + 1;
+		ready++;
+	}
+	m_held.assign(std::make_move_iterator(pending.begin() + ready), std::make_move_iterator(pending.end()));
+	pending.resize(ready);
+
+	for (const auto &record : pending)
+	{
+		if (!record.message.empty())
+		{
+			m_log << record.message;
+		}
+
+		if (!record.bStructured)
+			continue;
+
+		if (!m_records.is_open())
+		{
+			m_records.open(m_recordsPath, ios::out | ios::trunc);
+			m_records << "time_s,level,stage,file,hresult,duration_ms,message\n";
+		}
+
+		char numbers[96];
+		sprintf_s(numbers, ",0x%08lX,%.3f,", (unsigned long)record.hr, record.seconds * 1000.0);
+		m_records << IOSeconds(record.ticks) << ',' << LogLevelName(record.level) << ',' << CsvField(record.stage) << ','
+				  << CsvField(record.file) << numbers << CsvField(record.message) << '\n';
+	}
+
+	m_log.flush();
+	if (m_records.is_open())
+		m_records.flush();
+}
+
+//--------------------------------------------------------------------------------------
+// Levels
+//--------------------------------------------------------------------------------------
+LOG_LEVEL LevelOfMessage(const string &message)
+{
+	if (message.find("FAILED") != string::npos || message.find("ERROR") != string::npos)
+		return LOG_ERROR;
+
+	if (message.find("WARNING") != string::npos)
+		return LOG_WARNING;
+
+	return LOG_INFO;
+}
+
+LOG_LEVEL ParseLogLevel(const string &name, bool &ok)
+{
+	ok = true;
+	for (int i = LOG_DEBUG; i <= LOG_ERROR; i++)
+	{
+		if (name.find(LEVEL_NAMES[i]) != string::npos)
+			return (LOG_LEVEL)i;
+	}
+	ok = false;
+	return LOG_INFO;
+}
+
+const char* LogLevelName(LOG_LEVEL level)
+{
+	return LEVEL_NAMES[(level >= LOG_DEBUG && level <= LOG_ERROR) ? level : LOG_INFO];
+}
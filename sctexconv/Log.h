@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum LOG_LEVEL
+{
+	LOG_DEBUG = 0,
+	LOG_INFO,
+	LOG_WARNING,
+	LOG_ERROR
+};
+
+// One log entry. Plain messages only fill 'message'; structured records also carry the
+// stage, file, result and duration and are additionally written to the records CSV.
+struct SLogRecord
+{
+	unsigned long long	sequence;		//  Global order, assigned when the record is written.
+	long long			ticks;			//  IOTimestamp() at write time.
+	LOG_LEVEL			level;
+	string				message;
+	string				stage;
+	string				file;
+	HRESULT				hr;
+	double				seconds;
+	bool				bStructured;
+};
+
+// Buffered, asynchronous log file writer.
+// Each thread appends to its own buffer - the only lock on that path is the thread's own,
+// which nothing but the flusher ever contends. A background thread merges the buffers in
+// write order and appends them to the still open log file every LOG_FLUSH_INTERVAL_MS.
+const unsigned LOG_FLUSH_INTERVAL_MS = 100;
+
+class CLogSink
+{
+public:
+	static CLogSink& Instance();
+
+	bool Open(const string &path, LOG_LEVEL minLevel);
+	void Close();								//  Writes everything still buffered, then stops the flusher.
+	bool IsOpenFor(const string &path) const;
+
+	bool Accepts(LOG_LEVEL level) const { return m_open && level >= m_minLevel; }
+	void Write(LOG_LEVEL level, const string &message);
+	void Write(LOG_LEVEL level, const string &stage, const string &file, HRESULT hr, double seconds, const string &message);
+
+	unsigned long long Dropped() const { return m_dropped; }		//  Records filtered out by level.
+
+private:
+	struct SThreadBuffer
+	{
+		std::mutex				lock;
+		vector<SLogRecord>		records;
+	};
+
+	CLogSink() : m_open(false), m_minLevel(LOG_INFO), m_generation(0), m_sequence(0), m_dropped(0), m_nextSequence(0), m_stop(false) {}
+	~CLogSink() { Close(); }
+
+	SThreadBuffer& LocalBuffer();
+	void Push(SLogRecord &record);
+	void FlushLoop();
+	void Drain(bool bAll);						//  bAll: write held records too, nothing more is coming.
+
+	std::atomic<bool>					m_open;
+	LOG_LEVEL							m_minLevel;
+	string								m_path;
+	string								m_recordsPath;
+	ofstream							m_log;
+	ofstream							m_records;			//  Opened on the first structured record.
+	std::atomic<unsigned>				m_generation;		//  Bumped by Open, so stale thread buffers are not reused.
+	std::atomic<unsigned long long>		m_sequence;
+	std::atomic<unsigned long long>		m_dropped;
+
+	std::mutex							m_registryMutex;	//  Guards m_buffers and the files.
+	vector<unique_ptr<SThreadBuffer>>	m_buffers;
+	vector<SLogRecord>					m_held;				//  Drained, waiting for an earlier record still being pushed.
+	unsigned long long					m_nextSequence;		//  Sequence number of the next record to write.
+	std::thread							m_flusher;
+	std::mutex							m_wakeMutex;
+	std::condition_variable				m_wake;
+	bool								m_stop;
+
+	CLogSink(const CLogSink&);
+	CLogSink& operator=(const CLogSink&);
+};
+
+// Messages that mention a failure are logged as errors, so older call sites need no level.
+LOG_LEVEL LevelOfMessage(const string &message);
+LOG_LEVEL ParseLogLevel(const string &name, bool &ok);
+const char* LogLevelName(LOG_LEVEL level);
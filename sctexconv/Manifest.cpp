@@ -0,0 +1,268 @@
+//--------------------------------------------------------------------------------------
+// File: Manifest.cpp
+//
+// Incremental conversion manifest: skip textures whose inputs, options and output
+// are unchanged since they were last converted.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "Manifest.h"
+
+namespace
+{
+	const unsigned long long HASH_SEED  = 0xcbf29ce484222325ULL;
+	const unsigned long long HASH_PRIME = 0x100000001b3ULL;
+
+	string ToLower(string s)
+	{
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)tolower(c); });
+		return s;
+	}
+
+	vector<string> SplitTabs(const string &line)
+	{
+		vector<string> fields;
+		size_t start = 0;
+		for (;;)
+		{
+			size_t tab = line.find('\t', start);
+			fields.push_back(line.substr(start, tab - start));
+			if (tab == string::npos)
+				break;
+			start = tab + 1;
+		}
+		return fields;
+	}
+
+	bool SameStamp(const SFileStamp &a, const SFileStamp &b)
+	{
+		return a.size == b.size && a.mtime == b.mtime;
+	}
+
+	void ListFragments(SFragmentSet &fragments)
+	{
+		WIN32_FIND_DATAA ffd;
+		string search = fragments.sDirectory + fragments.sBaseName + "*";
+		HANDLE hFind = FindFirstFileExA(search.c_str(), FindExInfoBasic, &ffd, FindExSearchNameMatch, nullptr, 0);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return;
+
+		string baseName, suffix;
+		do
+		{
+			if (ffd.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM))
+				continue;
+
+			SplitFragmentName(ffd.cFileName, baseName, suffix);
+			if (ToLower(baseName) != ToLower(fragments.sBaseName))
+				continue;
+
+			SFileStamp stamp;
+			stamp.size  = ((unsigned long long)ffd.nFileSizeHigh << 32) | ffd.nFileSizeLow;
+			stamp.mtime = ((unsigned long long)ffd.ftLastWriteTime.dwHighDateTime << 32) | ffd.ftLastWriteTime.dwLowDateTime;
+			fragments.files[ToLower(suffix)] = stamp;
+		} while (FindNextFileA(hFind, &ffd));
+
+		FindClose(hFind);
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Hashing
+//--------------------------------------------------------------------------------------
+unsigned long long HashBytes(const void *data, size_t size, unsigned long long seed)
+{
+	// FNV style mix over 8 byte words.
+	unsigned long long hash = seed ? seed : HASH_SEED;
+	const unsigned char* ptr = (const unsigned char*)data;
+
+	while (size >= sizeof(unsigned long long))
+	{
+		unsigned long long word;
+		memcpy(&word, ptr, sizeof(word));
+		hash = (hash ^ word) * HASH_PRIME;
+		hash ^= (hash >> 29);
+		ptr  += sizeof(word);
+		size -= sizeof(word);
+	}
+	while (size > 0)
+	{
+		hash = (hash ^ *ptr++) * HASH_PRIME;
+		size--;
+	}
+	return hash;
+}
+
+bool StatFile(const string &path, SFileStamp &stamp)
+{
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &fad) || (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+
+	stamp.size  = ((unsigned long long)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+	stamp.mtime = ((unsigned long long)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
+//--------------------------------------------------------------------------------------
+// CConversionManifest
+//
+// Line format (tab separated):
+//   key  optionsHash  outputSize  outputMtime  n  [suffix size mtime] x n
+//--------------------------------------------------------------------------------------
+bool CConversionManifest::Load(const string &path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_path = path;
+	m_entries.clear();
+
+	ifstream fin(path);
+	if (!fin.good())
+		return false;
+
+	string line;
+	while (getline(fin, line))
+	{
+		vector<string> f = SplitTabs(line);
+		if (f.size() < 5)
+			continue;
+
+		SManifestEntry entry;
+		size_t count = 0;
+		try
+		{
+			entry.optionsHash  = stoull(f[1], nullptr, 16);
+			entry.output.size  = stoull(f[2]);
+			entry.output.mtime = stoull(f[3]);
+			count			   = (size_t)stoull(f[4]);
+
+			// Lines of older manifests have more fields and are dropped: those textures convert again.
+			if (f.size() != 5 + count * 3)
+				continue;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				SFileStamp stamp;
+				stamp.size  = stoull(f[6 + i * 3]);
+				stamp.mtime = stoull(f[7 + i * 3]);
+				entry.fragments.push_back(make_pair(f[5 + i * 3], stamp));
+			}
+		}
+		catch (...)
+		{
+			continue;	// Damaged line - that texture is simply converted again.
+		}
+
+		m_entries[f[0]] = entry;
+	}
+
+	m_dirty = false;
+	return true;
+}
+
+bool CConversionManifest::Save()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_dirty || m_path.empty())
+		return true;
+
+	// Write beside the real manifest and swap it in, so a crash never leaves half a file.
+	string temp = m_path + ".tmp";
+	{
+		ofstream fout(temp, ios::out | ios::trunc);
+		if (!fout.good())
+			return false;
+
+		char buffer[128];
+		for (const auto &e : m_entries)
+		{
+			const SManifestEntry &entry = e.second;
+			sprintf_s(buffer, "\t%016llx\t%llu\t%llu\t%u", entry.optionsHash, entry.output.size, entry.output.mtime,
+					  (unsigned)entry.fragments.size());
+			fout << e.first << buffer;
+
+			for (const auto &frag : entry.fragments)
+			{
+				fout << '\t' << frag.first << '\t' << frag.second.size << '\t' << frag.second.mtime;
+			}
+			fout << '\n';
+		}
+
+		if (!fout.good())
+			return false;
+	}
+
+	if (!MoveFileExA(temp.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return false;
+
+	m_dirty = false;
+	m_unsaved = 0;
+	return true;
+}
+
+MANIFEST_STATE CConversionManifest::Check(const string &key, const SFragmentSet &fragments, unsigned long long optionsHash,
+										  const SFileStamp *output)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(ToLower(key));
+	if (it == m_entries.end())
+		return MANIFEST_NO_ENTRY;
+
+	const SManifestEntry &entry = it->second;
+	if (entry.optionsHash != optionsHash || !output || !SameStamp(entry.output, *output))
+		return MANIFEST_CHANGED;
+
+	if (entry.fragments.size() != fragments.files.size())
+		return MANIFEST_CHANGED;
+
+	auto frag = fragments.files.begin();
+	for (const auto &rec : entry.fragments)
+	{
+		if (rec.first != frag->first || !SameStamp(rec.second, frag->second))
+			return MANIFEST_CHANGED;
+		++frag;
+	}
+
+	return MANIFEST_CURRENT;
+}
+
+bool CConversionManifest::Record(const string &key, const SFragmentSet &fragments, unsigned long long optionsHash,
+								 const string &outputPath)
+{
+	SManifestEntry entry;
+	entry.optionsHash = optionsHash;
+
+	if (!StatFile(outputPath, entry.output))
+		return false;
+
+	// Fragments are listed again: renames, reassembly and cleanup during this run have changed
+	// them, and the next run will compare against what its own directory listing sees.
+	SFragmentSet current;
+	current.sDirectory = fragments.sDirectory;
+	current.sBaseName = fragments.sBaseName;
+	ListFragments(current);
+
+	entry.fragments.assign(current.files.begin(), current.files.end());
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries[ToLower(key)] = entry;
+	m_dirty = true;
+	m_unsaved++;
+	return true;
+}
+
+size_t CConversionManifest::Size() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+size_t CConversionManifest::Unsaved() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_unsaved;
+}
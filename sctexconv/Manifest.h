@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Windows.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FileIndex.h"
+
+using namespace std;
+
+const string MANIFEST_FILE = "sctextureconverter_manifest.txt";
+const size_t MANIFEST_SAVE_INTERVAL = 64;		// Records between saves, so a crash loses little.
+
+// What was converted, from which inputs, with which options - one line per texture.
+struct SManifestEntry
+{
+	unsigned long long					optionsHash;	//  Hash of every option that changes the output.
+	vector<pair<string, SFileStamp>>	fragments;		//  Fragment suffix -> size + mtime when converted.
+	SFileStamp							output;			//  Converted output as written.
+};
+
+enum MANIFEST_STATE
+{
+	MANIFEST_NO_ENTRY = 0,	// Never converted with a manifest - fall back to the old skip rules.
+	MANIFEST_CHANGED,		// Inputs, options or output differ from the last conversion.
+	MANIFEST_CURRENT		// Output is up to date - skip without reading any pixels.
+};
+
+// Persistent record of finished conversions, stored next to the log files.
+// Shared by the pipeline workers; every call takes the lock.
+class CConversionManifest
+{
+public:
+	CConversionManifest() : m_dirty(false), m_unsaved(0) {}
+
+	bool Load(const string &path);
+	bool Save();
+
+	// Compares the indexed fragments and output (size + mtime) against the recorded entry.
+	// Nothing is read: any stamp that moved means the texture is converted again.
+	MANIFEST_STATE Check(const string &key, const SFragmentSet &fragments, unsigned long long optionsHash,
+						 const SFileStamp *output);
+
+	// Lists the fragments again (the run may have renamed, reassembled or removed some) and
+	// stores their stamps with the output's. Only directory data is read, no file contents.
+	bool Record(const string &key, const SFragmentSet &fragments, unsigned long long optionsHash,
+				const string &outputPath);
+
+	size_t Size() const;
+	size_t Unsaved() const;
+
+private:
+	mutable std::mutex				m_mutex;
+	string							m_path;
+	map<string, SManifestEntry>		m_entries;		//  Lower case directory + base name -> entry
+	bool							m_dirty;
+	size_t							m_unsaved;
+};
+
+// Fast 64-bit hash, for the options.
+unsigned long long HashBytes(const void *data, size_t size, unsigned long long seed = 0);
+bool StatFile(const string &path, SFileStamp &stamp);
@@ -0,0 +1,183 @@
+//--------------------------------------------------------------------------------------
+// File: MemoryBudget.cpp
+//
+// Footprint prediction and memory budgeted admission of textures to the convert workers.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "MemoryBudget.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Bytes of the first 'mipLevels' levels of 'info' stored as 'format'.
+	unsigned long long LayoutBytes(const TexMetadata &info, DXGI_FORMAT format, size_t mipLevels)
+	{
+		unsigned long long total = 0;
+		size_t width = info.width;
+		size_t height = info.height;
+		size_t depth = info.depth;
+		bool bVolume = (info.dimension == TEX_DIMENSION_TEXTURE3D);
+
+		for (size_t level = 0; level < mipLevels; level++)
+		{
+			size_t rowPitch, slicePitch;
+			ComputePitch(format, width, height, rowPitch, slicePitch, CP_FLAGS_NONE);
+			total += (unsigned long long)slicePitch * (bVolume ? depth : info.arraySize);
+
+			if (width == 1 && height == 1 && depth == 1)
+				break;
+			width = std::max<size_t>(1, width / 2);
+			height = std::max<size_t>(1, height / 2);
+			depth = std::max<size_t>(1, depth / 2);
+		}
+		return total;
+	}
+
+	size_t FullChain(const TexMetadata &info)
+	{
+		size_t levels = 1;
+		size_t width = info.width, height = info.height, depth = info.depth;
+		while (width > 1 || height > 1 || depth > 1)
+		{
+			width = std::max<size_t>(1, width / 2);
+			height = std::max<size_t>(1, height / 2);
+			depth = std::max<size_t>(1, depth / 2);
+			levels++;
+		}
+		return levels;
+	}
+
+	// What Decompress picks for each BC family.
+	DXGI_FORMAT DecodedFormat(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC4_TYPELESS:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			return DXGI_FORMAT_R8_UNORM;
+
+		case DXGI_FORMAT_BC5_TYPELESS:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+			return DXGI_FORMAT_R8G8_UNORM;
+
+		case DXGI_FORMAT_BC6H_TYPELESS:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		default:
+			return IsCompressed(format) ? DXGI_FORMAT_R8G8B8A8_UNORM : format;
+		}
+	}
+}
+
+SFootprint EstimateFootprint(const TexMetadata &info, DXGI_FORMAT target, size_t outMips, bool bNormalMap, bool bMergeGloss,
+							 bool bCanTile)
+{
+	SFootprint footprint = {};
+
+	size_t mipLevels = std::max<size_t>(1, info.mipLevels);
+	size_t keptMips = (outMips ? std::min(outMips, mipLevels) : mipLevels);
+	bool bNewMips = (outMips ? outMips > mipLevels : FullChain(info) > mipLevels);
+
+	DXGI_FORMAT work = DecodedFormat(info.format);
+	DXGI_FORMAT output = (target == DXGI_FORMAT_UNKNOWN ? work : target);
+	if (IsCompressed(output))
+		output = work;	//  The encoded image is smaller than the one it is made from.
+
+	unsigned long long source = LayoutBytes(info, info.format, mipLevels);
+	unsigned long long decoded = (work != info.format ? LayoutBytes(info, work, mipLevels) : 0);
+	unsigned long long top = LayoutBytes(info, work, keptMips);
+	unsigned long long converted = LayoutBytes(info, (bNormalMap ? DXGI_FORMAT_R32G32B32A32_FLOAT : output), keptMips);
+
+	// Each stage holds its input and its output. The original stays loaded while decoding
+	// (and for a DDS target), so count it throughout.
+	unsigned long long peak = source + std::max(decoded + (decoded ? top : 0), top + converted);
+	if (bNewMips)
+	{
+		// Mip generation works on an R32G32B32A32_FLOAT copy of the top level.
+		unsigned long long chain = LayoutBytes(info, output, (outMips ? outMips : FullChain(info)));
+		peak = std::max(peak, source + LayoutBytes(info, DXGI_FORMAT_R32G32B32A32_FLOAT, 1) + converted + chain);
+	}
+	if (bMergeGloss)
+	{
+		// Normal, gloss (RGBA) and the merged image are all in memory at the end.
+		peak += 2 * LayoutBytes(info, DXGI_FORMAT_R8G8B8A8_UNORM, keptMips);
+	}
+
+	footprint.bytes = peak;
+	footprint.bCanTile = bCanTile;
+	footprint.tiledBytes = (footprint.bCanTile ? source + LayoutBytes(info, output, keptMips) : peak);
+	return footprint;
+}
+
+//--------------------------------------------------------------------------------------
+// CMemoryBudget
+//--------------------------------------------------------------------------------------
+unsigned long long CMemoryBudget::Acquire(unsigned long long bytes)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_limit)
+		return 0;
+
+	bytes = std::min(bytes, m_limit);
+	unsigned long long ticket = m_nextTicket++;
+	auto admitted = [&]() { return m_serving == ticket && m_inUse + bytes <= m_limit; };
+	if (!admitted())
+	{
+		m_waits++;
+		m_changed.wait(lock, admitted);
+	}
+
+	m_serving++;
+	m_inUse += bytes;
+	m_peak = std::max(m_peak, m_inUse);
+	m_changed.notify_all();
+	return bytes;
+}
+
+void CMemoryBudget::Release(unsigned long long bytes)
+{
+	if (!bytes)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_inUse -= std::min(bytes, m_inUse);
+	m_changed.notify_all();
+}
+
+unsigned long long CMemoryBudget::Peak() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_peak;
+}
+
+unsigned long long CMemoryBudget::Waits() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_waits;
+}
+
+unsigned long long DefaultMemoryBudget()
+{
+	MEMORYSTATUSEX status = {};
+	status.dwLength = sizeof(status);
+	if (!GlobalMemoryStatusEx(&status))
+		return 0;
+
+	return status.ullTotalPhys / 2;
+}
+
+void SetMemoryBudget(CMemoryBudget &budget, unsigned long long bytes)
+{
+	const unsigned long long POOL_LIMIT = 512ull << 20;
+
+	unsigned long long pool = std::min(POOL_LIMIT, bytes / 8);
+	if (bytes)
+		SetImagePoolLimit(static_cast<size_t>(pool));
+	budget.SetLimit(bytes - pool);
+}
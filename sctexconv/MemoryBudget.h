@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include "directxtex.h"
+
+using namespace std;
+
+// Peak memory of one texture through SCTexConvert, predicted from its header.
+struct SFootprint
+{
+	unsigned long long	bytes;			//  Stage by stage.
+	unsigned long long	tiledBytes;		//  With -tiled, when the texture can use it (else == bytes).
+	bool				bCanTile;
+};
+
+// 'info' is the source header, 'target' the pixel format asked for (DXGI_FORMAT_UNKNOWN = source),
+// 'outMips' the mip levels written (0 = full chain). Normal maps and merged gloss add their buffers.
+// 'bCanTile' is whether the converter would take the tiled path (CConverterContext::WouldTile).
+SFootprint EstimateFootprint(const DirectX::TexMetadata &info, DXGI_FORMAT target, size_t outMips, bool bNormalMap, bool bMergeGloss,
+							 bool bCanTile);
+
+// Admission control for the convert workers: a texture starts only while the predicted
+// footprints of everything converting fit in the budget. Requests are served in order, so a
+// big texture is not passed over forever, and one larger than the whole budget still runs,
+// alone. A limit of 0 admits everything.
+class CMemoryBudget
+{
+public:
+	CMemoryBudget() : m_limit(0), m_inUse(0), m_peak(0), m_nextTicket(0), m_serving(0), m_waits(0) {}
+
+	void SetLimit(unsigned long long bytes) { m_limit = bytes; }
+	unsigned long long Limit() const { return m_limit; }
+
+	// Blocks until 'bytes' fit. Returns what was reserved, to be handed back to Release.
+	unsigned long long Acquire(unsigned long long bytes);
+	void Release(unsigned long long bytes);
+
+	unsigned long long Peak() const;
+	unsigned long long Waits() const;		//  Textures that had to wait for memory.
+
+private:
+	mutable std::mutex			m_mutex;
+	std::condition_variable		m_changed;
+	unsigned long long			m_limit;
+	unsigned long long			m_inUse;
+	unsigned long long			m_peak;
+	unsigned long long			m_nextTicket;
+	unsigned long long			m_serving;
+	unsigned long long			m_waits;
+
+	CMemoryBudget(const CMemoryBudget&);
+	CMemoryBudget& operator=(const CMemoryBudget&);
+};
+
+// Holds a share of a CMemoryBudget for as long as it lives.
+class CMemoryReservation
+{
+public:
+	CMemoryReservation(CMemoryBudget &budget, unsigned long long bytes) : m_budget(budget), m_bytes(budget.Acquire(bytes)) {}
+	~CMemoryReservation() { m_budget.Release(m_bytes); }
+
+private:
+	CMemoryBudget&		m_budget;
+	unsigned long long	m_bytes;
+
+	CMemoryReservation(const CMemoryReservation&);
+	CMemoryReservation& operator=(const CMemoryReservation&);
+};
+
+// Half of the physical memory, the default budget.
+unsigned long long DefaultMemoryBudget();
+
+// Gives 'budget' 'bytes' less the image pool's share. The pool keeps freed buffers outside
+// every reservation, so it is capped to an eighth of the budget (at most its 512 MB default).
+void SetMemoryBudget(CMemoryBudget &budget, unsigned long long bytes);
@@ -0,0 +1,105 @@
+//--------------------------------------------------------------------------------------
+// File: OutputWriter.cpp
+//
+// Encoded output files and the writes of the pipeline's writer stage.
+//--------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstring>
+#include "OutputWriter.h"
+#include "FileIO.h"
+#include "Timing.h"
+
+namespace
+{
+	std::atomic<unsigned long long>	s_files(0);
+	std::atomic<unsigned long long>	s_failures(0);
+	std::atomic<unsigned long long>	s_bytes(0);
+	std::atomic<long long>			s_ticks(0);
+
+	// Win32 error of the last call, never S_OK.
+	HRESULT LastError()
+	{
+		DWORD error = GetLastError();
+		return (error ? HRESULT_FROM_WIN32(error) : E_FAIL);
+	}
+
+	HRESULT WriteWholeFile(const string &path, const unsigned char* data, size_t size)
+	{
+		HANDLE hFile = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+								   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return LastError();
+
+		HRESULT hr = S_OK;
+		while (size > 0)
+		{
+			DWORD chunk = (size > IO_BLOCK_SIZE) ? IO_BLOCK_SIZE : (DWORD)size;
+			DWORD bytesWritten = 0;
+			if (!WriteFile(hFile, data, chunk, &bytesWritten, nullptr) || bytesWritten != chunk)
+			{
+				hr = LastError();
+				break;
+			}
+			data += chunk;
+			size -= chunk;
+		}
+
+		CloseHandle(hFile);
+		return hr;
+	}
+}
+
+HRESULT CopyToBlob(const void* data, size_t size, DirectX::Blob &blob)
+{
+	if (!data || !size)
+		return E_INVALIDARG;
+
+	HRESULT hr = blob.Initialize(size);
+	if (FAILED(hr))
+		return hr;
+
+	memcpy(blob.GetBufferPointer(), data, size);
+	return S_OK;
+}
+
+HRESULT WriteEncodedFile(const SEncodedFile &file)
+{
+	const unsigned char* data = (const unsigned char*)file.blob.GetBufferPointer();
+	size_t size = file.blob.GetBufferSize();
+	if (!data || !size)
+		return E_INVALIDARG;
+
+	CStageClock stageClock(STAGE_WRITE, file.sPath, nullptr);
+	stageClock.SetInputBytes(size);
+	long long startTicks = IOTimestamp();
+
+	string temp = TempPathFor(file.sPath);
+	HRESULT hr = WriteWholeFile(temp, data, size);
+	if (SUCCEEDED(hr) && !PublishFile(temp, file.sPath))
+	{
+		hr = LastError();
+	}
+	if (FAILED(hr))
+	{
+		DiscardFile(temp);
+		s_failures++;
+		return hr;
+	}
+
+	s_files++;
+	s_bytes += size;
+	s_ticks += IOTimestamp() - startTicks;
+	stageClock.Done(size, 0);
+	return hr;
+}
+
+SWriteStats GetWriteStats()
+{
+	SWriteStats stats;
+	stats.files = s_files;
+	stats.failures = s_failures;
+	stats.bytes = s_bytes;
+	stats.seconds = IOSeconds(s_ticks);
+	return stats;
+}
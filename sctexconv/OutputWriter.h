@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <utility>
+#include "directxtex.h"
+
+using namespace std;
+
+// An output file encoded in memory by a convert worker, waiting for the writer stage.
+struct SEncodedFile
+{
+	string			sPath;
+	DirectX::Blob	blob;
+
+	SEncodedFile() {}
+	SEncodedFile(SEncodedFile &&other) : sPath(std::move(other.sPath)), blob(std::move(other.blob)) {}
+	SEncodedFile& operator=(SEncodedFile &&other)
+	{
+		sPath = std::move(other.sPath);
+		blob = std::move(other.blob);
+		return *this;
+	}
+
+private:
+	SEncodedFile(const SEncodedFile&);
+	SEncodedFile& operator=(const SEncodedFile&);
+};
+
+// Running totals of the writer stage.
+struct SWriteStats
+{
+	unsigned long long	files;
+	unsigned long long	failures;
+	unsigned long long	bytes;
+	double				seconds;		//  Summed over the writer threads.
+};
+
+// For encoders that hand back their own buffer (FreeImage, OpenCV).
+HRESULT CopyToBlob(const void* data, size_t size, DirectX::Blob &blob);
+
+// Writes the file under TempPathFor(sPath), then renames it into place.
+HRESULT WriteEncodedFile(const SEncodedFile &file);
+
+SWriteStats GetWriteStats();
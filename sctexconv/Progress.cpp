@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------
+// File: Progress.cpp
+//
+// In-place console progress line with a throughput based ETA.
+//--------------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <io.h>
+#include <iostream>
+#include "Progress.h"
+#include "FileIO.h"
+
+CProgressDisplay& CProgressDisplay::Instance()
+{
+	static CProgressDisplay s_progress;
+	return s_progress;
+}
+
+void CProgressDisplay::Start(bool bVerbose)
+{
+	Stop();
+
+	m_verbose = bVerbose;
+	if (!_isatty(_fileno(stdout)))
+		return;
+
+	m_stop = false;
+	m_lastBytes = 0;
+	m_rate = 0.0;
+	m_active = true;
+	m_renderer = std::thread(&CProgressDisplay::RenderLoop, this);
+}
+
+void CProgressDisplay::Stop()
+{
+	if (!m_active)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	if (m_renderer.joinable())
+		m_renderer.join();
+
+	std::lock_guard<std::recursive_mutex> lock(m_consoleMutex);
+	if (m_lineShown)
+	{
+		std::cout << std::endl;
+		m_lineShown = false;
+	}
+	m_active = false;
+}
+
+void CProgressDisplay::Finish(unsigned long long bytes, bool bConverted, int failures)
+{
+	(bConverted ? m_bytesDone : m_bytesSkipped) += bytes;
+	m_failures += failures;
+	m_finished++;
+}
+
+void CProgressDisplay::ClearLine()
+{
+	if (!m_lineShown)
+		return;
+
+	std::cout << '\r' << string(79, ' ') << '\r' << std::flush;
+	m_lineShown = false;
+}
+
+void CProgressDisplay::RenderLoop()
+{
+	long long start = IOTimestamp();
+	long long last = start;
+
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	for (;;)
+	{
+		m_wake.wait_for(lock, std::chrono::milliseconds(PROGRESS_INTERVAL_MS));
+		bool stop = m_stop;
+		lock.unlock();
+
+		long long now = IOTimestamp();
+		Render(IOSeconds(now - start), IOSeconds(now - last));
+		last = now;
+
+		if (stop)
+			break;
+		lock.lock();
+	}
+}
+
+void CProgressDisplay::Render(double elapsed, double dt)
+{
+	// Exponentially weighted moving average of the converted bytes per second.
+	unsigned long long done = m_bytesDone;
+	if (dt > 0.0)
+	{
+		double instant = double(done - m_lastBytes) / dt;
+		double alpha = 1.0 - exp(-dt / PROGRESS_EWMA_SECONDS);
+		m_rate = (m_rate == 0.0) ? instant : (m_rate + alpha * (instant - m_rate));
+		m_lastBytes = done;
+	}
+
+	// Work left: queued bytes not yet finished, plus textures found but not yet taken on,
+	// estimated at the average size seen so far.
+	int started = m_started;
+	size_t discovered = m_discovered;
+	unsigned long long queued = m_bytesQueued;
+	unsigned long long finished = done + m_bytesSkipped;
+	double remaining = double(queued > finished ? queued - finished : 0);
+	if (started > 0 && discovered > (size_t)started)
+	{
+		remaining += double(discovered - started) * (double(queued) / started);
+	}
+
+	string eta = (m_rate > 0.0) ? FormatDuration(remaining / m_rate) : "--:--:--";
+	int failures = m_failures;
+
+	char line[160];
+	sprintf_s(line, " %d of %u%s files | %.1f MB/s | elapsed %s | remaining %s | %d %s",
+			  (int)m_finished, (unsigned)discovered, (m_scanDone ? "" : "+"), m_rate / (1024.0 * 1024.0),
+			  FormatDuration(elapsed).c_str(), eta.c_str(), failures, (failures == 1 ? "error" : "errors"));
+
+	std::lock_guard<std::recursive_mutex> lock(m_consoleMutex);
+	std::cout << '\r' << line << "   " << std::flush;
+	m_lineShown = true;
+}
+
+string FormatDuration(double seconds)
+{
+	unsigned long long total = (seconds > 0.0) ? (unsigned long long)(seconds + 0.5) : 0;
+	char buffer[32];
+	sprintf_s(buffer, "%02llu:%02llu:%02llu", total / 3600, (total / 60) % 60, total % 60);
+	return string(buffer);
+}
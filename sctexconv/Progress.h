@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+const unsigned PROGRESS_INTERVAL_MS = 250;		// Redraw rate of the progress line.
+const double   PROGRESS_EWMA_SECONDS = 5.0;		// Time constant of the smoothed throughput.
+
+// Single console line, redrawn in place at a fixed rate from atomic counters.
+// The ETA comes from a moving average of input bytes per second over the work still
+// queued, so a few huge textures no longer throw it off. Does nothing when stdout is
+// not a console (redirected to a file or pipe).
+class CProgressDisplay
+{
+public:
+	static CProgressDisplay& Instance();
+
+	void Start(bool bVerbose);
+	void Stop();								//  Draws the final state and ends the line.
+	bool IsActive() const { return m_active; }
+
+	// Counters, safe to call from any worker.
+	void SetDiscovered(size_t count, bool bFinished) { m_discovered = count; m_scanDone = bFinished; }
+	void Queue(unsigned long long bytes)		{ m_started++; m_bytesQueued += bytes; }
+	void Finish(unsigned long long bytes, bool bConverted, int failures);
+
+	// MessageOut holds ConsoleMutex() while it prints, and asks here first whether the
+	// message still belongs on the console (only warnings and errors do while active).
+	std::recursive_mutex& ConsoleMutex() { return m_consoleMutex; }
+	bool ShowMessage(bool bProblem) const { return !m_active || m_verbose || bProblem; }
+	void ClearLine();							//  Call with ConsoleMutex() held.
+
+private:
+	CProgressDisplay() : m_active(false), m_verbose(false), m_lineShown(false), m_stop(false),
+						 m_discovered(0), m_scanDone(false), m_started(0), m_finished(0), m_failures(0),
+						 m_bytesQueued(0), m_bytesDone(0), m_bytesSkipped(0), m_lastBytes(0), m_rate(0.0) {}
+	~CProgressDisplay() { Stop(); }
+
+	void RenderLoop();
+	void Render(double elapsed, double dt);
+
+	std::atomic<bool>					m_active;
+	bool								m_verbose;
+	bool								m_lineShown;
+	std::recursive_mutex				m_consoleMutex;
+
+	std::thread							m_renderer;
+	std::mutex							m_wakeMutex;
+	std::condition_variable				m_wake;
+	bool								m_stop;
+
+	std::atomic<size_t>					m_discovered;
+	std::atomic<bool>					m_scanDone;
+	std::atomic<int>					m_started;
+	std::atomic<int>					m_finished;
+	std::atomic<int>					m_failures;
+	std::atomic<unsigned long long>		m_bytesQueued;		//  Input bytes of every texture taken on.
+	std::atomic<unsigned long long>		m_bytesDone;		//  ... of textures actually converted.
+	std::atomic<unsigned long long>		m_bytesSkipped;		//  ... of textures skipped (not part of the rate).
+	unsigned long long					m_lastBytes;
+	double								m_rate;				//  Smoothed bytes per second.
+
+	CProgressDisplay(const CProgressDisplay&);
+	CProgressDisplay& operator=(const CProgressDisplay&);
+};
+
+string FormatDuration(double seconds);		//  "hh:mm:ss"
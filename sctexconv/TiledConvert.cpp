@@ -0,0 +1,244 @@
+//--------------------------------------------------------------------------------------
+// File: TiledConvert.cpp
+//
+// Strip at a time decode -> convert -> premultiply -> encode for SCTexConvert.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "TiledConvert.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Rows of 'image' from 'y' on, as an image of their own. 'y' is a multiple of 4 for BC images.
+	Image StripOf(const Image &image, size_t y, size_t rows)
+	{
+		bool bBlocks = IsCompressed(image.format);
+		size_t lines = bBlocks ? (rows + 3) / 4 : rows;
+
+		Image strip = image;
+		strip.height = rows;
+		strip.slicePitch = image.rowPitch * lines;
+		strip.pixels = image.pixels + (bBlocks ? y / 4 : y) * image.rowPitch;
+		return strip;
+	}
+
+	// Strip height that keeps the widest intermediate (128 bits per pixel) within 'stripBytes'.
+	size_t StripRows(const Image &image, size_t stripBytes)
+	{
+		size_t rows = stripBytes / std::max<size_t>(1, image.width * 16);
+		rows &= ~size_t(3);
+		return std::max<size_t>(4, rows);
+	}
+
+	// Runs the chain on one strip. The stages take turns writing to the two buffers, so each
+	// one reads the strip the previous stage left in cache. 'out' is the last stage's output.
+	HRESULT RunChain(const Image &strip, const STiledChain &chain, ScratchImage buffers[2], const Image *&out, bool &bPremultiplied)
+	{
+		HRESULT hr = S_OK;
+		int next = 0;
+		out = &strip;
+		bPremultiplied = false;
+
+		if (IsCompressed(out->format))
+		{
+			hr = Decompress(*out, DXGI_FORMAT_UNKNOWN, buffers[next]);
+			if (FAILED(hr))
+				return hr;
+			out = buffers[next].GetImage(0, 0, 0);
+			next ^= 1;
+		}
+
+		if (out->format != chain.format && !IsCompressed(chain.format))
+		{
+			hr = Convert(*out, chain.format, chain.dwConvertFlags, 0.5f, buffers[next]);
+			if (FAILED(hr))
+				return hr;
+			out = buffers[next].GetImage(0, 0, 0);
+			next ^= 1;
+		}
+
+		if (chain.bPremultiply && HasAlpha(out->format) && out->format != DXGI_FORMAT_A8_UNORM)
+		{
+			hr = PremultiplyAlpha(*out, chain.dwPMFlags, buffers[next]);
+			if (FAILED(hr))
+				return hr;
+			out = buffers[next].GetImage(0, 0, 0);
+			next ^= 1;
+			bPremultiplied = true;
+		}
+
+		if (chain.bCompress)
+		{
+			hr = Compress(*out, chain.format, chain.dwCompressFlags, 0.5f, buffers[next]);
+			if (FAILED(hr))
+				return hr;
+			out = buffers[next].GetImage(0, 0, 0);
+		}
+
+		return (out ? S_OK : E_POINTER);
+	}
+
+	void StoreStrip(const Image &strip, const Image &dest, size_t y)
+	{
+		bool bBlocks = IsCompressed(dest.format);
+		size_t lines = bBlocks ? (strip.height + 3) / 4 : strip.height;
+		size_t bytes = std::min(strip.rowPitch, dest.rowPitch);
+
+		const uint8_t *pSrc = strip.pixels;
+		uint8_t *pDest = dest.pixels + (bBlocks ? y / 4 : y) * dest.rowPitch;
+		for (size_t line = 0; line < lines; line++)
+		{
+			memcpy(pDest, pSrc, bytes);
+			pSrc += strip.rowPitch;
+			pDest += dest.rowPitch;
+		}
+	}
+
+	// One strip of one level / item / slice of the source.
+	struct SStrip
+	{
+		const Image*	pSrc;
+		size_t			level;
+		size_t			item;
+		size_t			slice;
+		size_t			y;
+		size_t			rows;
+	};
+
+	// Runs the chain on 'strip' and stores it in 'result'. The first strip also sets 'result' up,
+	// since only then is the format the chain produces known.
+	HRESULT ConvertStrip(const SStrip &strip, const STiledChain &chain, const TexMetadata &info, ScratchImage buffers[2],
+						 ScratchImage &result)
+	{
+		const Image *pOut = nullptr;
+		bool bPremultiplied = false;
+		HRESULT hr = RunChain(StripOf(*strip.pSrc, strip.y, strip.rows), chain, buffers, pOut, bPremultiplied);
+		if (FAILED(hr))
+			return hr;
+
+		if (!result.GetImages())
+		{
+			TexMetadata mdata = info;
+			mdata.mipLevels = chain.mipLevels;
+			mdata.format = pOut->format;
+			if (bPremultiplied)
+				mdata.SetAlphaMode(TEX_ALPHA_MODE_PREMULTIPLIED);
+
+			hr = result.Initialize(mdata);
+			if (FAILED(hr))
+				return hr;
+		}
+
+		const Image *pDest = result.GetImage(strip.level, strip.item, strip.slice);
+		if (!pDest || pDest->format != pOut->format)
+			return E_UNEXPECTED;
+
+		StoreStrip(*pOut, *pDest, strip.y);
+		return S_OK;
+	}
+}
+
+HRESULT ConvertTiled(const ScratchImage &source, const STiledChain &chain, ScratchImage &result, BCBlockStats *pBlocks)
+{
+	const TexMetadata &info = source.GetMetadata();
+	if (!source.GetImages() || !chain.mipLevels || chain.mipLevels > info.mipLevels || IsPlanar(info.format))
+		return E_INVALIDARG;
+
+	result.Release();
+
+	bool bVolume = (info.dimension == TEX_DIMENSION_TEXTURE3D);
+	std::vector<SStrip> strips;
+
+	for (size_t level = 0; level < chain.mipLevels; level++)
+	{
+		size_t count = bVolume ? std::max<size_t>(1, info.depth >> level) : info.arraySize;
+		for (size_t index = 0; index < count; index++)
+		{
+			SStrip strip;
+			strip.level = level;
+			strip.item = bVolume ? 0 : index;
+			strip.slice = bVolume ? index : 0;
+			strip.pSrc = source.GetImage(level, strip.item, strip.slice);
+			if (!strip.pSrc)
+				return E_POINTER;
+
+			size_t rows = StripRows(*strip.pSrc, chain.stripBytes);
+			for (strip.y = 0; strip.y < strip.pSrc->height; strip.y += rows)
+			{
+				strip.rows = std::min(rows, strip.pSrc->height - strip.y);
+				strips.push_back(strip);
+			}
+		}
+	}
+
+	if (strips.empty())
+		return E_UNEXPECTED;
+
+	// Block counts are kept per thread by DirectXTex, so every thread adds what it encoded here.
+	std::mutex blocksMutex;
+	auto addBlocks = [&](const BCBlockStats &start)
+	{
+		if (!pBlocks)
+			return;
+		BCBlockStats now;
+		GetThreadBCBlockStats(now);
+		std::lock_guard<std::mutex> lock(blocksMutex);
+		pBlocks->blocks += now.blocks - start.blocks;
+		pBlocks->solidBlocks += now.solidBlocks - start.solidBlocks;
+		pBlocks->cachedBlocks += now.cachedBlocks - start.cachedBlocks;
+	};
+
+	// The first strip sets up 'result' on this thread; the rest are shared out between the threads.
+	BCBlockStats startBlocks;
+	GetThreadBCBlockStats(startBlocks);
+	ScratchImage buffers[2];
+	HRESULT hr = ConvertStrip(strips[0], chain, info, buffers, result);
+	if (FAILED(hr))
+	{
+		addBlocks(startBlocks);
+		result.Release();
+		return hr;
+	}
+
+	std::atomic<long> status(S_OK);
+	std::atomic<size_t> nextStrip(1);
+	auto convertStrips = [&](ScratchImage workBuffers[2])
+	{
+		for (size_t i = nextStrip++; i < strips.size() && SUCCEEDED(status.load()); i = nextStrip++)
+		{
+			HRESULT shr = ConvertStrip(strips[i], chain, info, workBuffers, result);
+			if (FAILED(shr))
+				status = shr;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	size_t threadCount = std::min<size_t>(std::max<size_t>(chain.threads, 1), strips.size() - 1);
+	for (size_t t = 1; t < threadCount; t++)
+	{
+		workers.push_back(std::thread([&]()
+		{
+			BCBlockStats threadStart;
+			GetThreadBCBlockStats(threadStart);
+			ScratchImage threadBuffers[2];
+			convertStrips(threadBuffers);
+			addBlocks(threadStart);
+		}));
+	}
+	convertStrips(buffers);
+
+	for (auto &w : workers) { w.join(); }
+	addBlocks(startBlocks);
+
+	hr = status;
+	if (FAILED(hr))
+		result.Release();
+	return hr;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "directxtex.h"
+
+// The per-pixel stages of SCTexConvert (BC decode, format convert, premultiply, BC encode)
+// chained together and run one strip of rows at a time, so the data between stages stays in
+// the processor cache instead of going through a full size image for every stage.
+struct STiledChain
+{
+	DXGI_FORMAT	format;				//  Target format, as SCTexConvert's 'tformat'.
+	DWORD		dwConvertFlags;		//  TEX_FILTER_* for Convert.
+	bool		bPremultiply;
+	DWORD		dwPMFlags;			//  TEX_PMALPHA_* for PremultiplyAlpha.
+	bool		bCompress;			//  Encode to 'format' (BC formats, DDS output only).
+	DWORD		dwCompressFlags;	//  TEX_COMPRESS_* for Compress.
+	size_t		mipLevels;			//  Source levels kept: 1 or all of them.
+	size_t		stripBytes;			//  Working set of one strip at 128 bits per pixel.
+	size_t		threads;			//  Strips run side by side, each thread with its own buffers. Leave
+									//  TEX_COMPRESS_PARALLEL out of dwCompressFlags when this is above 1.
+
+	STiledChain() : format(DXGI_FORMAT_UNKNOWN), dwConvertFlags(0), bPremultiply(false), dwPMFlags(0),
+					bCompress(false), dwCompressFlags(0), mipLevels(1), stripBytes(256 * 1024), threads(1) {}
+};
+
+// Runs 'chain' over the first chain.mipLevels levels of every item / slice of 'source'.
+// 'result' gets the format the last stage produced, with the alpha mode set when premultiplied.
+// 'pBlocks', when given, has the BC blocks the strips encoded on all the threads added to it.
+HRESULT ConvertTiled(const DirectX::ScratchImage &source, const STiledChain &chain, DirectX::ScratchImage &result,
+					 DirectX::BCBlockStats *pBlocks = nullptr);
@@ -0,0 +1,366 @@
+//--------------------------------------------------------------------------------------
+// File: Timing.cpp
+//
+// Per-stage timing of SCTexConvert: run totals, CSV / JSON summary and Chrome trace.
+//--------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include "Timing.h"
+#include "FileIO.h"
+
+namespace
+{
+	const char* STAGE_NAMES[STAGE_COUNT] =
+	{
+		"load", "passthrough", "single plane", "tiled chain", "decompress", "flip rotate", "resize", "convert",
+		"mip strip", "mipmaps", "premultiply alpha", "compress", "alpha mode", "save", "write"
+	};
+
+	const char* MODE_NAMES[] = { "off", "summary", "trace" };
+
+	std::atomic<int>	s_nextThread(1);
+	thread_local int	t_thread = 0;
+
+	int ThreadNumber()
+	{
+		if (!t_thread)
+			t_thread = s_nextThread++;
+		return t_thread;
+	}
+
+	void ImageSize(const DirectX::ScratchImage *image, unsigned long long &bytes, unsigned long long &pixels)
+	{
+		bytes = 0;
+		pixels = 0;
+		if (!image || !image->GetImages())
+			return;
+
+		bytes = image->GetPixelsSize();
+		const DirectX::Image *images = image->GetImages();
+		for (size_t i = 0; i < image->GetImageCount(); i++)
+		{
+			pixels += (unsigned long long)images[i].width * images[i].height;
+		}
+	}
+
+	// Share of a stage's BC blocks that came from the block cache.
+	double HitRate(const SStageTotals &t)
+	{
+		return (t.blocks ? double(t.cachedBlocks) / double(t.blocks) : 0.0);
+	}
+
+	long long TotalTicks(const SStageTotals totals[STAGE_COUNT])
+	{
+		long long ticks = 0;
+		for (int s = 0; s < STAGE_COUNT; s++) { ticks += totals[s].ticks; }
+		return ticks;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// CStageTimings
+//--------------------------------------------------------------------------------------
+CStageTimings& CStageTimings::Instance()
+{
+	static CStageTimings s_timings;
+	return s_timings;
+}
+
+void CStageTimings::Reset()
+{
+	for (int s = 0; s < STAGE_COUNT; s++)
+	{
+		m_totals[s] = SStageTotals();
+	}
+	m_events.clear();
+}
+
+void CStageTimings::Enable(TIMING_MODE mode)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Reset();
+	m_origin = IOTimestamp();
+	m_mode = mode;
+}
+
+void CStageTimings::Add(const SStageEvent &event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	SStageTotals &totals = m_totals[event.stage];
+	totals.calls++;
+	totals.failures += (event.bFailed ? 1 : 0);
+	totals.ticks += event.endTicks - event.startTicks;
+	totals.bytesIn += event.bytesIn;
+	totals.bytesOut += event.bytesOut;
+	totals.pixelsIn += event.pixelsIn;
+	totals.pixelsOut += event.pixelsOut;
+	totals.blocks += event.blocks;
+	totals.solidBlocks += event.solidBlocks;
+	totals.cachedBlocks += event.cachedBlocks;
+
+	if (m_mode == TIMING_TRACE)
+		m_events.push_back(event);
+}
+
+void CStageTimings::Totals(SStageTotals totals[STAGE_COUNT]) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int s = 0; s < STAGE_COUNT; s++) { totals[s] = m_totals[s]; }
+}
+
+bool CStageTimings::Write(const string &basePath)
+{
+	if (!IsEnabled())
+		return true;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	bool ok = WriteCsv(basePath + "_timing.csv");
+	ok = WriteJson(basePath + "_timing.json") && ok;
+	if (m_mode == TIMING_TRACE)
+		ok = WriteTrace(basePath + "_trace.json") && ok;
+	return ok;
+}
+
+bool CStageTimings::WriteCsv(const string &path) const
+{
+	std::ofstream csv(path, std::ofstream::out | std::ofstream::trunc);
+	if (!csv)
+		return false;
+
+	double total = IOSeconds(TotalTicks(m_totals));
+	csv << "stage,calls,failures,seconds,share,bytes_in,bytes_out,pixels_in,pixels_out,mb_per_s,mpixels_per_s,"
+		   "bc_blocks,bc_solid_blocks,bc_cached_blocks,bc_cache_hit_rate\n";
+	for (int s = 0; s < STAGE_COUNT; s++)
+	{
+		const SStageTotals &t = m_totals[s];
+		double seconds = IOSeconds(t.ticks);
+		char buffer[512];
+		sprintf_s(buffer, "%s,%llu,%llu,%.6f,%.4f,%llu,%llu,%llu,%llu,%.2f,%.2f,%llu,%llu,%llu,%.4f\n", STAGE_NAMES[s], t.calls, t.failures,
+				  seconds, (total > 0.0 ? seconds / total : 0.0), t.bytesIn, t.bytesOut, t.pixelsIn, t.pixelsOut,
+				  ThroughputMBs(t.bytesIn, seconds), (seconds > 0.0 ? double(t.pixelsIn) / 1.0e6 / seconds : 0.0),
+				  t.blocks, t.solidBlocks, t.cachedBlocks, HitRate(t));
+		csv << buffer;
+	}
+	return csv.good();
+}
+
+bool CStageTimings::WriteJson(const string &path) const
+{
+	std::ofstream json(path, std::ofstream::out | std::ofstream::trunc);
+	if (!json)
+		return false;
+
+	double total = IOSeconds(TotalTicks(m_totals));
+	json << "{\n  \"seconds\": " << total << ",\n  \"stages\": [\n";
+	for (int s = 0; s < STAGE_COUNT; s++)
+	{
+		const SStageTotals &t = m_totals[s];
+		double seconds = IOSeconds(t.ticks);
+		json << "    { \"stage\": " << JsonString(STAGE_NAMES[s]) << ", \"calls\": " << t.calls << ", \"failures\": " << t.failures
+			 << ", \"seconds\": " << seconds << ", \"bytesIn\": " << t.bytesIn << ", \"bytesOut\": " << t.bytesOut
+			 << ", \"pixelsIn\": " << t.pixelsIn << ", \"pixelsOut\": " << t.pixelsOut << ", \"bcBlocks\": " << t.blocks
+			 << ", \"bcSolidBlocks\": " << t.solidBlocks << ", \"bcCachedBlocks\": " << t.cachedBlocks
+			 << ", \"bcCacheHitRate\": " << HitRate(t) << " }"
+			 << (s + 1 < STAGE_COUNT ? ",\n" : "\n");
+	}
+	json << "  ]\n}\n";
+	return json.good();
+}
+
+// Chrome trace event format: one complete ("X") event per stage run, times in microseconds.
+bool CStageTimings::WriteTrace(const string &path) const
+{
+	std::ofstream trace(path, std::ofstream::out | std::ofstream::trunc);
+	if (!trace)
+		return false;
+
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (size_t i = 0; i < m_events.size(); i++)
+	{
+		const SStageEvent &e = m_events[i];
+		char buffer[256];
+		sprintf_s(buffer, "{\"name\":\"%s\",\"cat\":\"convert\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f,\"args\":{",
+				  STAGE_NAMES[e.stage], e.thread, IOSeconds(e.startTicks - m_origin) * 1.0e6, IOSeconds(e.endTicks - e.startTicks) * 1.0e6);
+		trace << buffer << "\"file\":" << JsonString(e.file) << ",\"bytesIn\":" << e.bytesIn << ",\"bytesOut\":" << e.bytesOut
+			  << ",\"pixelsIn\":" << e.pixelsIn << ",\"pixelsOut\":" << e.pixelsOut;
+		if (e.blocks)
+		{
+			trace << ",\"bcBlocks\":" << e.blocks << ",\"bcSolidBlocks\":" << e.solidBlocks << ",\"bcCachedBlocks\":" << e.cachedBlocks;
+		}
+		trace << ",\"failed\":" << (e.bFailed ? "true" : "false")
+			  << "}}" << (i + 1 < m_events.size() ? ",\n" : "\n");
+	}
+	trace << "]}\n";
+	return trace.good();
+}
+
+//--------------------------------------------------------------------------------------
+// CStageClock
+//--------------------------------------------------------------------------------------
+CStageClock::CStageClock(CONVERT_STAGE stage, const string &file, const DirectX::ScratchImage *input, SStageTotals *totals)
+	: m_event(), m_pTotals(totals), m_bDone(false)
+{
+	m_bActive = (totals != nullptr) || CStageTimings::Instance().IsEnabled();
+	if (!m_bActive)
+		return;
+
+	m_event.stage = stage;
+	m_event.file = file;
+	ImageSize(input, m_event.bytesIn, m_event.pixelsIn);
+	m_event.startTicks = IOTimestamp();
+}
+
+CStageClock::~CStageClock()
+{
+	if (m_bActive && !m_bDone)
+	{
+		m_event.bFailed = true;
+		Record();
+	}
+}
+
+void CStageClock::Done(const DirectX::ScratchImage *output)
+{
+	if (!m_bActive || m_bDone)
+		return;
+
+	unsigned long long bytes, pixels;
+	ImageSize(output, bytes, pixels);
+	Done(bytes, pixels);
+}
+
+void CStageClock::Done(unsigned long long bytesOut, unsigned long long pixelsOut)
+{
+	if (!m_bActive || m_bDone)
+		return;
+
+	m_event.bytesOut = bytesOut;
+	m_event.pixelsOut = pixelsOut;
+	m_bDone = true;
+	Record();
+}
+
+void CStageClock::AddBlocks(const DirectX::BCBlockStats &blocks)
+{
+	m_event.blocks += blocks.blocks;
+	m_event.solidBlocks += blocks.solidBlocks;
+	m_event.cachedBlocks += blocks.cachedBlocks;
+}
+
+void CStageClock::Record()
+{
+	m_event.endTicks = IOTimestamp();
+	m_event.thread = ThreadNumber();
+
+	if (m_pTotals)
+	{
+		SStageTotals &t = m_pTotals[m_event.stage];
+		t.calls++;
+		t.failures += (m_event.bFailed ? 1 : 0);
+		t.ticks += m_event.endTicks - m_event.startTicks;
+		t.bytesIn += m_event.bytesIn;
+		t.bytesOut += m_event.bytesOut;
+		t.pixelsIn += m_event.pixelsIn;
+		t.pixelsOut += m_event.pixelsOut;
+		t.blocks += m_event.blocks;
+		t.solidBlocks += m_event.solidBlocks;
+		t.cachedBlocks += m_event.cachedBlocks;
+	}
+	if (CStageTimings::Instance().IsEnabled())
+		CStageTimings::Instance().Add(m_event);
+}
+
+//--------------------------------------------------------------------------------------
+// Names and formatting
+//--------------------------------------------------------------------------------------
+const char* StageName(CONVERT_STAGE stage)
+{
+	return (stage >= STAGE_LOAD && stage < STAGE_COUNT) ? STAGE_NAMES[stage] : "unknown";
+}
+
+bool ParseTimingMode(const string &value, TIMING_MODE &mode)
+{
+	for (int i = TIMING_OFF; i <= TIMING_TRACE; i++)
+	{
+		if (value.find(MODE_NAMES[i]) != string::npos)
+		{
+			mode = (TIMING_MODE)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* TimingModeName(TIMING_MODE mode)
+{
+	return MODE_NAMES[(mode >= TIMING_OFF && mode <= TIMING_TRACE) ? mode : TIMING_OFF];
+}
+
+string JsonString(const string &text)
+{
+	string out = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char buffer[8];
+			sprintf_s(buffer, "\\u%04x", (unsigned)(unsigned char)c);
+			out += buffer;
+		}
+		else
+		{
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+DirectX::BCBlockStats BlocksSince(const DirectX::BCBlockStats &start)
+{
+	DirectX::BCBlockStats now;
+	DirectX::GetThreadBCBlockStats(now);
+	now.blocks -= start.blocks;
+	now.solidBlocks -= start.solidBlocks;
+	now.cachedBlocks -= start.cachedBlocks;
+	return now;
+}
+
+unsigned long long FileBytes(const string &path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+		return 0;
+
+	return ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+}
+
+void FormatStageTotals(const SStageTotals totals[STAGE_COUNT], vector<string> &lines)
+{
+	double total = IOSeconds(TotalTicks(totals));
+	for (int s = 0; s < STAGE_COUNT; s++)
+	{
+		const SStageTotals &t = totals[s];
+		if (!t.calls)
+			continue;
+
+		double seconds = IOSeconds(t.ticks);
+		char buffer[160];
+		sprintf_s(buffer, "%-18s %9.3f s %5.1f%%  %s", STAGE_NAMES[s], seconds, (total > 0.0 ? 100.0 * seconds / total : 0.0),
+				  FormatThroughput(t.bytesIn, seconds).c_str());
+		string line = buffer;
+		if (t.blocks)
+		{
+			sprintf_s(buffer, "  [%llu BC blocks, %.1f%% cached, %llu solid]", t.blocks, 100.0 * HitRate(t), t.solidBlocks);
+			line += buffer;
+		}
+		lines.push_back(line);
+	}
+}
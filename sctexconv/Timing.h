@@ -0,0 +1,142 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "directxtex.h"
+
+using namespace std;
+
+// Stages of one SCTexConvert pass, in pipeline order.
+enum CONVERT_STAGE
+{
+	STAGE_LOAD = 0,
+	STAGE_PASSTHROUGH,		//  Compressed DDS -> DDS, header rewritten and subresources copied
+	STAGE_SINGLE_PLANE,
+	STAGE_TILED,			//  Decompress ... compress fused, strip at a time
+	STAGE_DECOMPRESS,
+	STAGE_FLIP_ROTATE,
+	STAGE_RESIZE,
+	STAGE_CONVERT,			//  Convert or ComputeNormalMap
+	STAGE_MIP_STRIP,
+	STAGE_MIPMAPS,
+	STAGE_PREMULTIPLY,
+	STAGE_COMPRESS,
+	STAGE_ALPHA_MODE,
+	STAGE_SAVE,				//  Encode and write, or only encode when the writer stage writes
+	STAGE_WRITE,			//  Writer stage: encoded file to disk
+	STAGE_COUNT
+};
+
+// config.txt 'timing' setting.
+enum TIMING_MODE
+{
+	TIMING_OFF = 0,
+	TIMING_SUMMARY,			//  Per-stage totals to *_timing.csv and *_timing.json.
+	TIMING_TRACE			//  ... plus every stage run to *_trace.json (chrome://tracing).
+};
+
+struct SStageTotals
+{
+	unsigned long long	calls;
+	unsigned long long	failures;
+	long long			ticks;
+	unsigned long long	bytesIn;
+	unsigned long long	bytesOut;
+	unsigned long long	pixelsIn;
+	unsigned long long	pixelsOut;
+	unsigned long long	blocks;			//  BC blocks the stage's own CPU Compress calls encoded,
+	unsigned long long	solidBlocks;	//  how many of them were of one color,
+	unsigned long long	cachedBlocks;	//  and how many were copied from an identical earlier block.
+};
+
+// One timed stage run.
+struct SStageEvent
+{
+	CONVERT_STAGE		stage;
+	int					thread;			//  Small per-thread number, for the trace rows.
+	long long			startTicks;
+	long long			endTicks;
+	unsigned long long	bytesIn;
+	unsigned long long	bytesOut;
+	unsigned long long	pixelsIn;
+	unsigned long long	pixelsOut;
+	unsigned long long	blocks;
+	unsigned long long	solidBlocks;
+	unsigned long long	cachedBlocks;
+	bool				bFailed;
+	string				file;
+};
+
+// Run-wide collector of stage timings, fed by CStageClock from every convert worker.
+class CStageTimings
+{
+public:
+	static CStageTimings& Instance();
+
+	void Enable(TIMING_MODE mode);
+	bool IsEnabled() const { return m_mode != TIMING_OFF; }
+
+	void Add(const SStageEvent &event);
+	void Totals(SStageTotals totals[STAGE_COUNT]) const;
+
+	// Writes <base>_timing.csv and <base>_timing.json, and <base>_trace.json in trace mode.
+	// Returns false if any of them could not be written.
+	bool Write(const string &basePath);
+
+private:
+	CStageTimings() : m_mode(TIMING_OFF), m_origin(0) { Reset(); }
+
+	void Reset();
+	bool WriteCsv(const string &path) const;
+	bool WriteJson(const string &path) const;
+	bool WriteTrace(const string &path) const;
+
+	TIMING_MODE				m_mode;
+	long long				m_origin;		//  IOTimestamp() at Enable, trace time zero.
+	mutable std::mutex		m_mutex;
+	SStageTotals			m_totals[STAGE_COUNT];
+	vector<SStageEvent>		m_events;		//  Trace mode only.
+
+	CStageTimings(const CStageTimings&);
+	CStageTimings& operator=(const CStageTimings&);
+};
+
+// Times one stage of one texture. Adds to 'totals' (the caller's own breakdown, may be
+// null) and to CStageTimings when that is enabled; costs nothing when neither wants it.
+// A clock that goes out of scope without Done() records the stage as failed.
+class CStageClock
+{
+public:
+	CStageClock(CONVERT_STAGE stage, const string &file, const DirectX::ScratchImage *input, SStageTotals *totals = nullptr);
+	~CStageClock();
+
+	bool IsActive() const { return m_bActive; }
+	void SetInputBytes(unsigned long long bytes) { m_event.bytesIn = bytes; }
+	void AddBlocks(const DirectX::BCBlockStats &blocks);
+	void Done(const DirectX::ScratchImage *output);
+	void Done(unsigned long long bytesOut, unsigned long long pixelsOut);
+
+private:
+	void Record();
+
+	SStageEvent		m_event;
+	SStageTotals*	m_pTotals;
+	bool			m_bActive;
+	bool			m_bDone;
+
+	CStageClock(const CStageClock&);
+	CStageClock& operator=(const CStageClock&);
+};
+
+const char* StageName(CONVERT_STAGE stage);
+bool ParseTimingMode(const string &value, TIMING_MODE &mode);
+const char* TimingModeName(TIMING_MODE mode);
+unsigned long long FileBytes(const string &path);		//  0 if it cannot be read.
+string JsonString(const string &text);					//  Quoted and escaped.
+
+// BC blocks compressed on the calling thread since 'start' (from GetThreadBCBlockStats).
+DirectX::BCBlockStats BlocksSince(const DirectX::BCBlockStats &start);
+
+// One line per stage that ran: calls, seconds, share and throughput.
+void FormatStageTotals(const SStageTotals totals[STAGE_COUNT], vector<string> &lines);
@@ -5,12 +5,16 @@
 #include <fstream>
 #include <cstdio>
 #include <string>
+#include <vector>
+#include "FileIndex.h"
 
 using namespace std;
 
 const int HEADER_SIZE_DDS   = 128;
 const int HEADER_SIZE_DX10  = 20;
+const int HEADER_SIZE_PROBE = HEADER_SIZE_DDS + HEADER_SIZE_DX10;	// Magic + DDS_HEADER + DDS_HEADER_DXT10
 const int MAX_MIPMAPS		= 12;
+const size_t UNSPLIT_COPY_THREADS = 4;	// Part copies of one texture; prepare workers already run textures side by side.
 const string GLOSS_KEY		= "_glossMap";
 
 enum UNSPLIT_MODE
@@ -21,10 +25,27 @@ enum UNSPLIT_MODE
 	UNSPLIT_MODE_STRIP = 3	// Valid DDS but needs .0 extension removed.
 };
 
+// Fragment set handed to the converter so split textures are decoded without reassembly.
+struct SSplitSource
+{
+	string			sHeaderFile;	//  Header fragment: *.dds or *.dds.0 (gloss: *.dds.a / *.dds.0a)
+	vector<string>	vParts;			//  Mip part files, largest first: *.dds.N ... *.dds.1
+	DWORD			ddsFlags;		//  Extra DDS_FLAGS for LoadFromSplitDDS (e.g. DDS_FLAGS_SPLIT_ATI1)
+};
+
+// One mip part file of a split texture, placed at its offset in the reassembled DDS.
+struct SSplitPart
+{
+	string				suffix;		//  ".N" or ".Na"
+	unsigned long long	size;
+	unsigned long long	offset;
+};
+
 struct SUFileData
 {
-	std::vector<unsigned char>  finData;		  //  Data loaded in via ifstream.
-	std::vector<unsigned char>  mipmapZero;		  //  first mipmap data.
+	std::vector<unsigned char>  finData;		  //  Header probe: first HEADER_SIZE_PROBE bytes of the header fragment.
+	string			sSourcePath;	  //  Header fragment path. Pixel data is read from here only when needed.
+	unsigned long long fileSize;	  //  Header fragment size in bytes.
 
 	std::string		fourcc;
 	DXGI_FORMAT		dxgi;
@@ -37,6 +58,8 @@ struct SUFileData
 	bool			bIsMaskAlpha;	  //  Some opacity mask files have ".a" file for alpha channel. These
 									  //   mask files have _mask / _opa / _trans in their name. The ".a"
 								      //   file header needs to be modified to 'ATI1' type before conversion.
+	bool			bDirectLoad;	  //  No reassembled .dds on disk - the converter reads 'split' directly.
+	SSplitSource	split;
 };
 
 struct SUnsplitFileNameInfo
@@ -50,6 +73,7 @@ struct SUnsplitFileNameInfo
 	string  sNameAllExt;	//  Filename + ".dds" [+ ".0"]
 	bool	hasGloss;		//  For .ddn and .ddna files. Shows a matching gloss/alpha file exists.
 	string	sGlossName;		//  Output name of gloss file including .dds ext
+	SFragmentSet* pFragments;	//  Indexed fragments for sBaseName - Unsplit decisions read this, not the disk.
 };
 
 // User selected options
@@ -61,12 +85,46 @@ struct SUnsplitOptions
 	bool	bVerbose;
 	bool	bMergeGloss;
 	string	sFileType;
+	int		nUnsplitThreads;	//  Prepare (probe + unsplit) workers, 0 = automatic.
+	int		nConvertThreads;	//  Convert workers, 0 = one per core.
+	int		nWriteThreads;		//  Writer stage workers, 0 = automatic.
+	bool	bUseNVDecompress;	//  Allow nvdecompress.exe as a last resort for textures nothing else could read.
+	int		nLogLevel;			//  LOG_LEVEL: messages below it are not written to the log file.
+	int		nTiming;			//  TIMING_MODE: per-stage timing files written next to the log.
+	bool	bTiled;				//  Run decompress ... compress a strip at a time where possible.
+	int		nMemoryBudgetMB;	//  Memory the convert workers may use at once, 0 = half the physical memory.
+	int		nBCQuality;			//  TEX_COMPRESS_BC_* tier of BC1-3 compression, TEX_COMPRESS_DEFAULT = reference encoder.
+	DXGI_FORMAT	pixelFormat;	//  Batch manifest format for textures with no forced one (not normal maps or masked textures).
+};
+
+// One texture's MessageOut output, held back while its stages run and written in one piece,
+// so the lines of textures converting side by side do not interleave.
+struct SMessageBuffer
+{
+	string	log;		//  As LogMessage would have appended it.
+	string	console;	//  The pieces the progress display lets through, with their line ends.
+};
+
+// While alive, MessageOut on the calling thread adds to 'messages' instead of printing.
+class CMessageCapture
+{
+public:
+	explicit CMessageCapture(SMessageBuffer &messages);
+	~CMessageCapture();
+
+private:
+	SMessageBuffer*	m_pPrevious;
+
+	CMessageCapture(const CMessageCapture&);
+	CMessageCapture& operator=(const CMessageCapture&);
 };
 
 void Cleanup (SUnsplitFileNameInfo &NameInfo, SUFileData &Udata);
 UNSPLIT_MODE DetermineUnsplitMode (SUnsplitFileNameInfo &NameInfo);
 bool FileExists	(string filename);
+bool HasFragment (const SUnsplitFileNameInfo &NameInfo, const string &suffix);
 bool ReassembleDDS (SUnsplitFileNameInfo &NameInfo, SUFileData &Udata, SUnsplitOptions &Uoptions, std::string &logfile);
+void BuildSplitSource (SUnsplitFileNameInfo &NameInfo, SUFileData &Udata);
 void RenameFile	(string oldFileName, string newFileName, bool overwrite);
 void RemoveFile	(string filename);
 bool Unsplit(SUnsplitFileNameInfo &Name, SUnsplitOptions &Options, SUFileData &Udata, std::string &logfile);
@@ -75,4 +133,5 @@ bool LoadConfigFile(string filepath, SUnsplitOptions &options);
 void LogMessage(string &logfile, string &message, bool bkspace);
 void LogOptions(string &logfile, SUnsplitOptions &Options);
 void MessageOut(string &logfile, string &message, bool bkspace, bool newline);
+void WriteMessages(string &logfile, SMessageBuffer &messages);	//  Prints and logs a captured buffer, then empties it.
 
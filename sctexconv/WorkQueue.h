@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Fixed capacity FIFO shared between producer and consumer threads.
+// Push blocks while the queue is full, Pop blocks while it is empty.
+// Once closed, Push fails and Pop drains what is left, then fails.
+// A failed Push leaves the item with the caller.
+template <typename T>
+class CBoundedQueue
+{
+public:
+	explicit CBoundedQueue(size_t capacity) : m_capacity(capacity ? capacity : 1), m_closed(false) {}
+
+	bool Push(const T &item)
+	{
+		T copy(item);
+		return Push(std::move(copy));
+	}
+
+	bool Push(T &&item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+		if (m_closed)
+			return false;
+
+		m_items.push_back(std::move(item));
+		m_notEmpty.notify_one();
+		return true;
+	}
+
+	bool Pop(T &item)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+		if (m_items.empty())
+			return false;
+
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmpty.notify_all();
+		m_notFull.notify_all();
+	}
+
+	size_t Size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_items.size();
+	}
+
+	bool IsClosed() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_closed;
+	}
+
+private:
+	mutable std::mutex			m_mutex;
+	std::condition_variable		m_notEmpty;
+	std::condition_variable		m_notFull;
+	std::deque<T>				m_items;
+	size_t						m_capacity;
+	bool						m_closed;
+
+	CBoundedQueue(const CBoundedQueue&);
+	CBoundedQueue& operator=(const CBoundedQueue&);
+};
@@ -27,6 +27,11 @@
 #include <regex>
 #include <atlbase.h>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
 #include <wrl\client.h>
 
 #include <dxgiformat.h>
@@ -37,6 +42,20 @@
 #include "directxtex.h"
 #include "directxtexp.h"
 #include "Unsplit.h"
+#include "FileIO.h"
+#include "FileIndex.h"
+#include "FileCrawler.h"
+#include "Manifest.h"
+#include "GlossDecode.h"
+#include "Log.h"
+#include "Progress.h"
+#include "Timing.h"
+#include "TiledConvert.h"
+#include "MemoryBudget.h"
+#include "Batch.h"
+#include "OutputWriter.h"
+#include "Converter.h"
+#include "BCBench.h"
  
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -82,17 +101,12 @@ enum OPTIONS    // Note: dwOptions below assumes 64 or less options.
     OPT_COMPRESS_UNIFORM,
     OPT_COMPRESS_MAX,
     OPT_COMPRESS_DITHER,
+    OPT_TILED,
     OPT_MAX
 };
 
 static_assert( OPT_MAX <= 64, "dwOptions is a DWORD64 bitfield" );
 
-struct SConversion
-{
-    WCHAR szSrc [MAX_PATH];
-    WCHAR szDest[MAX_PATH];
-};
-
 struct SValue
 {
     LPCWSTR pName;
@@ -140,6 +154,7 @@ SValue g_pOptions[] =
     { L"bcuniform",     OPT_COMPRESS_UNIFORM },
     { L"bcmax",         OPT_COMPRESS_MAX },
     { L"bcdither",      OPT_COMPRESS_DITHER },
+    { L"tiled",         OPT_TILED     },
     { nullptr,          0             }
 };
 
@@ -551,6 +566,8 @@ void PrintUsage()
     wprintf( L"   -dx10               Force use of 'DX10' extended header\n");
     wprintf( L"\n   -nologo             suppress copyright message\n");
     wprintf( L"   -timing             Display elapsed processing time\n\n");
+    wprintf( L"   -tiled              Decompress, convert and compress a strip at a time\n"
+             L"                       when no stage needs the whole image\n");
 #ifdef _OPENMP
     wprintf( L"   -singleproc         Do not use multi-threaded compression\n");
 #endif
@@ -703,54 +720,52 @@ void FitPowerOf2( size_t origx, size_t origy, size_t& targetx, size_t& targety,
 
 #pragma region CONVERTER
 
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
 //--------------------------------------------------------------------------------------
-// Previous Entry-point for stand-alone MS Texture Converter
+// Converter context. Options are parsed once per context instead of once per texture.
 //--------------------------------------------------------------------------------------
-#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+static wstring FileTypeExtension(DWORD fileType)
+{
+    const WCHAR* name = LookupByValue(fileType, g_pSaveFileTypes);
+    return wstring(L".") + (name ? name : L"unknown");
+}
 
-//int __cdecl SCTexConvert(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
-int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount)
-{
-    // Parameters and defaults
-    size_t width = 0;
-    size_t height = 0; 
-    size_t mipLevels = 0;
-    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-    DWORD dwFilter = TEX_FILTER_DEFAULT;
-    DWORD dwSRGB = 0;
-    DWORD dwCompress = TEX_COMPRESS_DEFAULT;
-    DWORD dwFilterOpts = 0;
-    DWORD FileType = CODEC_DDS;
-    DWORD maxSize = 16384;
-    float alphaWeight = 1.f;
-    DWORD dwNormalMap = 0;
-    float nmapAmplitude = 1.f;
-
-    WCHAR szPrefix   [MAX_PATH];
-    WCHAR szSuffix   [MAX_PATH];
-    WCHAR szOutputDir[MAX_PATH];
-
-    szPrefix[0]    = 0;
-    szSuffix[0]    = 0;
-    szOutputDir[0] = 0;
+// WIC needs COM on every thread that loads or saves an image; it is initialised on first use.
+static HRESULT InitializeThreadCOM()
+{
+    thread_local HRESULT t_hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    return t_hr;
+}
 
-	std::string msg = "";
+SConvertSettings::SConvertSettings()
+    : width(0), height(0), mipLevels(0), format(DXGI_FORMAT_UNKNOWN), dwFilter(TEX_FILTER_DEFAULT), dwSRGB(0),
+      dwCompress(TEX_COMPRESS_DEFAULT), dwFilterOpts(0), FileType(CODEC_DDS), maxSize(16384), alphaWeight(1.f),
+      dwNormalMap(0), nmapAmplitude(1.f), dwOptions(0), sExtension(FileTypeExtension(CODEC_DDS))
+{
+}
 
-    // Initialize COM (needed for WIC)
-    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    if( FAILED(hr) )
-    {
-		failcount++;
-       // wprintf( L" Failed to initialize COM (%08X)\n", hr);
+bool CConverterContext::SetOptions(int argc, wchar_t* argv[], std::list<SConversion> &conversion, std::string &logfile, int &failcount)
+{
+    // The parser fills in the settings in place
+    size_t &width = m_settings.width;
+    size_t &height = m_settings.height;
+    size_t &mipLevels = m_settings.mipLevels;
+    DXGI_FORMAT &format = m_settings.format;
+    DWORD &dwFilter = m_settings.dwFilter;
+    DWORD &dwSRGB = m_settings.dwSRGB;
+    DWORD &dwCompress = m_settings.dwCompress;
+    DWORD &dwFilterOpts = m_settings.dwFilterOpts;
+    DWORD &FileType = m_settings.FileType;
+    DWORD &maxSize = m_settings.maxSize;
+    float &alphaWeight = m_settings.alphaWeight;
+    DWORD &dwNormalMap = m_settings.dwNormalMap;
+    float &nmapAmplitude = m_settings.nmapAmplitude;
+    DWORD64 &dwOptions = m_settings.dwOptions;
 
-		MessageOut(logfile, (" Failed to initialize COM " + to_string(hr)), false, true);
-        return 1;
-    }
+	std::string msg = "";
 
     // Process command line
-    DWORD64 dwOptions = 0;
-    std::list<SConversion> conversion;
-
     for(int iArg = 1; iArg < argc; iArg++)
     {
         PWSTR pArg = argv[iArg];
@@ -773,7 +788,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 				failcount++;
 				MessageOut(logfile, (msg + " Invalid option passed to converter"), false, true);
 				//PrintUsage();
-                return 1;
+                return false;
             }
 
             dwOptions |= (DWORD64(1) << dwOption);
@@ -785,7 +800,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 && (OPT_SRGB != dwOption) && (OPT_SRGBI != dwOption) && (OPT_SRGBO != dwOption)
                 && (OPT_HFLIP != dwOption) && (OPT_VFLIP != dwOption)
                 && (OPT_COMPRESS_UNIFORM != dwOption) && (OPT_COMPRESS_MAX != dwOption) && (OPT_COMPRESS_DITHER != dwOption)
-                && (OPT_DDS_DWORD_ALIGN != dwOption) && (OPT_USE_DX10 != dwOption) )
+                && (OPT_DDS_DWORD_ALIGN != dwOption) && (OPT_USE_DX10 != dwOption) && (OPT_TILED != dwOption) )
             {
                 if(!*pValue)
                 {
@@ -795,7 +810,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 						failcount++;
 						MessageOut(logfile, (msg + " Invalid option passed to converter"), false, true);
                         //PrintUsage();
-                        return 1;
+                        return false;
                     }
 
                     iArg++;
@@ -813,7 +828,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                  //   wprintf( L"Invalid value specified with -w (%ls)\n", pValue);
                     wprintf( L"\n");
                    // PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -825,7 +840,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                  //   wprintf( L"Invalid value specified with -h (%ls)\n", pValue);
                     printf("\n");
                     //PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -837,7 +852,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                  //   wprintf( L"Invalid value specified with -m (%ls)\n", pValue);
                     wprintf( L"\n");
                     //PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -850,7 +865,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                   //  wprintf( L"Invalid value specified with -f (%ls)\n", pValue);
                     wprintf( L"\n");
                     //PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -863,7 +878,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                   //  wprintf( L"Invalid value specified with -if (%ls)\n", pValue);
                     wprintf( L"\n");
                     //PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -884,15 +899,15 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 break;
 
             case OPT_PREFIX:
-                wcscpy_s(szPrefix, MAX_PATH, pValue);
+                m_settings.sPrefix = pValue;
                 break;
 
             case OPT_SUFFIX:
-                wcscpy_s(szSuffix, MAX_PATH, pValue);
+                m_settings.sSuffix = pValue;
                 break;
 
             case OPT_OUTPUTDIR:
-                wcscpy_s(szOutputDir, MAX_PATH, pValue);
+                m_settings.sOutputDir = pValue;
                 break;
 
             case OPT_FILETYPE:
@@ -904,7 +919,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                   //  wprintf( L"Invalid value specified with -ft (%ls)\n", pValue);
                     wprintf( L"\n");
                     //PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -915,7 +930,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 					MessageOut(logfile, (msg + " Can't use -wrap and -mirror at same time"), false, true);
                   //  wprintf( L"Can't use -wrap and -mirror at same time\n\n");
                    // PrintUsage();
-                    return 1;
+                    return false;
                 }
                 dwFilterOpts |= TEX_FILTER_WRAP;
                 break;
@@ -927,7 +942,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 					MessageOut(logfile, (msg + " Can't use -wrap and -mirror at same time"), false, true);
                    // wprintf( L"Can't use -wrap and -mirror at same time\n\n");
                     //PrintUsage();
-                    return 1;
+                    return false;
                 }
                 dwFilterOpts |= TEX_FILTER_MIRROR;
                 break;
@@ -962,7 +977,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 						MessageOut(logfile, (msg + " Invalid value specified for -nmap, missing l, r, g, b, or a"), false, true);
                       //  wprintf( L"Invalid value specified for -nmap (%ls), missing l, r, g, b, or a\n\n", pValue );
                        // PrintUsage();
-                        return 1;                        
+                        return false;                        
                     }
 
                     if ( wcschr( pValue, L'm' ) )
@@ -1000,7 +1015,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 					MessageOut(logfile, (msg + " -nmapamp requires -nmap"), false, true);
                    // wprintf( L"-nmapamp requires -nmap\n\n" );
                    // PrintUsage();
-                    return 1;
+                    return false;
                 }
                 else if (swscanf_s(pValue, L"%f", &nmapAmplitude) != 1)
                 {
@@ -1008,7 +1023,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 					MessageOut(logfile, (msg + " Invalid value specified with -nmapamp"), false, true);
                  //   wprintf( L"Invalid value specified with -nmapamp (%ls)\n\n", pValue);
                    // PrintUsage();
-                    return 1;
+                    return false;
                 }
                 else if ( nmapAmplitude < 0.f )
                 {
@@ -1016,7 +1031,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 					MessageOut(logfile, (msg + " Normal map amplitude must be positive"), false, true);
                 //    wprintf( L"Normal map amplitude must be positive (%ls)\n\n", pValue);
                   //  PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -1029,7 +1044,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                   //  wprintf( L"Invalid value specified with -fl (%ls)\n", pValue);
                     wprintf( L"\n");
                    // PrintUsage();
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -1041,7 +1056,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                   //  wprintf( L"Invalid value specified with -aw (%ls)\n", pValue);
                     wprintf( L"\n");
                   //  PrintUsage();
-                    return 1;
+                    return false;
                 }
                 else if ( alphaWeight < 0.f )
                 {
@@ -1049,7 +1064,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 					MessageOut(logfile, (msg + " -aw parameter must be positive "), false, true);
                   //  wprintf( L"-aw (%ls) parameter must be positive\n", pValue);
                     wprintf( L"\n");
-                    return 1;
+                    return false;
                 }
                 break;
 
@@ -1078,42 +1093,265 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
         }
     }
 
-    if(conversion.empty())
+    m_settings.sExtension = FileTypeExtension(FileType);
+    return true;
+}
+
+bool CConverterContext::SetFileType(const string &fileType)
+{
+    ATL::CA2W lpType(fileType.c_str());
+    DWORD codec = LookupByName(lpType, g_pSaveFileTypes);
+    if (!codec)
+        return false;
+
+    m_settings.FileType = codec;
+    m_settings.dwOptions |= (DWORD64(1) << OPT_FILETYPE);
+    m_settings.sExtension = FileTypeExtension(codec);
+    return true;
+}
+
+void CConverterContext::SetTiled(bool bTiled)
+{
+    if (bTiled)
+        m_settings.dwOptions |= (DWORD64(1) << OPT_TILED);
+    else
+        m_settings.dwOptions &= ~(DWORD64(1) << OPT_TILED);
+}
+
+void CConverterContext::SetBCQuality(DWORD dwQuality)
+{
+    m_settings.dwCompress = (m_settings.dwCompress & ~DWORD(TEX_COMPRESS_BC_HIGH)) | dwQuality;
+}
+
+SConvertSettings CConverterContext::JobSettings(const SConvertJob &job) const
+{
+    SConvertSettings settings = m_settings;
+    if (job.format != DXGI_FORMAT_UNKNOWN)
     {
-		failcount++;
-		MessageOut(logfile, (msg + " No files passed to converter "), false, true);
-		//wprintf(L"No files passed to converter\n");
-       // PrintUsage();
-        return 0;
+        settings.format = job.format;
+        settings.dwOptions |= (DWORD64(1) << OPT_FORMAT);
+    }
+    if (job.dwNormalMap)
+    {
+        settings.dwNormalMap = job.dwNormalMap;
+        settings.nmapAmplitude = job.nmapAmplitude;
+        settings.dwOptions |= (DWORD64(1) << OPT_NORMAL_MAP) | (DWORD64(1) << OPT_NORMAL_MAP_AMPLITUDE);
+    }
+    if (job.bTiled)
+    {
+        settings.dwOptions |= (DWORD64(1) << OPT_TILED);
+    }
+    if (!job.sOutputDir.empty())
+    {
+        ATL::CA2W lpDir(job.sOutputDir.c_str());
+        settings.sOutputDir = lpDir;
+        settings.dwOptions |= (DWORD64(1) << OPT_OUTPUTDIR);
     }
+    return settings;
+}
+
+int CConverterContext::Convert(const SConvertJob &job, std::string &logfile, int &failcount)
+{
+    SConvertSettings settings = JobSettings(job);
+
+    std::list<SConversion> conversion(1);
+    ATL::CA2W lpSrc(job.sSource.c_str());
+    wcscpy_s(conversion.front().szSrc, MAX_PATH, lpSrc);
+    conversion.front().szDest[0] = 0;
+
+    m_activeRuns++;
+    int ret = Run(settings, conversion, logfile, failcount, job.split, job.result, job.outputs);
+    m_activeRuns--;
+    return ret;
+}
+
+int CConverterContext::Convert(std::list<SConversion> &conversion, std::string &logfile, int &failcount,
+                               const SSplitSource *split, ScratchImage *result)
+{
+    m_activeRuns++;
+    int ret = Run(m_settings, conversion, logfile, failcount, split, result, nullptr);
+    m_activeRuns--;
+    return ret;
+}
+
+// DirectCompute device for BC6H / BC7, created on first use and shared by every worker.
+ID3D11Device* CConverterContext::ComputeDevice(bool bAllowGpu)
+{
+    std::call_once(m_deviceOnce, [&]()
+    {
+        if ( !bAllowGpu )
+        {
+            wprintf( L"\nWARNING: using BC6H / BC7 CPU codec\n" );
+        }
+        else if ( !CreateDevice( m_device.GetAddressOf() ) )
+        {
+            wprintf( L"\nWARNING: DirectCompute is not available, using BC6H / BC7 CPU codec\n" );
+        }
+    });
+    return m_device.Get();
+}
+
+// Output file name: output dir, prefix, source name without extension, suffix and extension.
+static wstring OutputPath(const SConvertSettings &settings, const WCHAR *fname)
+{
+    wstring dest = settings.sOutputDir;
+    if ( !dest.empty() && dest.back() != L'\\' )
+        dest += L'\\';
+    dest += settings.sPrefix;
+    dest += fname;
+    dest += settings.sSuffix;
+    dest += settings.sExtension;
+    return dest;
+}
+
+// A block compressed DDS saved as DDS in its own format, where nothing but the header
+// changes (DX10 / legacy header, fewer mips), is copied rather than converted. Reads only
+// the source header; fills 'target' with the metadata to write when the texture qualifies.
+static bool PlanPassthroughDDS(const SConvertSettings &settings, const WCHAR *szSrc, const SSplitSource *split, TexMetadata &target)
+{
+    const DWORD64 dwBlocking = (DWORD64(1) << OPT_HFLIP) | (DWORD64(1) << OPT_VFLIP) | (DWORD64(1) << OPT_NORMAL_MAP)
+                             | (DWORD64(1) << OPT_FIT_POWEROF2) | (DWORD64(1) << OPT_DDS_DWORD_ALIGN) | (DWORD64(1) << OPT_EXPAND_LUMINANCE);
+    if ( settings.FileType != CODEC_DDS || ( settings.dwOptions & dwBlocking ) )
+        return false;
 
-    //if(~dwOptions & (DWORD64(1) << OPT_NOLOGO))
-    //    PrintLogo();
+    TexMetadata info;
+    ATL::CA2W lpHeader( split ? split->sHeaderFile.c_str() : "" );
+    HRESULT hr = GetMetadataFromSplitDDS( split ? static_cast<LPCWSTR>( lpHeader ) : szSrc, split ? split->ddsFlags : DDS_FLAGS_NONE, info );
+    if ( FAILED(hr) || !IsCompressed( info.format ) || IsTypeless( info.format ) )
+        return false;
 
-    // Work out out filename prefix and suffix
-    if(szOutputDir[0] && (L'\\' != szOutputDir[wcslen(szOutputDir) - 1]))
-        wcscat_s( szOutputDir, MAX_PATH, L"\\" );
+    if ( settings.format != DXGI_FORMAT_UNKNOWN && settings.format != info.format )
+        return false;
 
-    if(szPrefix[0])
-        wcscat_s(szOutputDir, MAX_PATH, szPrefix);
+    if ( ( settings.width && settings.width != info.width ) || ( settings.height && settings.height != info.height )
+         || info.width > settings.maxSize || info.height > settings.maxSize )
+        return false;
 
-    wcscpy_s(szPrefix, MAX_PATH, szOutputDir);
+    if ( ( settings.dwOptions & (DWORD64(1) << OPT_PREMUL_ALPHA) ) && !info.IsPMAlpha() )
+        return false;
 
-    const WCHAR* fileTypeName = LookupByValue(FileType, g_pSaveFileTypes);
+    // Same rule as the conversion: 0 keeps the source's mips, more than it has needs new ones.
+    size_t tMips = ( !settings.mipLevels && info.mipLevels > 1 ) ? info.mipLevels : settings.mipLevels;
+    if ( !tMips || tMips > info.mipLevels )
+        return false;
 
-    if (fileTypeName)
+    // The alpha mode is taken from the source header, it cannot be measured without decoding.
+    target = info;
+    target.mipLevels = tMips;
+    if ( !HasAlpha( target.format ) )
     {
-        wcscat_s(szSuffix, MAX_PATH, L".");
-        wcscat_s(szSuffix, MAX_PATH, fileTypeName);
+        target.miscFlags2 &= ~TEX_MISC2_ALPHA_MODE_MASK;
     }
-    else
+    return true;
+}
+
+// Target size and mip count of 'info' under 'settings' (0 mips = full chain). Returns true when
+// an explicit -w / -h is over the feature level's maximum size.
+static bool PlanTargetSize( const SConvertSettings &settings, const TexMetadata &info, size_t &twidth, size_t &theight, size_t &tMips )
+{
+    size_t mipLevels = ( settings.FileType != CODEC_DDS ) ? 1 : settings.mipLevels;
+    tMips = ( !mipLevels && info.mipLevels > 1 ) ? info.mipLevels : mipLevels;
+
+    bool sizewarn = false;
+
+    twidth = ( !settings.width ) ? info.width : settings.width;
+    if ( twidth > settings.maxSize )
+    {
+        if ( !settings.width )
+            twidth = settings.maxSize;
+        else
+            sizewarn = true;
+    }
+
+    theight = ( !settings.height ) ? info.height : settings.height;
+    if ( theight > settings.maxSize )
+    {
+        if ( !settings.height )
+            theight = settings.maxSize;
+        else
+            sizewarn = true;
+    }
+
+    if ( settings.dwOptions & (DWORD64(1) << OPT_FIT_POWEROF2) )
+    {
+        FitPowerOf2( info.width, info.height, twidth, theight, settings.maxSize );
+    }
+    return sizewarn;
+}
+
+// The tiled path's conditions, shared by Run and the memory planner (WouldTile): -tiled, no
+// stage that needs the whole image (flip, resize, normal map, new mips) and no BC6H / BC7
+// going to the DirectCompute codec, which takes the image whole. A BC texture saved as DDS in
+// its own format keeps its blocks, so it is not tiled; saved as anything else it is decoded
+// strip at a time like the rest.
+bool CConverterContext::CanTile(const SConvertSettings &settings, const TexMetadata &info, DXGI_FORMAT tformat,
+                                size_t twidth, size_t theight, size_t tMips)
+{
+    DWORD64 dwOptions = settings.dwOptions;
+    if ( !( dwOptions & (DWORD64(1) << OPT_TILED) )
+         || ( dwOptions & ( (DWORD64(1) << OPT_HFLIP) | (DWORD64(1) << OPT_VFLIP) | (DWORD64(1) << OPT_NORMAL_MAP) ) )
+         || info.width != twidth || info.height != theight
+         || !( tMips == 1 || tMips == info.mipLevels )
+         || ( IsCompressed( info.format ) && info.format == tformat && settings.FileType == CODEC_DDS ) )
+        return false;
+
+    if ( IsCompressed( tformat ) && settings.FileType == CODEC_DDS )
+    {
+        switch( tformat )
+        {
+        case DXGI_FORMAT_BC6H_TYPELESS:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_TYPELESS:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return ( ComputeDevice( !(dwOptions & (DWORD64(1) << OPT_NOGPU) ) ) == nullptr );
+        }
+    }
+    return true;
+}
+
+bool CConverterContext::WouldTile(const SConvertJob &job, const TexMetadata &info)
+{
+    SConvertSettings settings = JobSettings( job );
+    size_t tMips, twidth, theight;
+    PlanTargetSize( settings, info, twidth, theight, tMips );
+    return CanTile( settings, info, ( settings.format == DXGI_FORMAT_UNKNOWN ) ? info.format : settings.format, twidth, theight, tMips );
+}
+
+int CConverterContext::Run(const SConvertSettings &settings, std::list<SConversion> &conversion, std::string &logfile, int &failcount,
+                           const SSplitSource *split, ScratchImage *result, vector<SEncodedFile> *outputs)
+{
+    // Parameters and defaults (target size and mips: PlanTargetSize)
+    DXGI_FORMAT format = settings.format;
+    DWORD dwFilter = settings.dwFilter;
+    DWORD dwSRGB = settings.dwSRGB;
+    DWORD dwCompress = settings.dwCompress;
+    DWORD dwFilterOpts = settings.dwFilterOpts;
+    DWORD FileType = settings.FileType;
+    float alphaWeight = settings.alphaWeight;
+    DWORD dwNormalMap = settings.dwNormalMap;
+    float nmapAmplitude = settings.nmapAmplitude;
+    DWORD64 dwOptions = settings.dwOptions;
+
+	std::string msg = "";
+
+    // Initialize COM (needed for WIC), once per thread
+    HRESULT hr = InitializeThreadCOM();
+    if( FAILED(hr) )
     {
-        wcscat_s(szSuffix, MAX_PATH, L".unknown");
+		failcount++;
+		MessageOut(logfile, (" Failed to initialize COM " + to_string(hr)), false, true);
+        return 1;
     }
 
-    if (FileType != CODEC_DDS)
+    if(conversion.empty())
     {
-        mipLevels = 1;
+		failcount++;
+		MessageOut(logfile, (msg + " No files passed to converter "), false, true);
+		//wprintf(L"No files passed to converter\n");
+       // PrintUsage();
+        return 0;
     }
 
     LARGE_INTEGER qpcFreq;
@@ -1129,10 +1367,13 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
         qpcStart.QuadPart = 0;
     }
 
+    // Per-stage breakdown of this call for -timing. The run-wide CStageTimings is fed either way.
+    SStageTotals stageTotals[STAGE_COUNT] = {};
+    SStageTotals *pStageTotals = ( dwOptions & (DWORD64(1) << OPT_TIMING) ) ? stageTotals : nullptr;
+
     // Convert images
     bool nonpow2warn = false;
     bool non4bc = false;
-    ComPtr<ID3D11Device> pDevice;
 
     for( auto pConv = conversion.begin(); pConv != conversion.end(); ++pConv )
     {
@@ -1153,6 +1394,67 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
         WCHAR fname[_MAX_FNAME];
         _wsplitpath_s( pConv->szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT );
 
+        // --- Compressed passthrough --------------------------------------------------
+        // Header rewritten, subresources copied by byte range: no image is loaded or decoded.
+        TexMetadata pinfo;
+        if ( !result && _wcsicmp( ext, L".dds" ) == 0 && PlanPassthroughDDS( settings, pConv->szSrc, split, pinfo ) )
+        {
+            std::vector<std::wstring> wParts;
+            std::vector<LPCWSTR> pParts;
+            if ( split )
+            {
+                for ( const auto &part : split->vParts )
+                {
+                    ATL::CA2W lpPart( part.c_str() );
+                    wParts.push_back( std::wstring( lpPart ) );
+                }
+                for ( const auto &part : wParts )
+                {
+                    pParts.push_back( part.c_str() );
+                }
+            }
+            ATL::CA2W lpHeader( split ? split->sHeaderFile.c_str() : src.c_str() );
+
+            CStageClock stageClock( STAGE_PASSTHROUGH, src, nullptr, pStageTotals );
+            SEncodedFile encoded;
+            hr = CopySplitDDSToMemory( lpHeader, pParts.empty() ? nullptr : pParts.data(), pParts.size(), split ? split->ddsFlags : DDS_FLAGS_NONE,
+                                       pinfo, 0, (dwOptions & (DWORD64(1) << OPT_USE_DX10) ) ? (DDS_FLAGS_FORCE_DX10_EXT|DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE,
+                                       encoded.blob );
+            if ( SUCCEEDED(hr) )
+            {
+                stageClock.Done( encoded.blob.GetBufferSize(), 0 );
+                PrintInfo( pinfo, logfile );
+
+                wstring dest = OutputPath( settings, fname );
+                wcscpy_s(pConv->szDest, MAX_PATH, dest.c_str());
+                ATL::CW2A lpDst(pConv->szDest);
+                encoded.sPath = lpDst;
+                MessageOut(logfile, ("\n\t\tcompressed passthrough to " + encoded.sPath + "..."), false, false);
+
+                if ( outputs )
+                {
+                    outputs->push_back( std::move( encoded ) );
+                }
+                else
+                {
+                    hr = WriteEncodedFile( encoded );
+                }
+
+                if ( FAILED(hr) )
+                {
+                    failcount++;
+                    MessageOut(logfile, (msg + " FAILED image save " + to_string(hr)), true, true);
+                    continue;
+                }
+                msg = "OK.";
+                MessageOut(logfile, msg, true, false);
+                continue;
+            }
+
+            // Anything the copy cannot handle goes through the full conversion below.
+            MessageOut(logfile, ("passthrough not possible (" + to_string(hr) + "), converting\n\t\t"), false, false);
+        }
+
         TexMetadata info;
         std::unique_ptr<ScratchImage> image( new (std::nothrow) ScratchImage );
 
@@ -1164,6 +1466,17 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             return 1;
         }
 
+        CStageClock loadClock( STAGE_LOAD, src, nullptr, pStageTotals );
+        if ( loadClock.IsActive() )
+        {
+            unsigned long long bytes = FileBytes( split ? split->sHeaderFile : src );
+            if ( split )
+            {
+                for ( const auto &part : split->vParts ) { bytes += FileBytes( part ); }
+            }
+            loadClock.SetInputBytes( bytes );
+        }
+
         if ( _wcsicmp( ext, L".dds" ) == 0 )
         {
             DWORD ddsFlags = DDS_FLAGS_NONE;
@@ -1172,7 +1485,29 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             if ( dwOptions & (DWORD64(1) << OPT_EXPAND_LUMINANCE) )
                 ddsFlags |= DDS_FLAGS_EXPAND_LUMINANCE;
 
-            hr = LoadFromDDSFile( pConv->szSrc, ddsFlags, &info, *image );
+            if ( split )
+            {
+                // Split texture: read the header fragment and mip parts straight into the image
+                ATL::CA2W lpHeader( split->sHeaderFile.c_str() );
+                std::vector<std::wstring> wParts;
+                std::vector<LPCWSTR> pParts;
+                for ( const auto &part : split->vParts )
+                {
+                    ATL::CA2W lpPart( part.c_str() );
+                    wParts.push_back( std::wstring( lpPart ) );
+                }
+                for ( const auto &part : wParts )
+                {
+                    pParts.push_back( part.c_str() );
+                }
+
+                hr = LoadFromSplitDDS( lpHeader, pParts.empty() ? nullptr : pParts.data(), pParts.size(),
+                                       ddsFlags | split->ddsFlags, &info, *image );
+            }
+            else
+            {
+                hr = LoadFromDDSFile( pConv->szSrc, ddsFlags, &info, *image );
+            }
             if ( FAILED(hr) )
             {
 				failcount++;
@@ -1239,30 +1574,11 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             }
         }
 
+        loadClock.Done( image.get() );
         PrintInfo( info , logfile );
 
-        size_t tMips = ( !mipLevels && info.mipLevels > 1 ) ? info.mipLevels : mipLevels;
-
-        bool sizewarn = false;
-
-        size_t twidth = ( !width ) ? info.width : width;
-        if ( twidth > maxSize )
-        {
-            if ( !width )
-                twidth = maxSize;
-            else
-                sizewarn = true;
-        }
-
-        size_t theight = ( !height ) ? info.height : height;
-        if ( theight > maxSize )
-        {
-            if ( !height )
-                theight = maxSize;
-            else
-                sizewarn = true;
-        }
-
+        size_t tMips, twidth, theight;
+        bool sizewarn = PlanTargetSize( settings, info, twidth, theight, tMips );
         if ( sizewarn )
         {
 			failcount++;
@@ -1270,11 +1586,6 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
            // wprintf( L"\nWARNING: Target size exceeds maximum size for feature level (%u)\n", maxSize );
         }
 
-        if (dwOptions & (DWORD64(1) << OPT_FIT_POWEROF2))
-        {
-            FitPowerOf2( info.width, info.height, twidth, theight, maxSize );
-        }
-
         // Convert texture
 		MessageOut(logfile, (msg + "as"), true, false);
         //wprintf( L" as");
@@ -1296,6 +1607,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 return 1;
             }
 
+            CStageClock stageClock( STAGE_SINGLE_PLANE, src, image.get(), pStageTotals );
             hr = ConvertToSinglePlane( img, nimg, info, *timage );
             if ( FAILED(hr) )
             {
@@ -1318,14 +1630,79 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             assert( info.miscFlags2 == tinfo.miscFlags2 );
             assert( info.dimension == tinfo.dimension );
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
         }
 
         DXGI_FORMAT tformat = ( format == DXGI_FORMAT_UNKNOWN ) ? info.format : format;
 
+        // --- Tiled decompress/convert/premultiply/compress ---------------------------
+        bool bTiled = false;
+        if ( CanTile( settings, info, tformat, twidth, theight, tMips ) )
+        {
+            STiledChain chain;
+            chain.format = tformat;
+            chain.dwConvertFlags = dwFilter | dwFilterOpts | dwSRGB;
+            chain.bPremultiply = ( dwOptions & (DWORD64(1) << OPT_PREMUL_ALPHA) ) && !info.IsPMAlpha();
+            chain.dwPMFlags = dwSRGB;
+            chain.bCompress = IsCompressed( tformat ) && ( FileType == CODEC_DDS );
+            chain.dwCompressFlags = dwCompress | dwSRGB;
+            // Strips run side by side rather than each Compress call starting its own threads,
+            // block scratch and block cache. The convert workers share the cores: with every
+            // worker busy each texture gets one strip thread.
+            if ( !(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC) ) )
+            {
+                unsigned cores = std::max<unsigned>( std::thread::hardware_concurrency(), 1u );
+                chain.threads = std::max<unsigned>( cores / std::max<unsigned>( m_activeRuns.load(), 1u ), 1u );
+            }
+            chain.mipLevels = tMips;
+
+            std::unique_ptr<ScratchImage> timage( new (std::nothrow) ScratchImage );
+            if ( !timage )
+            {
+                failcount++;
+                MessageOut(logfile, (msg + " ERROR: Memory allocation failed (Tiled ScratchImage timage)."), false, true);
+                return 1;
+            }
+
+            CStageClock stageClock( STAGE_TILED, src, image.get(), pStageTotals );
+            BCBlockStats tiledBlocks = { 0, 0, 0 };
+            hr = ConvertTiled( *image, chain, *timage, &tiledBlocks );
+            stageClock.AddBlocks( tiledBlocks );
+            if ( FAILED(hr) )
+            {
+                // The tiled chain is only a shortcut: the stages below convert the whole image instead.
+                MessageOut(logfile, (msg + " tiled convert failed " + to_string(hr) + ", converting stage by stage"), true, false);
+            }
+            else
+            {
+                auto& tinfo = timage->GetMetadata();
+
+                info.format = tinfo.format;
+                info.mipLevels = tinfo.mipLevels;
+                info.miscFlags2 = tinfo.miscFlags2;
+
+                assert( info.width == tinfo.width );
+                assert( info.height == tinfo.height );
+                assert( info.depth == tinfo.depth );
+                assert( info.arraySize == tinfo.arraySize );
+                assert( info.miscFlags == tinfo.miscFlags );
+                assert( info.dimension == tinfo.dimension );
+
+                if ( IsCompressed( info.format ) && ( (info.width % 4) != 0 || (info.height % 4) != 0 ) )
+                {
+                    non4bc = true;
+                }
+
+                stageClock.Done( timage.get() );
+                image.swap( timage );
+                bTiled = true;
+            }
+        }
+
         // --- Decompress --------------------------------------------------------------
         std::unique_ptr<ScratchImage> cimage;
-        if ( IsCompressed( info.format ) )
+        if ( !bTiled && IsCompressed( info.format ) )
         {
             auto img = image->GetImage(0,0,0);
             assert( img );
@@ -1340,6 +1717,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 return 1;
             }
 
+            CStageClock stageClock( STAGE_DECOMPRESS, src, image.get(), pStageTotals );
             hr = Decompress( img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage );
             if ( FAILED(hr) )
             {
@@ -1362,6 +1740,8 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             assert( info.miscFlags2 == tinfo.miscFlags2 );
             assert( info.dimension == tinfo.dimension );
 
+            stageClock.Done( timage.get() );
+
             if ( FileType == CODEC_DDS )
             {
                 // Keep the original compressed image in case we can reuse it
@@ -1396,6 +1776,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 
             assert( dwFlags != 0 );
 
+            CStageClock stageClock( STAGE_FLIP_ROTATE, src, image.get(), pStageTotals );
             hr = FlipRotate( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFlags, *timage );
             if ( FAILED(hr) )
             {
@@ -1420,6 +1801,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             assert( info.format == tinfo.format );
             assert( info.dimension == tinfo.dimension );
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
             cimage.reset();
         }
@@ -1436,6 +1818,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 return 1;
             }
 
+            CStageClock stageClock( STAGE_RESIZE, src, image.get(), pStageTotals );
             hr = Resize( image->GetImages(), image->GetImageCount(), image->GetMetadata(), twidth, theight, dwFilter | dwFilterOpts, *timage );
             if ( FAILED(hr) )
             {
@@ -1459,6 +1842,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             assert( info.format == tinfo.format );
             assert( info.dimension == tinfo.dimension );
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
             cimage.reset();
         }
@@ -1481,6 +1865,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 nmfmt = (dwNormalMap & CNMAP_COMPUTE_OCCLUSION) ? DXGI_FORMAT_R32G32B32A32_FLOAT : DXGI_FORMAT_R32G32B32_FLOAT;
             }
 
+            CStageClock stageClock( STAGE_CONVERT, src, image.get(), pStageTotals );
             hr = ComputeNormalMap( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwNormalMap, nmapAmplitude, nmfmt, *timage );
             if ( FAILED(hr) )
             {
@@ -1505,6 +1890,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
 			assert(info.dimension == tinfo.dimension);
 
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
             cimage.reset();
         }
@@ -1519,6 +1905,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 return 1;
             }
 
+            CStageClock stageClock( STAGE_CONVERT, src, image.get(), pStageTotals );
             hr = Convert( image->GetImages(), image->GetImageCount(), image->GetMetadata(), tformat, dwFilter | dwFilterOpts | dwSRGB, 0.5f, *timage );
             if ( FAILED(hr) )
             {
@@ -1542,6 +1929,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             assert( info.miscFlags2 == tinfo.miscFlags2 );
             assert( info.dimension == tinfo.dimension );
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
             cimage.reset();
         }
@@ -1581,6 +1969,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 return 1;
             }
 
+            CStageClock stageClock( STAGE_MIP_STRIP, src, image.get(), pStageTotals );
             TexMetadata mdata = info;
             mdata.mipLevels = 1;
             hr = timage->Initialize( mdata );
@@ -1623,6 +2012,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 }
             }
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
             info.mipLevels = image->GetMetadata().mipLevels;
 
@@ -1680,6 +2070,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 return 1;
             }
 
+            CStageClock stageClock( STAGE_MIPMAPS, src, image.get(), pStageTotals );
             if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
             {
                 hr = GenerateMipMaps3D( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFilter | dwFilterOpts, tMips, *timage );
@@ -1708,12 +2099,14 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             assert( info.miscFlags2 == tinfo.miscFlags2 );
             assert( info.dimension == tinfo.dimension );
 
+            stageClock.Done( timage.get() );
             image.swap( timage );
             cimage.reset();
         }
 
         // --- Premultiplied alpha (if requested) --------------------------------------
-        if ( ( dwOptions & (DWORD64(1) << OPT_PREMUL_ALPHA) )
+        if ( !bTiled
+             && ( dwOptions & (DWORD64(1) << OPT_PREMUL_ALPHA) )
              && HasAlpha( info.format )
              && info.format != DXGI_FORMAT_A8_UNORM )
         {
@@ -1736,6 +2129,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                     return 1;
                 }
 
+                CStageClock stageClock( STAGE_PREMULTIPLY, src, image.get(), pStageTotals );
                 hr = PremultiplyAlpha( img, nimg, info, dwSRGB, *timage );
                 if ( FAILED(hr) )
                 {
@@ -1757,13 +2151,14 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 assert( info.miscFlags2 == tinfo.miscFlags2 );
                 assert( info.dimension == tinfo.dimension );
 
+                stageClock.Done( timage.get() );
                 image.swap( timage );
                 cimage.reset();
             }
         }
 
         // --- Compress ----------------------------------------------------------------
-        if ( IsCompressed( tformat ) && (FileType == CODEC_DDS) )
+        if ( !bTiled && IsCompressed( tformat ) && (FileType == CODEC_DDS) )
         {
             if ( cimage && ( cimage->GetMetadata().format == tformat ) )
             {
@@ -1805,6 +2200,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 }
 
                 bool bc6hbc7=false;
+                ID3D11Device* pDevice = nullptr;
                 switch( tformat )
                 {
                 case DXGI_FORMAT_BC6H_TYPELESS:
@@ -1814,25 +2210,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 case DXGI_FORMAT_BC7_UNORM:
                 case DXGI_FORMAT_BC7_UNORM_SRGB:
                     bc6hbc7=true;
-
-                    {
-                        static bool s_tryonce = false;
-
-                        if ( !s_tryonce )
-                        {
-                            s_tryonce = true;
-
-                            if ( !(dwOptions & (DWORD64(1) << OPT_NOGPU) ) )
-                            {
-                                if ( !CreateDevice( pDevice.GetAddressOf() ) )
-                                    wprintf( L"\nWARNING: DirectCompute is not available, using BC6H / BC7 CPU codec\n" );
-                            }
-                            else
-                            {
-                                wprintf( L"\nWARNING: using BC6H / BC7 CPU codec\n" );
-                            }
-                        }
-                    }
+                    pDevice = ComputeDevice( !(dwOptions & (DWORD64(1) << OPT_NOGPU) ) );
                     break;
                 }
 
@@ -1849,13 +2227,18 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                     non4bc = true;
                 }
 
+                CStageClock stageClock( STAGE_COMPRESS, src, image.get(), pStageTotals );
                 if ( bc6hbc7 && pDevice )
                 {
-                    hr = Compress( pDevice.Get(), img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage );
+                    std::lock_guard<std::mutex> lock( m_deviceMutex );
+                    hr = Compress( pDevice, img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage );
                 }
                 else
                 {
+                    BCBlockStats startBlocks;
+                    GetThreadBCBlockStats( startBlocks );
                     hr = Compress( img, nimg, info, tformat, cflags | dwSRGB, 0.5f, *timage );
+                    stageClock.AddBlocks( BlocksSince( startBlocks ) );
                 }
                 if ( FAILED(hr) )
                 {
@@ -1877,6 +2260,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
                 assert( info.miscFlags2 == tinfo.miscFlags2 );
                 assert( info.dimension == tinfo.dimension );
 
+                stageClock.Done( timage.get() );
                 image.swap( timage );
             }
         }
@@ -1889,6 +2273,7 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
         if ( HasAlpha( info.format )
              && info.format != DXGI_FORMAT_A8_UNORM )
         {
+            CStageClock stageClock( STAGE_ALPHA_MODE, src, image.get(), pStageTotals );
             if ( image->IsAlphaAllOpaque() )
             {
                 info.SetAlphaMode(TEX_ALPHA_MODE_OPAQUE);
@@ -1905,12 +2290,22 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             {
                 info.SetAlphaMode(TEX_ALPHA_MODE_STRAIGHT);
             }
+            stageClock.Done( 0, 0 );
         }
         else
         {
             info.miscFlags2 &= ~TEX_MISC2_ALPHA_MODE_MASK;
         }
 
+        // --- Hand over result --------------------------------------------------------
+        if ( result )
+        {
+            // The caller keeps working on the image in memory and writes it itself.
+            PrintInfo( info , logfile);
+            *result = std::move( *image );
+            continue;
+        }
+
         // --- Save result -------------------------------------------------------------
         {
             auto img = image->GetImage(0,0,0);
@@ -1920,55 +2315,81 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             PrintInfo( info , logfile);
            // wprintf( L"\n");
 
-            // Figure out dest filename
-            WCHAR *pchSlash, *pchDot;
-
-            wcscpy_s(pConv->szDest, MAX_PATH, szPrefix);
+            // Figure out dest filename: output dir, prefix, source name without extension, suffix
+            wstring dest = OutputPath( settings, fname );
+            wcscpy_s(pConv->szDest, MAX_PATH, dest.c_str());
 
-            pchSlash = wcsrchr(pConv->szSrc, L'\\');
-            if(pchSlash != 0)
-                wcscat_s(pConv->szDest, MAX_PATH, pchSlash + 1);
-            else
-                wcscat_s(pConv->szDest, MAX_PATH, pConv->szSrc);
-
-            pchSlash = wcsrchr(pConv->szDest, '\\');
-            pchDot = wcsrchr(pConv->szDest, '.');
-
-            if(pchDot > pchSlash)
-                *pchDot = 0;
-
-            wcscat_s(pConv->szDest, MAX_PATH, szSuffix);
-
-            // Write texture
+            // Write texture to a temporary name, then rename it into place once complete
 			ATL::CW2A lpDst(pConv->szDest);
 			string dst = lpDst;
-			MessageOut(logfile, ("\n\t\twriting " + dst + "..."), false, false);
+			string dstTemp = TempPathFor(dst);
+			ATL::CA2W lpDstTemp(dstTemp.c_str());
+			MessageOut(logfile, ((outputs ? "\n\t\tencoding " : "\n\t\twriting ") + dst + "..."), false, false);
           //  wprintf( L" writing %ls", pConv->szDest);
             fflush(stdout);
 
-            switch( FileType )
+            CStageClock stageClock( STAGE_SAVE, src, image.get(), pStageTotals );
+            DWORD ddsFlags = (dwOptions & (DWORD64(1) << OPT_USE_DX10) ) ? (DDS_FLAGS_FORCE_DX10_EXT|DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE;
+            if ( outputs )
             {
-            case CODEC_DDS:
-                hr = SaveToDDSFile( img, nimg, info,
-                                    (dwOptions & (DWORD64(1) << OPT_USE_DX10) ) ? (DDS_FLAGS_FORCE_DX10_EXT|DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE, 
-                                    pConv->szDest );
-                break;
+                // Encode only. The writer stage puts the file on disk while this thread moves on.
+                SEncodedFile encoded;
+                switch( FileType )
+                {
+                case CODEC_DDS:
+                    hr = SaveToDDSMemory( img, nimg, info, ddsFlags, encoded.blob );
+                    break;
 
-            case CODEC_TGA:
-                hr = SaveToTGAFile( img[0], pConv->szDest );
-                break;
+                case CODEC_TGA:
+                    hr = SaveToTGAMemory( img[0], encoded.blob );
+                    break;
 
-            default:
-                hr = SaveToWICFile( img, nimg, WIC_FLAGS_ALL_FRAMES, GetWICCodec( static_cast<WICCodecs>(FileType) ), pConv->szDest );
-                break;
-            }
+                default:
+                    hr = SaveToWICMemory( img, nimg, WIC_FLAGS_ALL_FRAMES, GetWICCodec( static_cast<WICCodecs>(FileType) ), encoded.blob );
+                    break;
+                }
 
-            if(FAILED(hr))
-            {
+                if ( SUCCEEDED(hr) )
+                {
+                    stageClock.Done( encoded.blob.GetBufferSize(), 0 );
+                    encoded.sPath = dst;
+                    outputs->push_back( std::move( encoded ) );
+                }
+            }
+            else
+            {
+                switch( FileType )
+                {
+                case CODEC_DDS:
+                    hr = SaveToDDSFile( img, nimg, info, ddsFlags, lpDstTemp );
+                    break;
+
+                case CODEC_TGA:
+                    hr = SaveToTGAFile( img[0], lpDstTemp );
+                    break;
+
+                default:
+                    hr = SaveToWICFile( img, nimg, WIC_FLAGS_ALL_FRAMES, GetWICCodec( static_cast<WICCodecs>(FileType) ), lpDstTemp );
+                    break;
+                }
+
+                if (SUCCEEDED(hr) && !PublishFile(dstTemp, dst))
+                {
+                    hr = HRESULT_FROM_WIN32(GetLastError());
+                }
+            }
+
+            if(FAILED(hr))
+            {
+				DiscardFile(dstTemp);
 				failcount++;
 				MessageOut(logfile, (msg + " FAILED image save " + to_string(hr)), true, true);
                // wprintf( L" FAILED (%x)\n", hr);
                 continue;
+            }
+            if ( !outputs )
+            {
+                stageClock.Done( ( stageClock.IsActive() ? FileBytes( dst ) : 0 ), 0 );
             }
 			msg = "OK.";
 			MessageOut(logfile, msg, true, false);
@@ -1990,10 +2411,33 @@ int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount
             LONGLONG delta = qpcEnd.QuadPart - qpcStart.QuadPart;
             wprintf( L"\n Processing time: %f seconds\n", double(delta) / double(qpcFreq.QuadPart) );
         }
+
+        vector<string> lines;
+        FormatStageTotals( stageTotals, lines );
+        for ( auto &line : lines )
+        {
+            MessageOut(logfile, ("\n   " + line), false, false);
+        }
     }
 
     return 0;
 }
+
+//--------------------------------------------------------------------------------------
+// Previous Entry-point for stand-alone MS Texture Converter, for callers that still
+// build a texconv argument list. Parses it into a one-off context.
+//--------------------------------------------------------------------------------------
+int SCTexConvert(int argc, wchar_t* argv[], std::string &logfile, int &failcount, const SSplitSource *split = nullptr,
+				 ScratchImage *result = nullptr)
+{
+	CConverterContext converter;
+	std::list<SConversion> conversion;
+	if (!converter.SetOptions(argc, argv, conversion, logfile, failcount))
+		return 1;
+
+	return converter.Convert(conversion, logfile, failcount, split, result);
+}
+
 #pragma endregion
 
 #pragma region UTILITIES
@@ -2036,96 +2480,6 @@ string CurrentDir()
 	return sDir;
 }
 
-// Recursive file search
-void BuildFileList(string wrkdir, std::list<string> &list, string &logfile, bool isRecursive, int &count)
-{
-	WIN32_FIND_DATA ffd;
-	TCHAR szDir[MAX_PATH];
-	HANDLE hFind = INVALID_HANDLE_VALUE;
-	DWORD dwError = 0;
-	
-	if (!wrkdir.empty() && (wrkdir[wrkdir.length() - 1] != L'\\'))
-	{
-		wrkdir = wrkdir + "\\";
-	}
-
-	// Check that the input path plus 3 is not longer than MAX_PATH.
-	// Three characters are for the "\*" plus NULL appended below.
-
-	if (wrkdir.length() > (MAX_PATH - 3))
-	{
-		_tprintf(TEXT("\n Directory path is too long.\n"));
-		MessageOut(logfile, "\n FILE SEARCH ERROR: Directory path is too long - " + wrkdir + "\n", false, true);
-		return;
-	}
-	CA2CT lptDir(wrkdir.c_str());
-	
-	//std::cout << "Target directory: " << wrkdir << std::endl;
-
-	// Prepare string for use with FindFile functions.  First, copy the
-	// string to a buffer, then append '\*' to the directory name.
-	
-	StringCchCopy(szDir, MAX_PATH, lptDir);
-
-	// Find the first file in the directory.
-	wstring wsff = szDir;
-	wsff += L"*";
-	hFind = FindFirstFile(wsff.c_str(), &ffd);
-
-	if (INVALID_HANDLE_VALUE == hFind)
-	{
-		_tprintf(TEXT("\n FindFirstFile() returned an error.\n"));
-		MessageOut(logfile, "\n FILE SEARCH ERROR: FindFirstFile() returned an error in: " + wrkdir + "\n", false, true);
-		return;
-	}
-
-	do
-	{
-		if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-		{
-			if ((wcscmp(ffd.cFileName, L".") != 0) &&
-				(wcscmp(ffd.cFileName, L"..") != 0))
-			{	
-				ATL::CW2A psName(ffd.cFileName);
-				ATL::CW2A psDir(szDir);
-				string sDir = psDir;
-				string sName = psName;
-				if (isRecursive)
-				{
-					BuildFileList((sDir + sName), list, logfile, true, count);
-				}
-			}
-		}
-		else if ((ffd.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)) == 0)
-		{
-			ATL::CW2A psName(ffd.cFileName);
-			ATL::CW2A psDir(szDir);
-			string sDir = psDir;
-			string sName = psName;
-			char back0 = sName[(sName.length() - 1)];
-			char back1 = sName[(sName.length() - 2)];
-			char back2 = sName[(sName.length() - 3)];
-
-			if ((sName.find(".dds.0") != string::npos) || (((back0 == 's') && (back1 == 'd') && (back2) == 'd')) && (back0 != 'a'))
-			{	
-				if (!(sName.find("_cm") != string::npos)) // Ignore cubemaps
-				{					
-					list.push_back(sDir + sName);
-					
-					string number = to_string(count);
-					for (size_t i = 0; i <= number.length(); i++)	{ std::cout << '\b'; }
-					count++;
-					std::cout << count << std::ends;
-				}
-			}
-		}
-		if (UserWantsToExit()) { exit(EXIT_SUCCESS); }
-
-	} while (FindNextFile(hFind, &ffd));
-		
-	FindClose(hFind);
-	return;
-}
 #pragma endregion
 
 ////////////////////////////////////////////////////////////////////////////////////////
@@ -2135,7 +2489,6 @@ void BuildFileList(string wrkdir, std::list<string> &list, string &logfile, bool
 ////////////////////////////////////////////////////////////////////////////////////////
 void GetFileData(SUnsplitFileNameInfo &info, SUFileData &data, string &logfile)
 {
-	char* buffer	  = new char();
 	string sMagic	  = "DDS ";
 	string mTestDDS	  = "";
 	int counter		  = 0;
@@ -2150,19 +2503,16 @@ void GetFileData(SUnsplitFileNameInfo &info, SUFileData &data, string &logfile)
 
 	string infilepath = info.sDirectory + info.sNameAllExt;
 
-	// Create fstream objects
-	ifstream fin(infilepath, ios::in | ios::binary);
-	if (!fin)
+	// Probe the header only - pixel data is not touched until the file is unsplit or converted.
+	data.sSourcePath = infilepath;
+	ReadFileBytes(infilepath, data.finData, HEADER_SIZE_PROBE, &data.fileSize);
+
+	if (data.finData.size() < (size_t)(HEADER_SIZE_DDS - 4))
 	{
-		MessageOut(logfile, " FAILED: GetFileData() could not open input file: " + infilepath, false, true);
+		MessageOut(logfile, " FAILED: GetFileData() could not read a DDS header from: " + infilepath, false, true);
+		data.finData.clear();
 		return;
 	}
-
-	// Read data
-	while (fin.read((char*)buffer, 1).good()) {
-		data.finData.push_back(*buffer);
-	}
-	fin.close();
 	
 	// Check file name for file type
 	if (info.sName.find("_ddn") != string::npos || info.sName.find("_norm") != string::npos)
@@ -2170,8 +2520,7 @@ void GetFileData(SUnsplitFileNameInfo &info, SUFileData &data, string &logfile)
 		data.bIsNormal = true;
 	}
 
-	if (!(data.bIsGloss) && (FileExists(info.sDirectory + info.sBaseName + ".a")
-		|| FileExists(info.sDirectory + info.sBaseName + ".0a")))
+	if (!(data.bIsGloss) && (HasFragment(info, ".a") || HasFragment(info, ".0a")))
 	{
 		info.hasGloss = true;
 	}
@@ -2237,6 +2586,13 @@ void GetFileData(SUnsplitFileNameInfo &info, SUFileData &data, string &logfile)
 		}
 		else
 		{
+			if (data.finData.size() < (size_t)(HEADER_SIZE_PROBE - offset))
+			{
+				MessageOut(logfile, " FAILED: GetFileData() found a truncated DX10 header in: " + infilepath, false, true);
+				data.finData.clear();
+				return;
+			}
+
 			// Now read in DXT10 Extended Header data (20 bytes)
 			for (int i = 0; i < HEADER_SIZE_DX10; i++)
 			{
@@ -2279,50 +2635,134 @@ void GetFileData(SUnsplitFileNameInfo &info, SUFileData &data, string &logfile)
 	}
 }
 
+// Check the fragment sizes (from the directory index) against the mip layout described by the
+// header. Each part must hold a whole run of mips, largest first, and the header fragment the
+// rest. Arrays, cubes and legacy pixel formats are only checked for their total size.
+bool ValidateSplitLayout(SUFileData &data, const vector<SSplitPart> &parts, unsigned long long tailSize, string &error)
+{
+	unsigned char header[HEADER_SIZE_PROBE];
+	size_t headerSize = HEADER_SIZE_DDS;
+	memcpy(header, data.headerDDS, HEADER_SIZE_DDS);
+	if (data.bIsDX10)
+	{
+		memcpy(header + HEADER_SIZE_DDS, data.headerDDS_Ext, HEADER_SIZE_DX10);
+		headerSize += HEADER_SIZE_DX10;
+	}
+
+	// A header that cannot be read leaves nothing to check the parts against: that is exactly
+	// the malformed input this is here to stop, so it is rejected too.
+	TexMetadata mdata;
+	HRESULT hr = GetMetadataFromDDSMemory(header, headerSize, DDS_FLAGS_NO_LEGACY_EXPANSION, mdata);
+	if (FAILED(hr))
+	{
+		error = "header not readable (" + to_string(hr) + "), the part sizes cannot be checked";
+		return false;
+	}
+
+	vector<unsigned long long> mipSize;
+	for (size_t level = 0; level < mdata.mipLevels; level++)
+	{
+		size_t w = std::max<size_t>(mdata.width >> level, 1);
+		size_t h = std::max<size_t>(mdata.height >> level, 1);
+		size_t d = std::max<size_t>(mdata.depth >> level, 1);
+		size_t rowPitch, slicePitch;
+		ComputePitch(mdata.format, w, h, rowPitch, slicePitch, CP_FLAGS_NONE);
+		mipSize.push_back((unsigned long long)slicePitch * d);
+	}
+
+	unsigned long long expected = 0;
+	for (auto size : mipSize) { expected += size; }
+	expected *= mdata.arraySize;
+
+	unsigned long long actual = tailSize;
+	for (const auto &part : parts) { actual += part.size; }
+
+	if (actual != expected)
+	{
+		error = "fragments hold " + to_string(actual) + " bytes, header describes " + to_string(expected);
+		return false;
+	}
+
+	if (mdata.arraySize > 1)
+		return true;
+
+	size_t level = 0;
+	for (const auto &part : parts)
+	{
+		unsigned long long run = 0;
+		while (run < part.size && level < mipSize.size()) { run += mipSize[level++]; }
+
+		if (run != part.size)
+		{
+			error = "part *" + part.suffix + " is " + to_string(part.size) + " bytes, which does not end on a mip boundary";
+			return false;
+		}
+	}
+	return true;
+}
+
 bool ReassembleDDS(SUnsplitFileNameInfo &info, SUFileData &data, SUnsplitOptions &options, std::string &logfile){
-		
-	// Store mipmap zero data.
-	for (size_t i = 0; i < (data.finData.size() - (size_t)data.mipPos); i++) {
-		data.mipmapZero.push_back(data.finData.at(i + data.mipPos));
+
+	if (data.finData.empty() || data.fileSize < (unsigned long long)data.mipPos)
+	{
+		MessageOut(logfile, " ERROR: Unsplit reconstructor has no header data for: " + info.sNameAllExt, false, true);
+		return false;
 	}
 
-#pragma region DEBUG_PRINT_DATA
-	
-	/*std::cout << " FILE :" << Name.sNameAllExt << std::endl;
-	
-	std::cout << '\n';
-	std::cout << " HEADER_DDS[" << sizeof(data.headerDDS) << "]:" ;
-	for (size_t i = 0; i < sizeof(data.headerDDS) ; i++)
-		std::cout << (char)data.headerDDS[i] << std::ends;
-		
-	std::cout << '\n';
-	std::cout << " HEADER_DDS_EXT[" << sizeof(data.headerDDS_Ext) << "]:";
-	for (size_t i = 0; i < sizeof(data.headerDDS_Ext); i++)
-		std::cout << data.headerDDS_Ext[i] << std::ends;
-	std::cout.flush();
-	std::cout << '\n';
-	std::cout << " FIN_DATA[" << data.finData.size() << "]:";
-	for (const auto &c : data.finData)
-		std::cout << (char)c << std::flush;
-	
-	std::cout << '\n';
-	std::cout << " MIP_POSN(" << data.mipPos << ")" << std::endl;
-	std::cout << " MIP_ZERO[" << data.mipmapZero.size() << "]:";
-	
-	for (const auto &c : data.mipmapZero) 
-		std::cout << c ;
-	std::cout << "\n-------------------------------------------------------------------" << std::endl;*/
-#pragma endregion
+	/*
+	Mipmaps are be numbered in order of	increasing resolution (*.dds.1, *.dds.2, ...), so the
+	parts are joined from the highest extension number to the lowest. The smallest mips live
+	behind the header in the header fragment itself, so they go last.
+
+	Sizes come from the directory index, which gives every fragment its output offset before
+	anything is read - so a broken asset is rejected here, and the parts can be written in parallel. */
+
+	vector<SSplitPart> parts;
+	for (int i = MAX_MIPMAPS; i >= 1; i--)	{
+		SSplitPart part;
+		part.suffix = "." + to_string(i);
+		if (data.bIsGloss) { part.suffix += "a"; }
+
+		if (HasFragment(info, part.suffix)) {
+			part.size = info.pFragments->SizeOf(part.suffix);
+			parts.push_back(part);
+		}
+		else if (!parts.empty()) {
+			MessageOut(logfile, " ERROR: Unsplit reconstructor is missing part *" + part.suffix + " of: " + info.sBaseName, false, true);
+			return false;
+		}
+	}
+
+	unsigned long long tailSize = data.fileSize - data.mipPos;
+	string layoutError;
+	if (!ValidateSplitLayout(data, parts, tailSize, layoutError))
+	{
+		MessageOut(logfile, " ERROR: Unsplit reconstructor rejected " + info.sBaseName + ": " + layoutError, false, true);
+		return false;
+	}
+
+	long long ioStart = IOTimestamp();
 
 	// Rename ".dds" infile to ".dds.0" and delete original
 	if ((options.Umode == UNSPLIT_MODE_FIRST) && !(data.bIsGloss)) {
-		RenameFile(info.sNameAllExt, info.sBaseName + ".0", true);
+		RenameFile(info.sDirectory + info.sNameAllExt, info.sDirectory + info.sBaseName + ".0", true);
+		data.sSourcePath = info.sDirectory + info.sBaseName + ".0";
+		if (info.pFragments) { info.pFragments->Rename("", ".0"); }
 	}
 	
 	string outName = (data.bIsGloss ? info.sDirectory + info.sGlossName : info.sDirectory + info.sBaseName);
+	string tempName = TempPathFor(outName);
+
+	unsigned long long headerSize = sizeof(data.headerDDS) + (data.bIsDX10 ? sizeof(data.headerDDS_Ext) : 0);
+	unsigned long long offset = headerSize;
+	for (auto &part : parts) {
+		part.offset = offset;
+		offset += part.size;
+	}
+	unsigned long long totalSize = offset + tailSize;
 	
-	ofstream fout(outName, ios::out | ios::binary);
-	if (!fout) {
+	COutFile fout;
+	if (!fout.CreateSized(tempName, totalSize)) {
 		std::cout << " ERROR: Unsplit reconstructor could not open ouput file: " << info.sBaseName << endl;
 		return false;
 	}
@@ -2330,47 +2770,87 @@ bool ReassembleDDS(SUnsplitFileNameInfo &info, SUFileData &data, SUnsplitOptions
 	info.sExt2 = "";
 
 	// Write headers
-	for (size_t i = 0; i < sizeof(data.headerDDS); i++)
-		fout << data.headerDDS[i];
+	bool ok = fout.WriteAt(0, data.headerDDS, sizeof(data.headerDDS));
 
-	if (data.bIsDX10) {
-		for (size_t i = 0; i < sizeof(data.headerDDS_Ext); i++)
-			fout << data.headerDDS_Ext[i];
+	if (ok && data.bIsDX10) {
+		ok = fout.WriteAt(sizeof(data.headerDDS), data.headerDDS_Ext, sizeof(data.headerDDS_Ext));
 	}
-	
-	/*
-	Mipmaps are be numbered in order of	increasing resolution (*.dds.0, *.dds.1, *.dds.2, ...) so we can just
-	append files from highest extension number to lowest without needing to check filesize.
 
-	The mip maps must be joined in this order of decreasing size for the DDS file to work as expected.	*/
-
-	ifstream fin;
-	
-	// Append mipmap data to file
-	char* obuffer = new char();
-	string mipfileName;
-
-	for (int i = MAX_MIPMAPS; i >= 0; i--)	{
-		mipfileName = info.sDirectory + info.sBaseName + "." + to_string(i);
-		if (data.bIsGloss) { mipfileName += "a"; }
-
-		fin.open(mipfileName, ios::in | ios::binary);
-		if (fin.good())	{
-			while (fin.read(obuffer, 1).good())	{
-				fout.write(obuffer, 1);
+	// Each part (and the header fragment payload) is copied to its own offset by its own thread.
+	std::atomic<bool> partsOk(ok);
+	std::atomic<size_t> nextPart(0);
+	auto copyParts = [&]()
+	{
+		for (size_t i = nextPart++; i < parts.size() && partsOk; i = nextPart++) {
+			if (!fout.AppendAt(parts[i].offset, info.sDirectory + info.sBaseName + parts[i].suffix, 0, parts[i].size)) {
+				partsOk = false;
 			}
 		}
-		fin.close();
+	};
+
+	vector<std::thread> writers;
+	size_t threadCount = std::min<size_t>(parts.size(), std::min<size_t>(UNSPLIT_COPY_THREADS, std::max<unsigned>(std::thread::hardware_concurrency(), 1u)));
+	for (size_t t = 1; ok && t < threadCount; t++) {
+		writers.push_back(std::thread(copyParts));
+	}
+
+	// Header fragment payload (smallest mips) is only read now, straight from the fragment on disk.
+	if (ok) {
+		ok = fout.AppendAt(totalSize - tailSize, data.sSourcePath, data.mipPos, tailSize);
+		copyParts();
 	}
-	fout.close();
+
+	for (auto &w : writers) { w.join(); }
+	ok = ok && partsOk;
+
+	unsigned long long written = fout.BytesWritten();
+	fout.Close();
+
+	long long ioTicks = IOTimestamp() - ioStart;
+	AddIOStats(0, 0, ioTicks);
+
+	if (!ok || !PublishFile(tempName, outName)) {
+		MessageOut(logfile, " ERROR: Unsplit reconstructor failed writing: " + outName, false, true);
+		DiscardFile(tempName);
+		return false;
+	}
+
+	MessageOut(logfile, " [" + FormatThroughput(written, IOSeconds(ioTicks)) + "]", true, false);
 
 	return true;
 }
 
+// Record the fragments of a split texture so it can be loaded without reassembly.
+void BuildSplitSource(SUnsplitFileNameInfo &info, SUFileData &data)
+{
+	data.split.sHeaderFile = info.sDirectory + info.sNameAllExt;
+	data.split.ddsFlags = (data.bIsMaskAlpha ? DDS_FLAGS_SPLIT_ATI1 : DDS_FLAGS_NONE);
+	data.split.vParts.clear();
+
+	for (int i = MAX_MIPMAPS; i >= 1; i--) {
+		string suffix = "." + to_string(i);
+		if (data.bIsGloss) { suffix += "a"; }
+
+		if (HasFragment(info, suffix)) {
+			data.split.vParts.push_back(info.sDirectory + info.sBaseName + suffix);
+		}
+	}
+
+	data.bDirectLoad = true;
+}
+
+// Live check, only for files written during this run. Inputs are looked up in the index (HasFragment).
 bool FileExists(string filename)
 {
-	ifstream infile(filename);
-	return infile.good();
+	DWORD dwAttrib = GetFileAttributesA(filename.c_str());
+
+	return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
+		!(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+}
+
+bool HasFragment(const SUnsplitFileNameInfo &info, const string &suffix)
+{
+	return (info.pFragments != nullptr) && info.pFragments->Has(suffix);
 }
 
 bool DirectoryExists(LPCTSTR szPath)
@@ -2390,41 +2870,42 @@ void RemoveFile(string filename)
 // Delete the .dds.* file parts
 void Cleanup(SUnsplitFileNameInfo &info, SUFileData &data)
 {
-	string baseName = info.sBaseName;
+	string baseName = info.sDirectory + info.sBaseName;
 	string target;
 	
 	for (int i = 0; i <= MAX_MIPMAPS; i++)
 	{
-		target = baseName + "." + to_string(i);
+		string suffix = "." + to_string(i);
 		
 		if (data.bIsGloss)
 		{
-			target += "a";
+			suffix += "a";
+		}
+
+		if (HasFragment(info, suffix))
+		{
+			target = baseName + suffix;
+			RemoveFile(target);
+			info.pFragments->Remove(suffix);
 		}
-		RemoveFile(target);
 	}
 }
 
+// overwrite = true moves the file (a rename on the same volume), false leaves the original
+// in place (a hard link on the same volume). Data is only copied across volumes.
 void RenameFile(string oldFileName, string newFileName, bool overwrite)
 {
 	if (oldFileName.compare(newFileName) == 0)
 		return;
 
-	char* fileData = new char();
-	ifstream fin(oldFileName, ios::in | ios::binary);
-	ofstream fout(newFileName, ios::out | ios::binary);
-	while (fin.read(fileData, 1).good())
+	if (overwrite)
 	{
-		fout.write(fileData, 1);
+		MovePath(oldFileName, newFileName);
 	}
-	fout.close();
-	fin.close();
-	if (overwrite)
+	else
 	{
-		RemoveFile(oldFileName);
+		LinkOrCopyPath(oldFileName, newFileName);
 	}
-
-	delete[] fileData;
 }
 
 UNSPLIT_MODE DetermineUnsplitMode(SUnsplitFileNameInfo &info)
@@ -2433,8 +2914,7 @@ UNSPLIT_MODE DetermineUnsplitMode(SUnsplitFileNameInfo &info)
 	if(!(info.sExt2.empty())) //A1
 	{	
 		// Target is a ".dds.0" file
-		string sOneFile(info.sDirectory + info.sBaseName + ".1");
-		if (FileExists(sOneFile)) //B1
+		if (HasFragment(info, ".1")) //B1
 		{
 			return UNSPLIT_MODE_SECOND;
 		}
@@ -2446,15 +2926,13 @@ UNSPLIT_MODE DetermineUnsplitMode(SUnsplitFileNameInfo &info)
 	else //A2
 	{
 		//Target is a ".dds" file
-		string sZeroFile(info.sDirectory + info.sBaseName + ".0");
-		if (FileExists(sZeroFile))  //C1
+		if (HasFragment(info, ".0"))  //C1
 		{
 			return UNSPLIT_MODE_NONE;	// File should be an already unsplit DDS -> no unsplit required
 		}
 		else  //C2
 		{
-			string sOneFile(info.sDirectory + info.sBaseName + ".1");
-			if (FileExists(sOneFile)) //D1
+			if (HasFragment(info, ".1")) //D1
 			{
 				return UNSPLIT_MODE_FIRST;
 			}
@@ -2478,17 +2956,18 @@ void InitializeGlossInfo(SUnsplitFileNameInfo &normal, SUnsplitFileNameInfo &glo
 	gloss.sBaseName = gloss.sName + gloss.sExt1;
 	gloss.sNameAllExt = gloss.sName + gloss.sExt1 + gloss.sExt2;
 	gloss.sGlossName = normal.sGlossName;
+	gloss.pFragments = normal.pFragments;
 }
 
 void ProcessGlossMap(SUnsplitFileNameInfo &info, SUnsplitOptions &options, string &logfile)
 {
 	string msg = "";
 	SUnsplitFileNameInfo infoGloss = SUnsplitFileNameInfo();
-	if (FileExists(info.sDirectory + info.sBaseName + ".a"))
+	if (HasFragment(info, ".a"))
 	{
 		InitializeGlossInfo(info, infoGloss, ".a");
 	}
-	else if (FileExists(info.sDirectory + info.sBaseName + ".0a"))
+	else if (HasFragment(info, ".0a"))
 	{
 		InitializeGlossInfo(info, infoGloss, ".0a");
 	}
@@ -2519,12 +2998,23 @@ bool Unsplit(SUnsplitFileNameInfo &info, SUnsplitOptions &options, SUFileData &d
 	{
 	case UNSPLIT_MODE_FIRST:
 	case UNSPLIT_MODE_SECOND:
-		if (!ReassembleDDS(info, data, options, logfile))
-			return false;
-		
-		if (options.bClean)
+		// The converter can read the parts directly, so only write a reassembled .dds when
+		// the part files are about to be cleaned up (or the NVidia tool needs one for gloss).
+		if (!options.bClean && !data.bIsGloss)
+		{
+			BuildSplitSource(info, data);
+			info.sExt2 = "";
+			MessageOut(logfile, msg + " direct load (" + to_string(data.split.vParts.size()) + " parts)", true, false);
+		}
+		else
 		{
-			Cleanup(info, data);
+			if (!ReassembleDDS(info, data, options, logfile))
+				return false;
+		
+			if (options.bClean)
+			{
+				Cleanup(info, data);
+			}
 		}
 
 		// If 'a' files exist - create new NameInfo struct and repeat unsplit
@@ -2551,7 +3041,8 @@ bool Unsplit(SUnsplitFileNameInfo &info, SUnsplitOptions &options, SUFileData &d
 	//	break;
 
 	case UNSPLIT_MODE_STRIP:
-		RenameFile(info.sNameAllExt, info.sBaseName, true);
+		RenameFile(info.sDirectory + info.sNameAllExt, info.sDirectory + info.sBaseName, true);
+		if (info.pFragments) { info.pFragments->Rename(".0", ""); }
 		info.sExt2 = "";
 		break;
 
@@ -2566,8 +3057,9 @@ bool Unsplit(SUnsplitFileNameInfo &info, SUnsplitOptions &options, SUFileData &d
 	return true;
 }
 
-// Copy the gloss image data (RED channel) onto the alpha channel of the normal image
-bool MergeGlossWithNormal(string norm, string gloss, string logfile)
+// Copy the gloss image data (RED channel) onto the alpha channel of the normal image.
+// The merged image replaces the normal file, or is queued in 'outputs' for the writer stage.
+bool MergeGlossWithNormal(string norm, string gloss, string logfile, vector<SEncodedFile> *outputs)
 {
 	string err = "ERROR: converted gloss map not found!";
 	if (!(FileExists(gloss)))
@@ -2613,11 +3105,191 @@ bool MergeGlossWithNormal(string norm, string gloss, string logfile)
 	
 	cv::merge(channels, 4, imgOut);
 
-	cv::imwrite(norm, imgOut);
+	if (outputs)
+	{
+		// Encoded for the writer stage; imencode also picks the encoder from the extension.
+		vector<uchar> buffer;
+		SEncodedFile encoded;
+		if (!cv::imencode(norm.substr(norm.rfind('.')), imgOut, buffer) || FAILED(CopyToBlob(buffer.data(), buffer.size(), encoded.blob)))
+		{
+			err = "ERROR: could not encode merged image!";
+			MessageOut(logfile, err, true, false);
+			return false;
+		}
+		encoded.sPath = norm;
+		outputs->push_back(std::move(encoded));
+		return true;
+	}
+
+	// The temp name keeps the extension - imwrite picks the encoder from it.
+	string tempNorm = TempPathFor(norm);
+	if (!cv::imwrite(tempNorm, imgOut) || !PublishFile(tempNorm, norm))
+	{
+		DiscardFile(tempNorm);
+		err = "ERROR: could not write merged image!";
+		MessageOut(logfile, err, true, false);
+		return false;
+	}
+
+	return true;
+}
+
+// Copy the gloss image data (RED channel) onto the alpha channel of the normal image, in memory.
+// Both come straight from the converter, so nothing is written or read back in between.
+HRESULT InsertGlossAlpha(const ScratchImage &normal, const ScratchImage &gloss, ScratchImage &merged)
+{
+	const Image* imgNorm = normal.GetImage(0, 0, 0);
+	const Image* imgGloss = gloss.GetImage(0, 0, 0);
+	if (!imgNorm || !imgGloss)
+		return E_POINTER;
+
+	if (imgNorm->width != imgGloss->width || imgNorm->height != imgGloss->height)
+		return E_INVALIDARG;
+
+	HRESULT hr = (imgNorm->format == DXGI_FORMAT_R8G8B8A8_UNORM)
+				? merged.InitializeFromImage(*imgNorm)
+				: Convert(*imgNorm, DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT, 0.5f, merged);
+	if (FAILED(hr))
+		return hr;
+
+	ScratchImage glossRGBA;
+	if (imgGloss->format != DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		hr = Convert(*imgGloss, DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT, 0.5f, glossRGBA);
+		if (FAILED(hr))
+			return hr;
+		imgGloss = glossRGBA.GetImage(0, 0, 0);
+	}
+
+	const Image* imgOut = merged.GetImage(0, 0, 0);
+	for (size_t y = 0; y < imgOut->height; y++)
+	{
+		const uint8_t* src = imgGloss->pixels + y * imgGloss->rowPitch;
+		uint8_t* dst = imgOut->pixels + y * imgOut->rowPitch;
+		for (size_t x = 0; x < imgOut->width; x++)
+		{
+			dst[x * 4 + 3] = src[x * 4];
+		}
+	}
+	return S_OK;
+}
+
+// Writes the first image of 'image' as 'fileType' (tif, png, dds ...) via a temp file,
+// or only encodes it and adds it to 'outputs' for the writer stage.
+HRESULT SaveImageFile(const ScratchImage &image, const string &path, const string &fileType, vector<SEncodedFile> *outputs = nullptr)
+{
+	const Image* img = image.GetImage(0, 0, 0);
+	if (!img)
+		return E_POINTER;
+
+	ATL::CA2W lpType(fileType.c_str());
+	DWORD codec = LookupByName(lpType, g_pSaveFileTypes);
+	if (!codec)
+		return E_INVALIDARG;
+
+	CStageClock stageClock(STAGE_SAVE, path, &image);
+	HRESULT hr;
+	if (outputs)
+	{
+		SEncodedFile encoded;
+		switch (codec)
+		{
+		case CODEC_DDS:
+			hr = SaveToDDSMemory(*img, DDS_FLAGS_NONE, encoded.blob);
+			break;
+
+		case CODEC_TGA:
+			hr = SaveToTGAMemory(*img, encoded.blob);
+			break;
+
+		default:
+			hr = SaveToWICMemory(*img, WIC_FLAGS_NONE, GetWICCodec(static_cast<WICCodecs>(codec)), encoded.blob);
+			break;
+		}
+		if (FAILED(hr))
+			return hr;
+
+		stageClock.Done(encoded.blob.GetBufferSize(), 0);
+		encoded.sPath = path;
+		outputs->push_back(std::move(encoded));
+		return hr;
+	}
+
+	string temp = TempPathFor(path);
+	ATL::CA2W lpTemp(temp.c_str());
+	switch (codec)
+	{
+	case CODEC_DDS:
+		hr = SaveToDDSFile(*img, DDS_FLAGS_NONE, lpTemp);
+		break;
+
+	case CODEC_TGA:
+		hr = SaveToTGAFile(*img, lpTemp);
+		break;
+
+	default:
+		hr = SaveToWICFile(*img, WIC_FLAGS_NONE, GetWICCodec(static_cast<WICCodecs>(codec)), lpTemp);
+		break;
+	}
+
+	if (SUCCEEDED(hr) && !PublishFile(temp, path))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+	}
+	if (FAILED(hr))
+	{
+		DiscardFile(temp);
+		return hr;
+	}
+	stageClock.Done((stageClock.IsActive() ? FileBytes(path) : 0), 0);
+	return hr;
+}
+
+// Decodes a BC4 / ATI1 gloss or mask map in process and writes it as 'fileType' (or queues
+// it in 'outputs'). Returns false (nothing written, no error counted) so the caller can try the converter.
+bool ConvertGlossMap(const string &src, const string &dst, const string &fileType, string &logfile, vector<SEncodedFile> *outputs)
+{
+	string msg = "";
+	ScratchImage image;
+	HRESULT hr = DecodeGlossMap(src, image);
+	if (FAILED(hr))
+	{
+		if (hr != HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED))
+		{
+			CLogSink::Instance().Write(LOG_WARNING, "gloss decode", src, hr, 0.0, "");
+			MessageOut(logfile, (msg + "\n\t\tgloss decode FAILED " + to_string(hr) + ", trying converter"), false, false);
+		}
+		return false;
+	}
+
+	MessageOut(logfile, ("\n\t\tdecoded gloss " + src + (outputs ? "\n\t\tencoding " : "\n\t\twriting ") + dst + "..."), false, false);
+	hr = SaveImageFile(image, dst, fileType, outputs);
+	if (FAILED(hr))
+	{
+		MessageOut(logfile, (msg + " FAILED image save " + to_string(hr) + ", trying converter"), true, false);
+		return false;
+	}
 
+	MessageOut(logfile, (msg + "OK."), true, false);
 	return true;
 }
 
+static string ThreadSetting(int threads)
+{
+	return (threads > 0 ? to_string(threads) : string("auto"));
+}
+
+static const char* BCQualityName(int quality)
+{
+	switch (quality)
+	{
+	case TEX_COMPRESS_BC_FAST:		return "fast";
+	case TEX_COMPRESS_BC_NORMAL:	return "normal";
+	case TEX_COMPRESS_BC_HIGH:		return "high";
+	default:						return "reference";
+	}
+}
+
 void PrintOptions(SUnsplitOptions &options)
 {
 	string value = "";
@@ -2631,6 +3303,16 @@ void PrintOptions(SUnsplitOptions &options)
 	value = (options.bMergeGloss ? "true" : "false");
 	std::cout << "\tMerge gloss : " << value << std::endl;
 	std::cout << "\tSave format : " << options.sFileType << std::endl;
+	value = (options.bUseNVDecompress ? "true" : "false");
+	std::cout << "\tNVDecompress: " << value << std::endl;
+	std::cout << "\tLog level   : " << LogLevelName((LOG_LEVEL)options.nLogLevel) << std::endl;
+	std::cout << "\tTiming      : " << TimingModeName((TIMING_MODE)options.nTiming) << std::endl;
+	value = (options.bTiled ? "true" : "false");
+	std::cout << "\tTiled       : " << value << std::endl;
+	std::cout << "\tMemory      : " << (options.nMemoryBudgetMB > 0 ? to_string(options.nMemoryBudgetMB) + " MB" : string("auto")) << std::endl;
+	std::cout << "\tBC quality  : " << BCQualityName(options.nBCQuality) << std::endl;
+	std::cout << "\tThreads     : " << ThreadSetting(options.nUnsplitThreads) << " unsplit, " << ThreadSetting(options.nConvertThreads) << " convert, "
+			  << ThreadSetting(options.nWriteThreads) << " write" << std::endl;
 }
 
 bool LoadConfigFile(string filepath, SUnsplitOptions &options)
@@ -2769,30 +3451,199 @@ bool LoadConfigFile(string filepath, SUnsplitOptions &options)
 					return false;
 				}
 			}
-			else
+			else if (line.find("log_level") != string::npos)
 			{
-				std::cout << " ERROR: '" << line << "' not recognized as a valid config field!" << std::endl;
-				std::cout << " - HINT - don't use UPPERCASE characters or extra spaces." << std::endl;
-				return false;
+				bool ok = false;
+				size_t pos = line.find('=');
+				LOG_LEVEL level = ParseLogLevel((pos == string::npos ? "" : line.substr(pos + 1)), ok);
+				if (!ok)
+				{
+					std::cout << " ERROR: log_level value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use one of 'debug' 'info' 'warning' or 'error' only. Don't use UPPERCASE characters or extra spaces." << std::endl;
+					return false;
+				}
+				options.nLogLevel = level;
+				std::cout << " log_level = " << LogLevelName(level) << std::endl;
 			}
-		}
-	}
-
-	ifs.close();
-	
-	return true;
-}
-
-void LogMessage(string &logfile, string &message, bool bkspace)
-{
-	std::ofstream log(logfile, std::ofstream::out | std::ofstream::app);
-
-	if (!log)
-	{
-		std::cerr << "Cannot open the output file." << std::endl;
-		return;
-	}
-	// 'bkspace' overwrites the 'new line' char at end of log file so that 
+			else if (line.find("timing") != string::npos)
+			{
+				TIMING_MODE mode = TIMING_OFF;
+				size_t pos = line.find('=');
+				if (pos == string::npos || !ParseTimingMode(line.substr(pos + 1), mode))
+				{
+					std::cout << " ERROR: timing value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use one of 'off' 'summary' or 'trace' only. Don't use UPPERCASE characters or extra spaces." << std::endl;
+					return false;
+				}
+				options.nTiming = mode;
+				std::cout << " timing = " << TimingModeName(mode) << std::endl;
+			}
+			else if (line.find("tiled") != string::npos)
+			{
+				if (line.find("true") != string::npos)
+				{
+					options.bTiled = true;
+					std::cout << " tiled = true" << std::endl;
+				}
+				else if (line.find("false") != string::npos)
+				{
+					options.bTiled = false;
+					std::cout << " tiled = false" << std::endl;
+				}
+				else {
+					std::cout << " ERROR: tiled value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use 'true' or 'false' only. Don't use UPPERCASE characters or extra spaces." << std::endl;
+					return false;
+				}
+			}
+			else if (line.find("nvdecompress") != string::npos)
+			{
+				if (line.find("true") != string::npos)
+				{
+					options.bUseNVDecompress = true;
+					std::cout << " nvdecompress = true" << std::endl;
+				}
+				else if (line.find("false") != string::npos)
+				{
+					options.bUseNVDecompress = false;
+					std::cout << " nvdecompress = false" << std::endl;
+				}
+				else {
+					std::cout << " ERROR: nvdecompress value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use 'true' or 'false' only. Don't use UPPERCASE characters or extra spaces." << std::endl;
+					return false;
+				}
+			}
+			else if (line.find("unsplit_threads") != string::npos || line.find("convert_threads") != string::npos
+					 || line.find("write_threads") != string::npos)
+			{
+				bool isUnsplit = (line.find("unsplit_threads") != string::npos);
+				bool isWrite = (line.find("write_threads") != string::npos);
+				string key = (isUnsplit ? "unsplit_threads" : (isWrite ? "write_threads" : "convert_threads"));
+				size_t pos = line.find_first_of("0123456789", line.find('='));
+				if (line.find('=') == string::npos || pos == string::npos)
+				{
+					std::cout << " ERROR: " << key << " value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use a whole number, or 0 to let the converter decide." << std::endl;
+					return false;
+				}
+
+				int threads = atoi(line.c_str() + pos);
+				if (isUnsplit)
+				{
+					options.nUnsplitThreads = threads;
+					std::cout << " unsplit_threads = " << threads << std::endl;
+				}
+				else if (isWrite)
+				{
+					options.nWriteThreads = threads;
+					std::cout << " write_threads = " << threads << std::endl;
+				}
+				else
+				{
+					options.nConvertThreads = threads;
+					std::cout << " convert_threads = " << threads << std::endl;
+				}
+			}
+			else if (line.find("memory_budget") != string::npos)
+			{
+				size_t pos = line.find_first_of("0123456789", line.find('='));
+				if (line.find('=') == string::npos || pos == string::npos)
+				{
+					std::cout << " ERROR: memory_budget value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use a whole number of megabytes, or 0 to use half of the computer's memory." << std::endl;
+					return false;
+				}
+
+				options.nMemoryBudgetMB = atoi(line.c_str() + pos);
+				std::cout << " memory_budget = " << options.nMemoryBudgetMB << std::endl;
+			}
+			else if (line.find("bc_quality") != string::npos)
+			{
+				if (line.find("reference") != string::npos)
+					options.nBCQuality = TEX_COMPRESS_DEFAULT;
+				else if (line.find("fast") != string::npos)
+					options.nBCQuality = TEX_COMPRESS_BC_FAST;
+				else if (line.find("normal") != string::npos)
+					options.nBCQuality = TEX_COMPRESS_BC_NORMAL;
+				else if (line.find("high") != string::npos)
+					options.nBCQuality = TEX_COMPRESS_BC_HIGH;
+				else {
+					std::cout << " ERROR: bc_quality value not recognized as valid!" << std::endl;
+					std::cout << " - HINT - Use one of 'fast' 'normal' 'high' or 'reference' only. Don't use UPPERCASE characters or extra spaces." << std::endl;
+					return false;
+				}
+				std::cout << " bc_quality = " << BCQualityName(options.nBCQuality) << std::endl;
+			}
+			else
+			{
+				std::cout << " ERROR: '" << line << "' not recognized as a valid config field!" << std::endl;
+				std::cout << " - HINT - don't use UPPERCASE characters or extra spaces." << std::endl;
+				return false;
+			}
+		}
+	}
+
+	ifs.close();
+	
+	return true;
+}
+
+// Pipeline workers log concurrently; one lock keeps each message (and its console echo) whole.
+static std::recursive_mutex s_logMutex;
+
+// Set by CMessageCapture: MessageOut on this thread goes to a texture's buffer.
+static thread_local SMessageBuffer *t_pMessages = nullptr;
+
+CMessageCapture::CMessageCapture(SMessageBuffer &messages) : m_pPrevious(t_pMessages)
+{
+	t_pMessages = &messages;
+}
+
+CMessageCapture::~CMessageCapture()
+{
+	t_pMessages = m_pPrevious;
+}
+
+void WriteMessages(string &logfile, SMessageBuffer &messages)
+{
+	if (messages.log.empty() && messages.console.empty())
+		return;
+
+	CProgressDisplay &progress = CProgressDisplay::Instance();
+	std::lock_guard<std::recursive_mutex> lock(progress.ConsoleMutex());
+	if (!messages.log.empty())
+	{
+		LogMessage(logfile, messages.log, true);
+	}
+	if (!messages.console.empty())
+	{
+		progress.ClearLine();
+		std::cout << messages.console << std::flush;
+	}
+	messages.log.clear();
+	messages.console.clear();
+}
+
+void LogMessage(string &logfile, string &message, bool bkspace)
+{
+	// Once wmain has opened the sink, messages are only buffered here and written in the background.
+	CLogSink &sink = CLogSink::Instance();
+	if (sink.IsOpenFor(logfile))
+	{
+		sink.Write(LevelOfMessage(message), message);
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(s_logMutex);
+	std::ofstream log(logfile, std::ofstream::out | std::ofstream::app);
+
+	if (!log)
+	{
+		std::cerr << "Cannot open the output file." << std::endl;
+		return;
+	}
+	// 'bkspace' overwrites the 'new line' char at end of log file so that 
 	//  this message appears on the same line as the last one.
 	if (bkspace)
 	{
@@ -2824,14 +3675,44 @@ void LogOptions(string &logfile, SUnsplitOptions &options)
 	log << "\tClean-up    : " << value << std::endl;
 	value = (options.bMergeGloss ? "true" : "false");
 	log << "\tMerge gloss : " << value << std::endl;
-	log << "\tSave format : " << options.sFileType << "\n" << std::endl;
+	log << "\tSave format : " << options.sFileType << std::endl;
+	value = (options.bUseNVDecompress ? "true" : "false");
+	log << "\tNVDecompress: " << value << std::endl;
+	log << "\tLog level   : " << LogLevelName((LOG_LEVEL)options.nLogLevel) << std::endl;
+	log << "\tTiming      : " << TimingModeName((TIMING_MODE)options.nTiming) << std::endl;
+	value = (options.bTiled ? "true" : "false");
+	log << "\tTiled       : " << value << std::endl;
+	log << "\tMemory      : " << (options.nMemoryBudgetMB > 0 ? to_string(options.nMemoryBudgetMB) + " MB" : string("auto")) << std::endl;
+	log << "\tBC quality  : " << BCQualityName(options.nBCQuality) << std::endl;
+	log << "\tThreads     : " << ThreadSetting(options.nUnsplitThreads) << " unsplit, " << ThreadSetting(options.nConvertThreads) << " convert, "
+		<< ThreadSetting(options.nWriteThreads) << " write\n" << std::endl;
 
 	log.close();
 }
 
 void MessageOut(std::string &logfile, std::string &message, bool bkspace, bool newline)
 {
+	// While the progress line is up only problems are echoed, printed above it.
+	CProgressDisplay &progress = CProgressDisplay::Instance();
+	if (t_pMessages)
+	{
+		t_pMessages->log += message;
+		if (progress.ShowMessage(LevelOfMessage(message) >= LOG_WARNING))
+		{
+			t_pMessages->console += message;
+			if (newline) { t_pMessages->console += "\n"; }
+		}
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(progress.ConsoleMutex());
 	LogMessage(logfile, message, bkspace);
+	if (!progress.ShowMessage(LevelOfMessage(message) >= LOG_WARNING))
+	{
+		return;
+	}
+	progress.ClearLine();
+
 	if (newline)
 	{
 		std::cout << message << std::endl;
@@ -2842,24 +3723,8 @@ void MessageOut(std::string &logfile, std::string &message, bool bkspace, bool n
 	}
 }
 
-int SizeOfFile(string file)
-{
-	int size = 0;
-
-	streampos begin, end;
-	ifstream infile(file, ios::binary);
-	begin = infile.tellg();
-	infile.seekg(0, ios::end);
-	end = infile.tellg();
-	infile.close();
-
-	size = (int)(end - begin);
-
-	return size;
-}
-
-// fname must be filename with no extension
-bool FIconvert(string fname, string ftype)
+// fname must be filename with no extension. With 'outputs' the file is only encoded, for the writer stage.
+bool FIconvert(string fname, string ftype, vector<SEncodedFile> *outputs)
 {
 	string infile = fname + ".tga";
 
@@ -2877,11 +3742,33 @@ bool FIconvert(string fname, string ftype)
 		FIfmt = FIF_TIFF;
 
 	string outfile = fname + "." + ftype;
-	if (FreeImage_Save(FIfmt, bitmap, outfile.c_str(), 0)) {
+	if (outputs)
+	{
+		SEncodedFile encoded;
+		BYTE *data = nullptr;
+		DWORD size = 0;
+		FIMEMORY *memory = FreeImage_OpenMemory();
+		bool ok = (memory && FreeImage_SaveToMemory(FIfmt, bitmap, memory, 0) && FreeImage_AcquireMemory(memory, &data, &size)
+				   && SUCCEEDED(CopyToBlob(data, size, encoded.blob)));
+		if (memory)
+			FreeImage_CloseMemory(memory);
+		FreeImage_Unload(bitmap);
+
+		if (ok)
+		{
+			encoded.sPath = outfile;
+			outputs->push_back(std::move(encoded));
+		}
+		return ok;
+	}
+
+	string tempfile = TempPathFor(outfile);
+	if (FreeImage_Save(FIfmt, bitmap, tempfile.c_str(), 0) && PublishFile(tempfile, outfile)) {
 		// bitmap successfully saved!
 		FreeImage_Unload(bitmap);
 		return true;
 	}
+	DiscardFile(tempfile);
 	FreeImage_Unload(bitmap);
 	return false;
 }
@@ -2891,8 +3778,10 @@ bool RunNVDecompress(string nvpath, string file, DWORD &exitCode)
 	// additional information
 	STARTUPINFO si;
 	PROCESS_INFORMATION pi;
+	string directory = file.substr(0, file.find_last_of("\\/") + 1);
 	file = " " + file;
 	ATL::CA2CT lpctApp(nvpath.c_str());
+	ATL::CA2CT lpctDir(directory.c_str());
 	ATL::CA2W lpwFile(file.c_str());
 
 	// set the size of the structures
@@ -2908,7 +3797,7 @@ bool RunNVDecompress(string nvpath, string file, DWORD &exitCode)
 								FALSE,          // Set handle inheritance to FALSE
 								0,              // No creation flags
 								NULL,           // Use parent's environment block
-								NULL,           // Use parent's starting directory 
+								(directory.empty() ? NULL : (LPCTSTR)lpctDir),	// Run in the texture's directory - workers share one process CWD
 								&si,            // Pointer to STARTUPINFO structure
 								&pi             // Pointer to PROCESS_INFORMATION structure (removed extra parentheses)
 	);
@@ -2929,522 +3818,1094 @@ bool RunNVDecompress(string nvpath, string file, DWORD &exitCode)
 	}
 }
 
-//######################################################################################
+#pragma region PIPELINE
+////////////////////////////////////////////////////////////////////////////////////////
+//
+//   CONVERSION PIPELINE
+//
+//   crawler -> [headers] -> prepare workers -> [jobs] -> convert workers -> [writes] -> writers
+//
+//   Prepare: probe the header, decide whether to skip, unsplit (I/O bound).
+//   Convert: load, decode, transform and encode through SCTexConvert, then the
+//            NVidia fallback, the gloss map and the gloss merge (CPU bound).
+//   Write:   put the encoded files on disk and finish the job (I/O bound), while the
+//            convert workers are already on the next textures.
+//
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Shared by every worker for the whole run.
+struct SPipelineContext
+{
+	SUnsplitOptions			options;
+	string					logFile;
+	string					nvDecompressPath;
+	CFileIndex&				index;
+	CFileCrawler&			crawler;
+	CConversionManifest&	manifest;
+	unsigned long long		optionsHash;
+	time_t					start;
+	std::atomic<int>		failCount;
+	std::atomic<int>		started;		//  Headers taken off the crawler queue.
+	std::atomic<int>		manifestSkips;
+	std::atomic<bool>		cancelled;
+	CConverterContext		converter;		//  Shared by every convert worker.
+	CMemoryBudget			memory;			//  Admits textures to the convert workers.
+	std::atomic<int>		lowMemoryJobs;	//  Textures converted in strip mode to fit the budget.
+	bool					bHeadless;		//  -batch: no console prompts, the ESC key is ignored.
+	CBatchResults*			pResults;		//  -batch: every texture is recorded here.
+	size_t					batchEntry;		//  -batch: manifest entry being run.
+
+	SPipelineContext(CFileIndex &idx, CFileCrawler &crawl, CConversionManifest &mf)
+		: index(idx), crawler(crawl), manifest(mf), optionsHash(0), start(0)
+		, failCount(0), started(0), manifestSkips(0), cancelled(false), lowMemoryJobs(0)
+		, bHeadless(false), pResults(nullptr), batchEntry(0) {}
+
+	SPipelineContext(const SPipelineContext&) = delete;
+	SPipelineContext& operator=(const SPipelineContext&) = delete;
+};
+
+// One texture on its way through the pipeline.
+struct STextureJob
+{
+	string					sHeaderPath;
+	SUnsplitOptions			options;		//  Per job copy - Unsplit() stores the detected mode in it.
+	SUnsplitFileNameInfo	info;
+	SUFileData				data;
+	string					converted;		//  Output path of the main texture.
+	string					manifestKey;
+	bool					doConvert;
+	bool					bRecord;		//  Converted this run, so record it in the manifest.
+	int						failCount;		//  Errors raised by this texture.
+	const SFragmentSet*		pClaimed;
+	long long				startTicks;		//  IOTimestamp() when the job was created.
+	unsigned long long		inputBytes;		//  All fragments of the texture, for the progress ETA.
+	unsigned long long		footprint;		//  Predicted peak memory of the convert stage.
+	bool					bLowMemory;		//  Convert strip at a time, the normal footprint is over budget.
+	vector<SEncodedFile>	outputs;		//  Encoded by the convert stage, for the writer stage.
+	SMessageBuffer			messages;		//  Everything the stages print, written in one piece by FinishTexture.
+
+	STextureJob() : info(), data(), doConvert(true), bRecord(false), failCount(0), pClaimed(nullptr), startTicks(0), inputBytes(0),
+					footprint(0), bLowMemory(false) {}
+};
+
 //--------------------------------------------------------------------------------------
-// NEW Entry-point for SCTEXCONV
+// Prepare stage. Returns false when the job has nothing left for the convert stage:
+// skipped, failed to unsplit, or a .dds.0 header that only needed unsplitting.
 //--------------------------------------------------------------------------------------
-//######################################################################################
-#pragma comment(lib, "User32.lib")
-int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+bool PrepareTexture(SPipelineContext &ctx, STextureJob &job)
 {
-#pragma region INITIALIZE
-	// Parameters and defaults
-	int result			= 0;
-	int count			= 0;
-	int failCount		= 0;
-	char tmpbuf[128]	= { 0 };
-	wchar_t* args[128]	= { 0 };
-	PWSTR  pWdir		= 0;
-	string msg			= "";
-	string sError		= "";
-	string installdir	= "";	
-	string targetdir	= "";
-
-	// Get the path of the executable
-	WCHAR path[MAX_PATH] = { 0 };
-	GetModuleFileName(NULL, path, MAX_PATH);
-	PathRemoveFileSpec(path);
-	ATL::CW2A szPath(path);
-	installdir = szPath;
+	CMessageCapture capture(job.messages);
+	// Using regex to split the file path into its components
+	static const regex rgx(R"(^(.*)\\(\w+)(.[dD][dD][sS])([.][0])*$)"); 
+	smatch mch;
+	string msg = "";
+	bool doUnsplit = true;
 
-	// Parse command-line
-	if (argc == 2)
+	int index = ++ctx.started;
+	if (ctx.options.bVerbose)
 	{
-		pWdir = argv[1];
-		ATL::CW2A lpWdir(pWdir);
-		targetdir = lpWdir;
+		MessageOut(ctx.logFile, ("\n File " + to_string(index) + ": " + job.sHeaderPath), false, true);
+	}
+	if (!regex_search(job.sHeaderPath, mch, rgx))
+	{
+		return false;
+	}
 
-		if (DirectoryExists(pWdir))
+	SUnsplitFileNameInfo &info = job.info;
+	info.sFullPath		= mch[0];
+	info.sDirectory		= mch[1];
+	info.sDirectory	   += "\\";
+	info.sName			= mch[2];
+	info.sExt1			= mch[3];
+	info.sExt2			= mch[4];
+	info.sBaseName		= mch[2];
+	info.sBaseName	   += ".dds";
+	info.sNameAllExt	= mch[2];
+	info.sNameAllExt   += ".dds";
+	info.sNameAllExt   += mch[4];
+	info.hasGloss		= false;
+	info.sGlossName		= mch[2];
+	
+	// Provide a matching gloss filename even though we don't know if the gloss file exists yet.
+	info.sGlossName	   += GLOSS_KEY + ".dds";
+	info.pFragments		= ctx.index.FindSet(info.sDirectory, info.sBaseName);
+
+	// A .dds and its .dds.0 share one fragment set - only one job may work on it at a time.
+	job.pClaimed = info.pFragments;
+	ctx.index.Claim(job.pClaimed);
+
+	if (info.pFragments)
+	{
+		for (const auto &f : info.pFragments->files) { job.inputBytes += f.second.size; }
+	}
+	CProgressDisplay &progress = CProgressDisplay::Instance();
+	progress.Queue(job.inputBytes);
+	progress.SetDiscovered(ctx.crawler.Discovered(), ctx.crawler.IsFinished());
+
+	SUFileData &data = job.data;
+	GetFileData(info, data, ctx.logFile);
+
+	string scanning = (ctx.crawler.IsFinished() ? "" : "+ (scanning)");
+	MessageOut(ctx.logFile, ("\n File " + to_string(index) + " of " + to_string(std::max<size_t>(ctx.crawler.Discovered(), index))
+							 + scanning + " : " + info.sNameAllExt + ", "), false, false);
+
+	// Skip if the manifest shows the output is current. Without a manifest entry,
+	// skip if the converted file exists and is > 0 bytes.
+	job.converted = info.sDirectory + info.sName + "." + job.options.sFileType;
+	job.manifestKey = info.sDirectory + info.sBaseName;
+	const SFileStamp* convertedStamp = ctx.index.FindFile(job.converted);
+	MANIFEST_STATE manifestState = (info.pFragments ? ctx.manifest.Check(job.manifestKey, *info.pFragments, ctx.optionsHash, convertedStamp)
+													: MANIFEST_NO_ENTRY);
+	if (manifestState == MANIFEST_CURRENT)
+	{
+		MessageOut(ctx.logFile, msg + "Unchanged since last conversion -> skipping...", true, false);
+		ctx.manifestSkips++;
+		return false;
+	}
+	else if (manifestState == MANIFEST_CHANGED)
+	{
+		MessageOut(ctx.logFile, msg + "Changed since last conversion -> converting...", true, false);
+	}
+	else if (convertedStamp)
+	{
+		unsigned long long fsize = convertedStamp->size;
+		MessageOut(ctx.logFile, msg + "File exists (" + to_string(fsize) + " bytes)", true, false);
+		if (fsize >= 1 && !data.bIsNormal)
 		{
-			std::cout << " Target directory found..." << std::endl;
+			MessageOut(ctx.logFile, msg + "-> skipping...", true, false);
+			doUnsplit = false;
+			job.doConvert = false;
 		}
 		else
 		{
-			std::cout << " Could not access or locate the directory " << targetdir << std::endl;
-			std::cout << " Press ENTER key to close..." << std::ends;
-			std::getchar();
-			return 0;
+			MessageOut(ctx.logFile, msg + "-> overwriting...", true, false);
+			doUnsplit = true;
+			job.doConvert = true;
 		}
 	}
 	else
 	{
-		targetdir = installdir;
+		unsigned long long fsize  = (info.pFragments ? info.pFragments->SizeOf(info.sExt2) : 0);
+		unsigned long long fsize2 = (info.pFragments ? info.pFragments->SizeOf(data.bIsGloss ? ".2a" : ".2") : 0);
+
+		if (fsize > fsize2 && ctx.index.FindFile(info.sDirectory + info.sGlossName))
+		{
+			doUnsplit = false;
+		}
 	}
 
-	// Load and parse config.txt file
-	SUnsplitOptions options;
-	PrintLogo();
-	std::cout << " Loading config..." << std::endl;
-	string config_path = installdir + "\\" + "config.txt";
+	if (doUnsplit)
+	{
+		MessageOut(ctx.logFile, msg + "Unsplit:", true, false);
 
-	if (!LoadConfigFile(config_path, options))
-	{		
-		std::cout << " Press ENTER key to close..." << std::ends;
-		std::getchar();
-		return 0;
+		// Call Unsplit -------------------------------------------------
+		if (Unsplit(info, job.options, data, ctx.logFile))
+		{
+			MessageOut(ctx.logFile, msg + "...OK.", true, false);
+		}
+		else
+		{
+			job.failCount++;
+			MessageOut(ctx.logFile, msg + " FAILED <<<<<<<<<<<<<<<<<<<<<", true, true);
+			return false;
+		}
 	}
 
-	// Display O/S date and time.   
-	_tzset();
-	_strdate_s(tmpbuf, 128);
-	string startDate(tmpbuf);
-	printf(" Conversion started:  %s, ", tmpbuf);
-	_strtime_s(tmpbuf, 128);
-	string startTime(tmpbuf);
-	printf("%s\n", tmpbuf);
-	time_t start;
-	time(&start);
 
-	time_t now;
-	time_t elapsed;
-	uint hrs, min, sec, remain; 
-	string fmtHour, fmtMin, fmtSec;
+	return (info.sExt2 != ".0");
+}
 
-	// Log file filename time-stamp is UNIX-style (i.e. number of seconds since 1st Jan 1970)	
-	long long llstart(start);
-	string log_file = "sctextureconverter_log_" + to_string(llstart) + ".txt";
-	string log_file_path = installdir + "\\" + log_file;
-	string nvDecompress_path = installdir + "\\nvdecompress.exe";
-	
-	PrintLogo(log_file_path);
-	LogOptions(log_file_path, options);
-	LogMessage(log_file_path, (" Conversion started: " + startDate + ", " + startTime), false);
-	LogMessage(log_file_path, msg + "\n Directory: " + targetdir, false);
+// A normal map whose gloss map is merged into it: both are decoded together and only
+// the merged image is written (no separate gloss file, no re-read of either output).
+bool IsPairedTexture(const STextureJob &job)
+{
+	return (job.data.bIsNormal && !job.data.bIsGloss && job.info.hasGloss && job.options.bMergeGloss
+			&& job.options.sFileType != "dds" && FileExists(job.info.sDirectory + job.info.sGlossName));
+}
 
-	//
-	// -- Build a list of available DDS header files -----------------------------------
-	std::cout << "\n Searching for DDS header files in " << targetdir << std::endl;
-	
-	std::cout << "\n\n Searching... " << std::ends;
-	list<string> fileList;
-	BuildFileList(targetdir, fileList, log_file_path, options.bRecursive, count);
-	
-	if (fileList.empty())
+// Returns false, with no errors counted, when the pair has to be converted the old way
+// (separate files, then MergeGlossWithNormal). bNormalSaved is set when the normal map was
+// converted before that became clear and has been saved as the separate file already.
+bool ConvertPairedTexture(SPipelineContext &ctx, STextureJob &job, const SConvertJob &normalJob, bool &bNormalSaved)
+{
+	SUnsplitFileNameInfo &info = job.info;
+	string msg = "";
+	bNormalSaved = false;
+
+	// Normal map: the same job as an unpaired conversion, handed back instead of saved.
+	ScratchImage normal;
+	int failCount = 0;
+	SConvertJob pairedJob = normalJob;
+	pairedJob.result = &normal;
+	ctx.converter.Convert(pairedJob, ctx.logFile, failCount);
+	if (failCount > 0 || normal.GetImageCount() == 0)
 	{
-		MessageOut(log_file_path, (msg + "\n FILE SEARCH ERROR: No valid files found. EXITING..."), false, true);
-		std::cout << "\n Press ENTER key to close..." << std::ends;
-		std::getchar();
-		return 1;
+		MessageOut(ctx.logFile, msg + "\n\t\tpaired convert unavailable, converting normal and gloss separately", false, false);
+		return false;
 	}
 
-	LogMessage(log_file_path, msg + "\n Find errors in this log quickly by searching for 'FAILED' and 'ERROR'.", false);
+	// Gloss map: decoded in process when it is BC4 / ATI1, else read as 4 channel like every
+	// gloss map (bIsMaskAlpha). The gloss value is its red channel.
+	string glossPath = info.sDirectory + info.sGlossName;
+	ScratchImage gloss;
+	if (FAILED(DecodeGlossMap(glossPath, gloss)))
+	{
+		SConvertJob glossJob;
+		glossJob.sSource = glossPath;
+		glossJob.format	 = DXGI_FORMAT_R8G8B8A8_UNORM;
+		glossJob.result	 = &gloss;
+		ctx.converter.Convert(glossJob, ctx.logFile, failCount);
+	}
+	if (failCount > 0 || gloss.GetImageCount() == 0)
+	{
+		MessageOut(ctx.logFile, msg + "\n\t\tgloss map not decoded in memory, converting gloss separately", false, false);
+		bNormalSaved = SUCCEEDED(SaveImageFile(normal, job.converted, job.options.sFileType));
+		return false;
+	}
 
-	if (options.bVerbose)
+	MessageOut(ctx.logFile, (msg + "\n\t\tMerging gloss data into normal map:"), false, false);
+	ScratchImage merged;
+	HRESULT hr = InsertGlossAlpha(normal, gloss, merged);
+	if (FAILED(hr))
 	{
-		int cnt = 0;
-		for each (string i in fileList)
-		{
-			cnt++;
-			MessageOut(log_file_path, ("\n File " + to_string(cnt) + ": " + i), false, true);
-			if (UserWantsToExit()) { return 0; }
+		MessageOut(ctx.logFile, (msg + (hr == E_INVALIDARG ? " ERROR: image size mismatch!" : " ERROR: merge failed " + to_string(hr))), true, false);
+		bNormalSaved = SUCCEEDED(SaveImageFile(normal, job.converted, job.options.sFileType));
+		return false;
+	}
 
-		}
+	MessageOut(ctx.logFile, ("\n\t\tencoding " + job.converted + "..."), false, false);
+	hr = SaveImageFile(merged, job.converted, job.options.sFileType, &job.outputs);
+	if (FAILED(hr))
+	{
+		MessageOut(ctx.logFile, (msg + " FAILED image save " + to_string(hr) + " <<<<<<<<<<<<<<<< "), true, true);
+		job.failCount++;
+		return true;
 	}
 
-	MessageOut(log_file_path, ("\n " + to_string(count) + " valid file headers found.\n"), false, true);
-#pragma endregion	
+	MessageOut(ctx.logFile, (msg + "OK."), true, false);
+	return true;
+}
 
-	// Using regex to split the file path into its components
-	regex rgx(R"(^(.*)\\(\w+)(.[dD][dD][sS])([.][0])*$)"); 
-	
-	smatch mch;
-	int index = 0;
-		
-	for each(string i in fileList)
+// Pixel format of the main texture: normal maps and anything with a mask are forced, a batch
+// entry's pixel_format applies to the rest, otherwise the converter chooses the best one
+// (DXGI_FORMAT_UNKNOWN).
+DXGI_FORMAT MainTextureFormat(const STextureJob &job)
+{
+	if (job.data.bIsNormal)
+		return DXGI_FORMAT_B8G8R8A8_UNORM;  // B5G5R5A1_UNORM also works but will reduce quality
+	if (job.info.hasGloss)  // This should cover all img types that are not normals but have a mask e.g. _opa, _mask, _trans.
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	return job.options.pixelFormat;
+}
+
+//--------------------------------------------------------------------------------------
+// Predicts the convert stage's peak memory from the texture header. Textures that would
+// not fit the budget are converted strip at a time when nothing needs the whole image.
+//--------------------------------------------------------------------------------------
+void PlanTextureMemory(SPipelineContext &ctx, STextureJob &job)
+{
+	CMessageCapture capture(job.messages);
+	TexMetadata info;
+	const vector<unsigned char> &probe = job.data.finData;
+	if (probe.empty() || FAILED(GetMetadataFromDDSMemory(probe.data(), probe.size(), DDS_FLAGS_NONE, info)))
 	{
-		bool doUnsplit = true;
-		bool doConvert = true;
+		// Header not readable on its own (gloss parts): assume 8 bytes decoded per byte read.
+		job.footprint = job.inputBytes * 8;
+		return;
+	}
+
+	// Strip mode only pays off when the converter really tiles this texture; otherwise the
+	// whole-image footprint is reserved even over the budget.
+	SConvertJob tiledJob;
+	tiledJob.format		 = MainTextureFormat(job);
+	tiledJob.dwNormalMap = (job.data.bIsNormal ? CNMAP_CHANNEL_RED : 0);
+	tiledJob.bTiled		 = true;
+	bool bCanTile = ctx.converter.WouldTile(tiledJob, info);
+
+	size_t outMips = (job.options.sFileType == "dds" ? 0 : 1);
+	SFootprint footprint = EstimateFootprint(info, tiledJob.format, outMips, job.data.bIsNormal, IsPairedTexture(job), bCanTile);
+	job.footprint = footprint.bytes;
+
+	unsigned long long limit = ctx.memory.Limit();
+	if (limit && footprint.bytes > limit && footprint.bCanTile)
+	{
+		job.bLowMemory = true;
+		job.footprint = footprint.tiledBytes;
+		ctx.lowMemoryJobs++;
+		MessageOut(ctx.logFile, ("\n\t\t" + to_string(footprint.bytes >> 20) + " MB needed, over the memory budget -> strip mode"), false, false);
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Convert stage: the main texture, then its gloss map, then the optional merge.
+//--------------------------------------------------------------------------------------
+void ConvertTexture(SPipelineContext &ctx, STextureJob &job)
+{
+	CMessageCapture capture(job.messages);
+	SUnsplitFileNameInfo &info = job.info;
+	SUFileData &data = job.data;
+	const string &converted = job.converted;
+	bool &doConvert = job.doConvert;
+	string msg = "";
+
+	SConvertJob convertJob;
+	convertJob.sSource	  = info.sDirectory + info.sBaseName;
+	convertJob.sOutputDir = info.sDirectory;
+	convertJob.split	  = (data.bDirectLoad ? &data.split : nullptr);
+	convertJob.bTiled	  = job.bLowMemory;
+
+	// Files are encoded here and written by the writer stage, except the two that the
+	// separate-file gloss merge reads back (main texture and gloss map).
+	bool bMergeFiles = (info.hasGloss && job.options.bMergeGloss);
+	vector<SEncodedFile> *outputs = (bMergeFiles ? nullptr : &job.outputs);
+	convertJob.outputs	  = outputs;
+
+	// Pixel format: normal maps and anything with a mask are forced, otherwise the
+	// converter chooses the best one.
+	if (data.bIsNormal)
+		MessageOut(ctx.logFile, msg + "(forced normal)", true, false);
+	else if (info.hasGloss)
+		MessageOut(ctx.logFile, msg + "(forced 4 channel)", true, false);
+	convertJob.format = MainTextureFormat(job);
+
+	// Normal maps are rebuilt from the red channel, amplitude 10 (was "-nmap rgb -nmapamp 10.0").
+	//TODO: Test normal reconstruction via OpenCV functions or nvtt
+	if (data.bIsNormal)
+	{
+		convertJob.dwNormalMap	 = CNMAP_CHANNEL_RED;
+		convertJob.nmapAmplitude = 10.0f;
+	}
+	string strFname = convertJob.sSource;
 
-		index++;
-		if (regex_search(i, mch, rgx))
+	// Call Texture converter--------------------------------------------------
+	if (doConvert)
+	{
+		job.bRecord = true;
+
+		// A pair that falls back after its normal map was converted keeps that normal map.
+		bool bNormalSaved = false;
+		if (IsPairedTexture(job) && ConvertPairedTexture(ctx, job, convertJob, bNormalSaved))
+		{
+			return;
+		}
+
+		int failCount_prev = job.failCount;
+		bool done = bNormalSaved;
+		if (!done && data.bIsGloss)
+		{
+			// Gloss and mask maps are BC4 / ATI1 and are decoded right here.
+			done = ConvertGlossMap(strFname, converted, job.options.sFileType, ctx.logFile, outputs);
+		}
+		if (!done)
 		{
-			string matchDir = mch[1].str();
+			ctx.converter.Convert(convertJob, ctx.logFile, job.failCount);
+		}
+
+		if (job.failCount > failCount_prev && job.options.bUseNVDecompress)
+		{				
+		// Last resort, only when enabled in config.txt: the NVidia Texture Tool
+			MessageOut(ctx.logFile, (msg + "\n\t\t "), true, false);
 
-			if (strcmp(matchDir.c_str(), targetdir.c_str()) != 0)
+			// nvdecompress only reads whole files, so reassemble a directly loaded texture first.
+			if (data.bDirectLoad)
 			{
-				CA2T newdir(matchDir.c_str());
-				if (SetCurrentDirectory(newdir))
+				data.bDirectLoad = false;
+				if (!ReassembleDDS(info, data, job.options, ctx.logFile))
 				{
-					//std::cout << "Opening directory " << matchDir << std::endl;
+					MessageOut(ctx.logFile, msg + " Unsplit for NVidia convert...FAILED", true, false);
 				}
-				else
+			}
+			DWORD exitcode;
+			if (RunNVDecompress(ctx.nvDecompressPath, strFname, exitcode))
+			{
+				MessageOut(ctx.logFile, (msg + "NV exit code (" + to_string(exitcode) + ")"), true, false);
+				if (job.options.sFileType != "tga")
 				{
-					MessageOut(log_file_path, (" ERROR: Cannot open directory " + matchDir), false, true);
+					if (FIconvert(info.sDirectory + info.sName, job.options.sFileType, outputs))
+					{
+						MessageOut(ctx.logFile, (msg + " FreeImage convert...OK. "), true, false);
+						job.failCount = failCount_prev;
+					}
+					else
+					{
+						MessageOut(ctx.logFile, (msg + " FreeImage convert...FAILED. "), true, false);
+						job.failCount = (job.failCount == failCount_prev ? job.failCount + 1 : job.failCount + 0);
+					}
 				}
 			}
+			else
+			{
+				MessageOut(ctx.logFile, (msg + " NVidia convert...FAILED (" + to_string(exitcode) + ")"), true, false);
+				job.failCount++;
+			}
+		}
+	}
 
-			SUnsplitFileNameInfo  info;
-			info.sFullPath		= mch[0];
-			info.sDirectory		= mch[1];
-			info.sDirectory	   += "\\";
-			info.sName			= mch[2];
-			info.sExt1			= mch[3];
-			info.sExt2			= mch[4];
-			info.sBaseName		= mch[2];
-			info.sBaseName	   += ".dds";
-			info.sNameAllExt	= mch[2];
-			info.sNameAllExt   += ".dds";
-			info.sNameAllExt   += mch[4];
-			info.hasGloss		= false;
-			info.sGlossName		= mch[2];
-			
-			// Provide a matching gloss filename even though we don't know if the gloss file exists yet.
-			info.sGlossName	   += GLOSS_KEY + ".dds";
+	// Process gloss map if required-------------------------------------------
+	if (!info.hasGloss)
+		return;
+	
+	if (FileExists(info.sDirectory + info.sName + GLOSS_KEY + "." + job.options.sFileType))
+	{
+		doConvert = false;
+		if (!job.options.bMergeGloss)
+		{
+			return;
+		}
+	}
 
-			SUFileData data = SUFileData();
-			GetFileData(info, data, log_file_path);		
+	strFname = info.sDirectory + info.sGlossName;
 
-#pragma region PROGRESS_OUTPUT
-			// Output job progress to console and log ------------------------------------------
-			if (!options.bVerbose)
-			{
-				system("cls");
-				PrintLogo();
-				PrintOptions(options);
-			}
-			
-			time(&now);
-			elapsed = now - start;
-			hrs = elapsed / 3600;
-			min = (elapsed /60) % 60;
-			sec = elapsed % 60;
-			fmtHour = (hrs < 10 ? "0" : "");
-			fmtMin  = (min < 10 ? "0" : "");
-			fmtSec  = (sec < 10 ? "0" : "");
-			std::cout << "\n " << "Time elapsed: " << fmtHour << hrs << ":" << fmtMin << min << ":" << fmtSec << sec << std::ends;
-
-			remain = ((elapsed / index > 0) ? ((count - index) * (elapsed / index)) : ((count - index) / 2));
-			hrs = remain / 3600;
-			min = (remain / 60) % 60;
-			sec = remain % 60;
-			fmtHour = (hrs < 10 ? "0" : "");
-			fmtMin  = (min < 10 ? "0" : "");
-			fmtSec  = (sec < 10 ? "0" : "");
-			string errGrmr = (failCount == 1 ? " error." : " errors.");
-			std::cout << ",  Est. time remaining: " << fmtHour << hrs << ":" << fmtMin << min << ":" << fmtSec << sec << std::ends;
-			std::cout << ",  " << to_string(failCount) << errGrmr << std::ends;
-			MessageOut(log_file_path, ("\n File " + to_string(index) + " of " + to_string(count) + " : " + info.sNameAllExt + ", "), false, false);
-#pragma endregion
+	if (doConvert)
+	{
+		SConvertJob glossJob;
+		glossJob.sSource	= strFname;
+		glossJob.sOutputDir = info.sDirectory;
+		glossJob.bTiled		= job.bLowMemory;
+		glossJob.outputs	= outputs;
+		if (data.bIsMaskAlpha)
+		{
+			glossJob.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+
+		int failCount_prev = job.failCount;
+		if (!ConvertGlossMap(strFname, info.sDirectory + info.sName + GLOSS_KEY + "." + job.options.sFileType,
+							 job.options.sFileType, ctx.logFile, outputs))
+		{
+			ctx.converter.Convert(glossJob, ctx.logFile, job.failCount);
+		}
 
-#pragma region CALL_UNSPLIT			
-			// Skip if the converted file exists and is > 0 bytes
-			string converted = info.sDirectory + info.sName + "." + options.sFileType;
-			if (FileExists(converted))
+		if (job.failCount > failCount_prev && job.options.bUseNVDecompress)
+		{
+			DWORD exitcode;
+			MessageOut(ctx.logFile, (msg + "\n\t\t "), true, false);
+			if (RunNVDecompress(ctx.nvDecompressPath, strFname, exitcode))
 			{
-				int fsize = SizeOfFile(converted);
-				MessageOut(log_file_path, msg + "File exists (" + to_string(fsize) + " bytes)", true, false);
-				if (fsize >= 1 && !data.bIsNormal)
+				MessageOut(ctx.logFile, (msg + ", trying Nvidia convert (" + to_string(exitcode) + "):"), true, false);
+				if (exitcode == 0 && job.options.sFileType != "tga")
 				{
-					MessageOut(log_file_path, msg + "-> skipping...", true, false);
-					doUnsplit = false;
-					doConvert = false;
+					if (FIconvert(info.sDirectory + info.sName + GLOSS_KEY, job.options.sFileType, outputs))
+					{
+						MessageOut(ctx.logFile, (msg + " OK, FreeImage convert...OK. "), true, false);
+						job.failCount--;
+					}
+					else
+					{
+						MessageOut(ctx.logFile, (msg + " OK, FreeImage convert...FAILED. "), true, false);
+						job.failCount++;
+					}
 				}
-				else
+				else if (exitcode != 0)
 				{
-					MessageOut(log_file_path, msg + "-> overwriting...", true, false);
-					doUnsplit = true;
-					doConvert = true;
+					MessageOut(ctx.logFile, (msg + " FAILED. "), true, false);
+					job.failCount++;
 				}
 			}
 			else
 			{
-				int fsize = SizeOfFile(info.sDirectory + info.sNameAllExt);
-				int fsize2 = (data.bIsGloss ? SizeOfFile(info.sDirectory + info.sBaseName + ".2a") 
-											 : SizeOfFile(info.sDirectory + info.sBaseName + ".2"));
-
-				if (fsize > fsize2 && (FileExists(info.sDirectory + info.sGlossName)))
-				{
-					doUnsplit = false;
-				}
+				MessageOut(ctx.logFile, (msg + "NVidia convert...FAILED (" + to_string(exitcode) + ")"), true, false);
+				job.failCount++;
 			}
+		}
+	}
+	
+	// Merge files if required---------------
+	if (job.options.bMergeGloss)
+	{
+		MessageOut(ctx.logFile, (msg + "  Merging gloss data into normal map:"), false, false);
+		
+		if (!FileExists(converted))
+		{
+			MessageOut(ctx.logFile, (msg + "  FAILED: Converted normal file not found <<<<<<<<<<<<< "), false, false);
+			job.failCount++;
+			return;
+		}
+		
+		string converted_gloss = info.sDirectory + info.sName + GLOSS_KEY + "." + job.options.sFileType;
+		
+		if (MergeGlossWithNormal(converted, converted_gloss, ctx.logFile, &job.outputs))
+		{
+			MessageOut(ctx.logFile, (msg + "...OK. "), true, false);
+		}
+		else
+		{
+			MessageOut(ctx.logFile, (msg + "...FAILED <<<<<<<<<<<<<<<< "), true, false);
+			job.failCount++;
+		}
+	}
+}
 
-			if (doUnsplit)
-			{
-				MessageOut(log_file_path, msg + "Unsplit:", true, false);
+//--------------------------------------------------------------------------------------
+// Writer stage: the files the convert stage encoded. Failures count against the job
+// before it is finished, so the manifest and the batch results see them.
+//--------------------------------------------------------------------------------------
+void WriteTextureOutputs(SPipelineContext &ctx, STextureJob &job)
+{
+	CMessageCapture capture(job.messages);
+	string msg = "";
+	for (auto &file : job.outputs)
+	{
+		HRESULT hr = WriteEncodedFile(file);
+		if (FAILED(hr))
+		{
+			CLogSink::Instance().Write(LOG_ERROR, "write", file.sPath, hr, 0.0, "");
+			MessageOut(ctx.logFile, (msg + "\n\t\tFAILED writing " + file.sPath + " " + to_string(hr) + " <<<<<<<<<<<<<<<< "), false, true);
+			job.failCount++;
+		}
+	}
+	job.outputs.clear();
+}
 
-				// Call Unsplit -------------------------------------------------
-				if (Unsplit(info, options, data, log_file_path))
-				{
-					MessageOut(log_file_path, msg + "...OK.", true, false);
-				}
-				else
-				{
-					failCount++;
-					MessageOut(log_file_path, msg + " FAILED <<<<<<<<<<<<<<<<<<<<<", true, true);
-					continue;
-				}
-			}
-#pragma endregion			
+// Every job ends here, whichever stage it left from. Its messages go out here, as one record.
+void FinishTexture(SPipelineContext &ctx, STextureJob &job)
+{
+	WriteMessages(ctx.logFile, job.messages);
+
+	if (job.bRecord && job.failCount == 0 && job.info.pFragments)
+	{
+		ctx.manifest.Record(job.manifestKey, *job.info.pFragments, ctx.optionsHash, job.converted);
+		if (ctx.manifest.Unsaved() >= MANIFEST_SAVE_INTERVAL) { ctx.manifest.Save(); }
+	}
+
+	ctx.index.Release(job.pClaimed);
+	job.pClaimed = nullptr;
+	ctx.failCount += job.failCount;
+	CProgressDisplay::Instance().Finish(job.inputBytes, job.bRecord, job.failCount);
+
+	double seconds = IOSeconds(IOTimestamp() - job.startTicks);
+	CLogSink::Instance().Write((job.failCount ? LOG_ERROR : LOG_DEBUG), "texture", job.sHeaderPath, (job.failCount ? E_FAIL : S_OK),
+							   seconds, "");
+
+	if (ctx.pResults)
+	{
+		SBatchRecord record = { ctx.batchEntry, job.sHeaderPath, job.converted, job.bRecord, job.failCount, seconds };
+		ctx.pResults->Add(record);
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Runs the worker pools until the header queue is closed and drained, or the user exits.
+//--------------------------------------------------------------------------------------
+void RunPipeline(SPipelineContext &ctx, CBoundedQueue<string> &headers)
+{
+	unsigned cores = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+	unsigned prepareThreads = (ctx.options.nUnsplitThreads > 0 ? ctx.options.nUnsplitThreads : std::max<unsigned>(cores / 4, 1));
+	unsigned convertThreads = (ctx.options.nConvertThreads > 0 ? ctx.options.nConvertThreads : cores);
+	unsigned writeThreads = (ctx.options.nWriteThreads > 0 ? ctx.options.nWriteThreads : std::min<unsigned>(std::max<unsigned>(cores / 4, 1), 4));
+
+	// Small queue: a prepared job holds its fragment set claimed until it is converted.
+	CBoundedQueue<unique_ptr<STextureJob>> jobs(convertThreads * 2);
+	std::atomic<unsigned> preparing(prepareThreads);
 
-#pragma region CALL_CONVERTER
-			if (info.sExt2 == ".0")
+	// Encoded files are outside the memory budget, so only a few jobs may wait to be written.
+	CBoundedQueue<unique_ptr<STextureJob>> writes(writeThreads * 2);
+	std::atomic<unsigned> converting(convertThreads);
+
+	auto prepareWorker = [&]()
+	{
+		string path;
+		while (!ctx.cancelled && headers.Pop(path))
+		{
+			unique_ptr<STextureJob> job(new STextureJob());
+			job->sHeaderPath = path;
+			job->options = ctx.options;
+			job->startTicks = IOTimestamp();
+
+			if (!PrepareTexture(ctx, *job))
 			{
+				FinishTexture(ctx, *job);
 				continue;
 			}
 
-			bool specifyFormat = false;
-			string sReadFmt    = "";
-
-			//Build arg list for texture converter
-			int idxArgs = 0;
-			std::fill(std::begin(args), std::end(args), nullptr);
-						
-			ATL::CA2T lptZero("sctexconvert");	//Zero element for the options array
-			args[idxArgs] = lptZero;
-			idxArgs++;
-
-			//read format
-			/*if (info.sName.find("_mask") != string::npos || info.sName.find("_opa") != string::npos
-													   	 || info.sName.find("_trans") != string::npos)*/									
-			if (data.bIsNormal) {
-				MessageOut(log_file_path, msg + "(forced normal)", true, false);
-				sReadFmt = "B8G8R8A8_UNORM";  // B5G5R5A1_UNORM also works but will reduce quality		
-				specifyFormat = true;
-			}
-			else if (info.hasGloss) // This should cover all img types that are not normals but have a mask e.g. _opa, _mask, _trans.
+			// Push only fails once the run is cancelled; the job is left with us to release its claim.
+			if (!jobs.Push(std::move(job)))
 			{
-				MessageOut(log_file_path, msg + "(forced 4 channel)", true, false);
-				sReadFmt = "R8G8B8A8_UNORM";
-				specifyFormat = true;
+				FinishTexture(ctx, *job);
 			}
+		}
 
-			ATL::CA2T lptRead("-f");
-			ATL::CA2T lptReadFmt(sReadFmt.c_str());
+		// The last prepare worker out tells the converters that no more jobs are coming.
+		if (--preparing == 0) { jobs.Close(); }
+	};
 
-			// If file is not a normal map then let converter choose best read format.
-			if (specifyFormat)
+	auto convertWorker = [&]()
+	{
+		unique_ptr<STextureJob> job;
+		while (jobs.Pop(job))
+		{
+			if (!ctx.cancelled)
 			{
-				args[idxArgs] = lptRead;
-				idxArgs++;
-				args[idxArgs] = lptReadFmt;
-				idxArgs++;
+				PlanTextureMemory(ctx, *job);
+				CMemoryReservation reservation(ctx.memory, job->footprint);
+				ConvertTexture(ctx, *job);
 			}
 
-			// output directory flag
-			ATL::CA2T lptOflag("-o");
-			args[idxArgs] = lptOflag;
-			idxArgs++;
-			// output directory				
-			ATL::CA2T lptOdir(info.sDirectory.c_str());
-			args[idxArgs] = lptOdir;
-			idxArgs++;
-
-			// output file type flag
-			ATL::CA2T lptFType("-ft");
-			args[idxArgs] = lptFType;
-			idxArgs++;
-			// output file type				
-			ATL::CA2T lptType(options.sFileType.c_str());
-			args[idxArgs] = lptType;
-			idxArgs++;
-
-			//normal map
-			ATL::CA2T lpNFlag("-nmap");		//options must be one or more of { r, g, b, a, l, m, u, v, i, o } 
-			ATL::CA2T lpNopt("rgb");		// for .ddn & .ddna files: use rgb
-			ATL::CA2T lpNamp("-nmapamp");
-			ATL::CA2T lpNwt("10.0");        // weight for normal map amplitude
-											//TODO: Test normal reconstruction via OpenCV functions or nvtt
-			if (data.bIsNormal)
-			{
-				args[idxArgs] = lpNFlag;
-				idxArgs++;
+			// The writers only stop once every converter has, so this Push does not fail.
+			if (!job->outputs.empty() && writes.Push(std::move(job)))
+				continue;
 
-				args[idxArgs] = lpNopt;
-				idxArgs++;
+			WriteTextureOutputs(ctx, *job);
+			FinishTexture(ctx, *job);
+		}
 
-				args[idxArgs] = lpNamp;
-				idxArgs++;
+		// Queued writes are still completed after an exit request, they are finished work.
+		if (--converting == 0) { writes.Close(); }
+	};
 
-				args[idxArgs] = lpNwt;
-				idxArgs++;
-			}
+	auto writeWorker = [&]()
+	{
+		unique_ptr<STextureJob> job;
+		while (writes.Pop(job))
+		{
+			WriteTextureOutputs(ctx, *job);
+			FinishTexture(ctx, *job);
+		}
+	};
 
-			//Filename goes last in argument list
-			string strFname = info.sDirectory + info.sBaseName;
-			ATL::CA2T lpwName(strFname.c_str());
-			args[idxArgs] = lpwName;
-			idxArgs++;
+	vector<std::thread> workers;
+	for (unsigned t = 0; t < prepareThreads; t++) { workers.push_back(std::thread(prepareWorker)); }
+	for (unsigned t = 0; t < convertThreads; t++) { workers.push_back(std::thread(convertWorker)); }
+	for (unsigned t = 0; t < writeThreads; t++) { workers.push_back(std::thread(writeWorker)); }
 
-			// Call Texture converter--------------------------------------------------
-			if (doConvert)
-			{
-				int failCount_prev = failCount;
-				if (!(data.bIsGloss))
-				{
-					SCTexConvert(idxArgs, args, log_file_path, failCount);
-				}
+	// The main thread only watches for the user asking to exit.
+	while (!jobs.IsClosed() || jobs.Size() > 0)
+	{
+		CProgressDisplay::Instance().SetDiscovered(ctx.crawler.Discovered(), ctx.crawler.IsFinished());
+		if (!ctx.bHeadless && UserWantsToExit())
+		{
+			ctx.cancelled = true;
+			ctx.crawler.Cancel();
+			headers.Close();
+			jobs.Close();
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
 
-				if (data.bIsGloss || failCount > failCount_prev)
-				{				
-				// Use NVidia Texture Tool for gloss maps or if DirectX Tool failed
-					std::cout << "\n\t\t " << std::ends;
-					DWORD exitcode;
-					if (RunNVDecompress(nvDecompress_path, strFname, exitcode))
-					{
-						MessageOut(log_file_path, (msg + "NV exit code (" + to_string(exitcode) + ")"), true, false);
-						if (options.sFileType != "tga")
-						{
-							if (FIconvert(info.sDirectory + info.sName, options.sFileType))
-							{
-								MessageOut(log_file_path, (msg + " FreeImage convert...OK. "), true, false);
-							}
-							else
-							{
-								MessageOut(log_file_path, (msg + " FreeImage convert...FAILED. "), true, false);
-								failCount = (failCount == failCount_prev ? failCount + 1 : failCount + 0);
-							}
-						}
-					}
-					else
-					{
-						MessageOut(log_file_path, (msg + " NVidia convert...FAILED (" + to_string(exitcode) + ")"), true, false);
-						failCount++;
-					}
-				}
-			}
+	for (auto &w : workers) { w.join(); }
+}
+#pragma endregion
 
-			// Process gloss map if required-------------------------------------------
-			if (!info.hasGloss)
-				continue;			
-			
-			if (FileExists(info.sDirectory + info.sName + GLOSS_KEY + "." + options.sFileType))
-			{
-				doConvert = false;
-				if (!options.bMergeGloss)
-				{
-					continue;
-				}
-			}
+#pragma region BATCH
+////////////////////////////////////////////////////////////////////////////////////////
+//
+//   HEADLESS BATCH MODE
+//
+//   sctexconv.exe -batch <job manifest> [-result <file>] [-threads <n>]
+//
+//   Runs every manifest entry through the pipeline in turn, with config.txt options
+//   overridden per entry. Never waits for the keyboard; the outcome is the exit code
+//   (BATCH_EXIT) and a JSON result file, <manifest>_result.json unless given.
+//
+////////////////////////////////////////////////////////////////////////////////////////
 
-			SUnsplitFileNameInfo ginfo = SUnsplitFileNameInfo();
-			InitializeGlossInfo(info, ginfo, "");
-			
-			SUFileData gdata = SUFileData();
-			GetFileData(ginfo, gdata, log_file_path);
+// Defaults for anything config.txt leaves out.
+void InitOptions(SUnsplitOptions &options)
+{
+	options.nUnsplitThreads = 0;
+	options.nConvertThreads = 0;
+	options.nWriteThreads = 0;
+	options.bUseNVDecompress = false;
+	options.nLogLevel = LOG_INFO;
+	options.nTiming = TIMING_OFF;
+	options.bTiled = false;
+	options.nMemoryBudgetMB = 0;
+	options.nBCQuality = TEX_COMPRESS_BC_NORMAL;
+	options.pixelFormat = DXGI_FORMAT_UNKNOWN;
+}
 
-			strFname = info.sDirectory + info.sGlossName;
-			ATL::CA2T lpwGName(strFname.c_str());
+// Every option that changes what a texture is converted to; a different hash makes the
+// manifest convert it again.
+unsigned long long OptionsHash(const SUnsplitOptions &options)
+{
+	unsigned long long optionsHash = HashBytes(sVERSION.data(), sVERSION.size());
+	optionsHash = HashBytes(options.sFileType.data(), options.sFileType.size(), optionsHash);
+	optionsHash = HashBytes(options.bMergeGloss ? "merge" : "nomerge", options.bMergeGloss ? 5 : 7, optionsHash);
+	if (options.pixelFormat != DXGI_FORMAT_UNKNOWN)
+	{
+		optionsHash = HashBytes(&options.pixelFormat, sizeof(options.pixelFormat), optionsHash);
+	}
+	optionsHash = HashBytes(&options.nBCQuality, sizeof(options.nBCQuality), optionsHash);
+
+	// Strip mode (-tiled, or a texture over the memory budget) and the nvdecompress fallback
+	// take other code paths to the output.
+	optionsHash = HashBytes(options.bTiled ? "tiled" : "whole", 5, optionsHash);
+	optionsHash = HashBytes(&options.nMemoryBudgetMB, sizeof(options.nMemoryBudgetMB), optionsHash);
+	optionsHash = HashBytes(options.bUseNVDecompress ? "nvdecompress" : "nonv", options.bUseNVDecompress ? 12 : 4, optionsHash);
+	return optionsHash;
+}
 
-			if (doConvert)
-			{
-				// Reset and re-build args list for converter
-				idxArgs = 0;
-				std::fill(std::begin(args), std::end(args), nullptr);
-				//Pointers already created previously
-				args[idxArgs] = lptZero;
-				idxArgs++;
-
-				//read format 
-				sReadFmt;
-				specifyFormat = false;
-
-				if (data.bIsMaskAlpha)
-				{
-					sReadFmt = "R8G8B8A8_UNORM";
-					specifyFormat = true;
-				}
-				
-				ATL::CA2T lptReadFmt(sReadFmt.c_str());
+// Applies one manifest entry's overrides. Returns false with 'error' set if one is not valid.
+bool ApplyBatchEntry(const SBatchEntry &entry, SUnsplitOptions &options, string &error)
+{
+	if (!entry.sFileType.empty())
+	{
+		options.sFileType = entry.sFileType;
+	}
+	if (entry.nMergeGloss >= 0)
+	{
+		options.bMergeGloss = (entry.nMergeGloss != 0);
+	}
+	if (!entry.sPixelFormat.empty())
+	{
+		ATL::CA2W lpFormat(entry.sPixelFormat.c_str());
+		options.pixelFormat = static_cast<DXGI_FORMAT>(LookupByName(lpFormat, g_pFormats));
+		if (options.pixelFormat == DXGI_FORMAT_UNKNOWN)
+		{
+			error = "pixel_format " + entry.sPixelFormat + " not recognized";
+			return false;
+		}
+	}
+	return true;
+}
 
-				// If file is not a normal map then let converter choose best read format.
-				if (specifyFormat)
-				{
-					args[idxArgs] = lptRead;
-					idxArgs++;
-					args[idxArgs] = lptReadFmt;
-					idxArgs++;
-				}
+int RunBatch(const string &installdir, int argc, wchar_t* argv[])
+{
+	string msg = "";
+	string manifestPath = "";
+	string resultPath = "";
+	int threads = -1;
 
-				// output directory
-				args[idxArgs] = lptOflag;
-				idxArgs++;		
-				args[idxArgs] = lptOdir;
-				idxArgs++;
+	for (int iArg = 2; iArg < argc; iArg++)
+	{
+		ATL::CW2A lpArg(argv[iArg]);
+		string arg = lpArg;
+		bool bHasValue = (iArg + 1 < argc);
+		if (arg == "-result" && bHasValue)
+		{
+			ATL::CW2A lpValue(argv[++iArg]);
+			resultPath = lpValue;
+		}
+		else if (arg == "-threads" && bHasValue)
+		{
+			threads = _wtoi(argv[++iArg]);
+		}
+		else if (manifestPath.empty() && !arg.empty() && arg[0] != '-')
+		{
+			manifestPath = arg;
+		}
+		else
+		{
+			std::cout << " ERROR: '" << arg << "' not recognized." << std::endl;
+			manifestPath.clear();
+			break;
+		}
+	}
+	if (manifestPath.empty() || threads == 0 || threads < -1)
+	{
+		std::cout << " Usage: sctexconv -batch <job manifest> [-result <file>] [-threads <n>]" << std::endl;
+		return BATCH_EXIT_USAGE;
+	}
+	if (resultPath.empty())
+	{
+		// Only an extension of the file name itself is replaced, not a dot in a directory name.
+		size_t slash = manifestPath.find_last_of("\\/");
+		size_t dot = manifestPath.rfind('.');
+		bool bExtension = (dot != string::npos && (slash == string::npos || dot > slash));
+		resultPath = (bExtension ? manifestPath.substr(0, dot) : manifestPath) + "_result.json";
+	}
 
-				// output file type
-				args[idxArgs] = lptFType;
-				idxArgs++;
-				args[idxArgs] = lptType;
-				idxArgs++;
+	vector<SBatchEntry> entries;
+	string error;
+	if (!LoadBatchManifest(manifestPath, entries, error))
+	{
+		std::cout << " ERROR: " << error << std::endl;
+		return BATCH_EXIT_USAGE;
+	}
 
-				// filename
-				args[idxArgs] = lpwGName;
-				idxArgs++;
+	SUnsplitOptions options;
+	InitOptions(options);
+	PrintLogo();
+	std::cout << " Loading config..." << std::endl;
+	if (!LoadConfigFile(installdir + "\\" + "config.txt", options))
+	{
+		return BATCH_EXIT_CONFIG;
+	}
+	if (threads > 0)
+	{
+		options.nConvertThreads = threads;
+	}
 
-				int failCount_prev = failCount;
-				SCTexConvert(idxArgs, args, log_file_path, failCount);
+	time_t start;
+	time(&start);
+	long long startTicks = IOTimestamp();
+	string log_file_path = installdir + "\\" + "sctextureconverter_log_" + to_string((long long)start) + ".txt";
 
-				if (failCount > failCount_prev)
-				{
-					DWORD exitcode;
-					std::wcout << "\n\t\t " << std::ends;
-					if (RunNVDecompress(nvDecompress_path, strFname, exitcode))
-					{
-						MessageOut(log_file_path, (msg + ", trying Nvidia convert (" + to_string(exitcode) + "):"), true, false);
-						if (exitcode == 0 && options.sFileType != "tga")
-						{
-							if (FIconvert(info.sDirectory + info.sName + GLOSS_KEY, options.sFileType))
-							{
-								MessageOut(log_file_path, (msg + " OK, FreeImage convert...OK. "), true, false);
-								failCount--;
-							}
-							else
-							{
-								MessageOut(log_file_path, (msg + " OK, FreeImage convert...FAILED. "), true, false);
-								failCount++;
-							}
-						}
-						else if (exitcode != 0)
-						{
-							MessageOut(log_file_path, (msg + " FAILED. "), true, false);
-							failCount++;
-						}
-					}
-					else
-					{
-						MessageOut(log_file_path, (msg + "NVidia convert...FAILED (" + to_string(exitcode) + ")"), true, false);
-						failCount++;
-					}
-				}
-			}
-			
-			// Merge files if required---------------
-			if (options.bMergeGloss)
-			{
-				MessageOut(log_file_path, (msg + "  Merging gloss data into normal map:"), false, false);
-				
-				if (!FileExists(converted))
-				{
-					MessageOut(log_file_path, (msg + "  FAILED: Converted normal file not found <<<<<<<<<<<<< "), false, false);
-					break;
-				}
-				
-				string converted_gloss = info.sDirectory + info.sName + GLOSS_KEY + "." + options.sFileType;
-				
-				if (MergeGlossWithNormal(converted, converted_gloss, log_file_path))
-				{
-					MessageOut(log_file_path, (msg + "...OK. "), true, false);
-				}
-				else
-				{
-					MessageOut(log_file_path, (msg + "...FAILED <<<<<<<<<<<<<<<< "), true, false);
-					failCount++;
-				}
-			}
+	PrintLogo(log_file_path);
+	LogOptions(log_file_path, options);
+	CLogSink::Instance().Open(log_file_path, (LOG_LEVEL)options.nLogLevel);
+	LogMessage(log_file_path, msg + "\n Batch: " + manifestPath + ", " + to_string(entries.size()) + " entries", false);
+
+	CConversionManifest manifest;
+	string manifest_path = installdir + "\\" + MANIFEST_FILE;
+	manifest.Load(manifest_path);
+
+	CStageTimings::Instance().Enable((TIMING_MODE)options.nTiming);
+	CBatchResults results;
+	int failCount = 0;
+
+	for (size_t e = 0; e < entries.size(); e++)
+	{
+		const SBatchEntry &entry = entries[e];
+		MessageOut(log_file_path, ("\n Entry " + to_string(e + 1) + " of " + to_string(entries.size()) + ": " + entry.sPath), false, true);
+
+		SUnsplitOptions entryOptions = options;
+		string directory, pattern;
+		if (!ApplyBatchEntry(entry, entryOptions, error))
+		{
+			results.AddEntryError(e, error);
+			MessageOut(log_file_path, (msg + "\n ERROR: line " + to_string(entry.nLine) + ": " + error), false, true);
+			continue;
+		}
+		if (!SplitBatchTarget(entry.sPath, directory, pattern))
+		{
+			results.AddEntryError(e, "not found");
+			MessageOut(log_file_path, (msg + "\n ERROR: line " + to_string(entry.nLine) + ": " + entry.sPath + " not found"), false, true);
+			continue;
+		}
+
+		// Directories follow config.txt, files and patterns only look in their own directory.
+		bool bRecursive = (entry.nRecursive >= 0 ? entry.nRecursive != 0 : (pattern.empty() && entryOptions.bRecursive));
+		entryOptions.bRecursive = bRecursive;
+
+		CFileIndex fileIndex;
+		CBoundedQueue<string> headerQueue(CRAWL_QUEUE_DEPTH);
+		CFileCrawler crawler(fileIndex, headerQueue, bRecursive);
+		crawler.SetFilter(pattern);
+		crawler.Start(directory);
+
+		SPipelineContext ctx(fileIndex, crawler, manifest);
+		ctx.options			 = entryOptions;
+		ctx.logFile			 = log_file_path;
+		ctx.nvDecompressPath = installdir + "\\nvdecompress.exe";
+		ctx.optionsHash		 = OptionsHash(entryOptions);
+		ctx.start			 = start;
+		ctx.bHeadless		 = true;
+		ctx.pResults		 = &results;
+		ctx.batchEntry		 = e;
+		if (!ctx.converter.SetFileType(entryOptions.sFileType))
+		{
+			crawler.Cancel();
+			results.AddEntryError(e, "format " + entryOptions.sFileType + " not supported");
+			MessageOut(log_file_path, (msg + "\n ERROR: line " + to_string(entry.nLine) + ": format " + entryOptions.sFileType + " not supported"), false, true);
+			continue;
+		}
+		ctx.converter.SetTiled(entryOptions.bTiled);
+		ctx.converter.SetBCQuality(entryOptions.nBCQuality);
+		SetMemoryBudget(ctx.memory, entryOptions.nMemoryBudgetMB > 0 ? (unsigned long long)entryOptions.nMemoryBudgetMB << 20 : DefaultMemoryBudget());
+		RunPipeline(ctx, headerQueue);
+
+		crawler.Cancel();
+		crawler.Wait();
+		vector<string> crawlErrors;
+		crawler.TakeErrors(crawlErrors);
+		for (auto &err : crawlErrors)
+		{
+			results.AddEntryError(e, err);
+			MessageOut(log_file_path, err, false, true);
+		}
+		if (ctx.started == 0)
+		{
+			results.AddEntryError(e, "no DDS headers found");
+			MessageOut(log_file_path, (msg + "\n ERROR: line " + to_string(entry.nLine) + ": no DDS headers found in " + entry.sPath), false, true);
 		}
+		failCount += ctx.failCount;
+	}
+
+	if (!manifest.Save())
+	{
+		MessageOut(log_file_path, msg + "\n ERROR: could not write manifest " + manifest_path, false, true);
+	}
+	if (CStageTimings::Instance().IsEnabled())
+	{
+		CStageTimings::Instance().Write(log_file_path.substr(0, log_file_path.rfind('.')));
+	}
+
+	int exitCode = BATCH_EXIT_OK;
+	if (results.Textures() == 0)
+		exitCode = BATCH_EXIT_NO_FILES;
+	else if (results.Failed() > 0 || failCount > 0)
+		exitCode = BATCH_EXIT_FAILED;
+
+	if (!results.Write(resultPath, entries, exitCode, IOSeconds(IOTimestamp() - startTicks)))
+	{
+		MessageOut(log_file_path, msg + "\n ERROR: could not write result file " + resultPath, false, true);
+		exitCode = (exitCode == BATCH_EXIT_OK ? BATCH_EXIT_RESULT : exitCode);
+	}
+
+	MessageOut(log_file_path, ("\n Batch finished: " + to_string(results.Textures()) + " textures, " + to_string(results.Failed())
+							  + " failed. Exit code " + to_string(exitCode) + ", results in " + resultPath), false, true);
+	CLogSink::Instance().Close();
+	return exitCode;
+}
+#pragma endregion
+
+//######################################################################################
+//--------------------------------------------------------------------------------------
+// NEW Entry-point for SCTEXCONV
+//--------------------------------------------------------------------------------------
+//######################################################################################
+#pragma comment(lib, "User32.lib")
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+#pragma region INITIALIZE
+	// Parameters and defaults
+	int result			= 0;
+	int failCount		= 0;
+	char tmpbuf[128]	= { 0 };
+	PWSTR  pWdir		= 0;
+	string msg			= "";
+	string sError		= "";
+	string installdir	= "";	
+	string targetdir	= "";
+
+	// Get the path of the executable
+	WCHAR path[MAX_PATH] = { 0 };
+	GetModuleFileName(NULL, path, MAX_PATH);
+	PathRemoveFileSpec(path);
+	ATL::CW2A szPath(path);
+	installdir = szPath;
+
+	// Parse command-line
+	if (argc >= 2 && _wcsicmp(argv[1], L"-batch") == 0)
+	{
+		return RunBatch(installdir, argc, argv);
+	}
+	if (argc >= 2 && _wcsicmp(argv[1], L"-bcbench") == 0)
+	{
+		return RunBCBench(argc, argv);
+	}
+	if (argc == 2)
+	{
+		pWdir = argv[1];
+		ATL::CW2A lpWdir(pWdir);
+		targetdir = lpWdir;
+
+		if (DirectoryExists(pWdir))
+		{
+			std::cout << " Target directory found..." << std::endl;
+		}
+		else
+		{
+			std::cout << " Could not access or locate the directory " << targetdir << std::endl;
+			std::cout << " Press ENTER key to close..." << std::ends;
+			std::getchar();
+			return 0;
+		}
+	}
+	else
+	{
+		targetdir = installdir;
+	}
+
+	// Load and parse config.txt file
+	SUnsplitOptions options;
+	InitOptions(options);
+	PrintLogo();
+	std::cout << " Loading config..." << std::endl;
+	string config_path = installdir + "\\" + "config.txt";
+
+	if (!LoadConfigFile(config_path, options))
+	{		
+		std::cout << " Press ENTER key to close..." << std::ends;
+		std::getchar();
+		return 0;
+	}
+
+	// Display O/S date and time.   
+	_tzset();
+	_strdate_s(tmpbuf, 128);
+	string startDate(tmpbuf);
+	printf(" Conversion started:  %s, ", tmpbuf);
+	_strtime_s(tmpbuf, 128);
+	string startTime(tmpbuf);
+	printf("%s\n", tmpbuf);
+	time_t start;
+	time(&start);
+
+	// Log file filename time-stamp is UNIX-style (i.e. number of seconds since 1st Jan 1970)	
+	long long llstart(start);
+	string log_file = "sctextureconverter_log_" + to_string(llstart) + ".txt";
+	string log_file_path = installdir + "\\" + log_file;
+	string nvDecompress_path = installdir + "\\nvdecompress.exe";
+	
+	PrintLogo(log_file_path);
+	LogOptions(log_file_path, options);
+	if (!CLogSink::Instance().Open(log_file_path, (LOG_LEVEL)options.nLogLevel))
+	{
+		std::cout << " WARNING: log file could not be kept open, logging unbuffered." << std::endl;
+	}
+	LogMessage(log_file_path, (" Conversion started: " + startDate + ", " + startTime), false);
+	LogMessage(log_file_path, msg + "\n Directory: " + targetdir, false);
+
+	//
+	// -- Start the directory crawl. Header files are converted as they are found. -------
+	std::cout << "\n Searching for DDS header files in " << targetdir << std::endl;
+	
+	CFileIndex fileIndex;
+	CBoundedQueue<string> headerQueue(CRAWL_QUEUE_DEPTH);
+	CFileCrawler crawler(fileIndex, headerQueue, options.bRecursive);
+	crawler.Start(targetdir);
+
+	LogMessage(log_file_path, msg + "\n Find errors in this log quickly by searching for 'FAILED' and 'ERROR'.", false);
+	vector<string> crawlErrors;
+
+	// Incremental manifest: anything converted before with the same inputs and options is skipped.
+	CConversionManifest manifest;
+	string manifest_path = installdir + "\\" + MANIFEST_FILE;
+	if (manifest.Load(manifest_path))
+	{
+		LogMessage(log_file_path, msg + "\n Manifest: " + to_string(manifest.Size()) + " textures recorded in " + manifest_path, false);
+	}
+	unsigned long long optionsHash = OptionsHash(options);
 #pragma endregion	
-		
-		if (UserWantsToExit()) { break; }		
+
+	// Prepare and convert workers take headers from the crawler as they are found.
+	SPipelineContext ctx(fileIndex, crawler, manifest);
+	ctx.options			 = options;
+	ctx.logFile			 = log_file_path;
+	ctx.nvDecompressPath = nvDecompress_path;
+	ctx.optionsHash		 = optionsHash;
+	ctx.start			 = start;
+	if (!ctx.converter.SetFileType(options.sFileType))
+	{
+		MessageOut(log_file_path, msg + "\n ERROR: save format " + options.sFileType + " not supported by the converter. EXITING...", false, true);
+		CLogSink::Instance().Close();
+		std::cout << "\n Press ENTER key to close..." << std::ends;
+		std::getchar();
+		return 1;
+	}
+	ctx.converter.SetTiled(options.bTiled);
+	ctx.converter.SetBCQuality(options.nBCQuality);
+	SetMemoryBudget(ctx.memory, options.nMemoryBudgetMB > 0 ? (unsigned long long)options.nMemoryBudgetMB << 20 : DefaultMemoryBudget());
+	CStageTimings::Instance().Enable((TIMING_MODE)options.nTiming);
+	CProgressDisplay::Instance().Start(options.bVerbose);
+	RunPipeline(ctx, headerQueue);
+	CProgressDisplay::Instance().Stop();
+
+	int index		  = ctx.started;
+	int manifestSkips = ctx.manifestSkips;
+	int lowMemoryJobs = ctx.lowMemoryJobs;
+	failCount		 += ctx.failCount;
+
+	// Stop the crawl if the loop ended early, then collect anything it still had to report.
+	crawler.Cancel();
+	crawler.Wait();
+	crawler.TakeErrors(crawlErrors);
+	for (auto &err : crawlErrors) { MessageOut(log_file_path, err, false, true); failCount++; }
+
+	if (!manifest.Save())
+	{
+		MessageOut(log_file_path, msg + "\n ERROR: could not write manifest " + manifest_path, false, true);
+	}
+
+	if (index == 0)
+	{
+		MessageOut(log_file_path, (msg + "\n FILE SEARCH ERROR: No valid files found. EXITING..."), false, true);
+		CLogSink::Instance().Close();
+		std::cout << "\n Press ENTER key to close..." << std::ends;
+		std::getchar();
+		return 1;
 	}
 	
 #pragma region END_REPORT	
@@ -3463,7 +4924,52 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 	time_t diff = end - start;
 	string grmrNzi2 = ((diff / 60) == 1 ? " minute, " : " minutes, ");
 	string grmrNzi3 = ((diff % 60) == 1 ? " second."  : " seconds.");
-	MessageOut(log_file_path, ("\n " + to_string(count) + " Files processed in: " + to_string(diff / 60) + grmrNzi2 + to_string(diff % 60) + grmrNzi3), false, true) ;
+	MessageOut(log_file_path, ("\n " + to_string(crawler.Discovered()) + " valid file headers found (" + to_string(fileIndex.FileCount()) + " files in "
+							  + to_string(fileIndex.DirectoryCount()) + " directories indexed)."), false, true);
+	MessageOut(log_file_path, ("\n " + to_string(manifestSkips) + " unchanged textures skipped via the manifest."), false, true);
+	MessageOut(log_file_path, ("\n " + to_string(index) + " Files processed in: " + to_string(diff / 60) + grmrNzi2 + to_string(diff % 60) + grmrNzi3), false, true) ;
+
+	SIOStats ioStats = GetIOStats();
+	MessageOut(log_file_path, ("\n Unsplit I/O: read " + FormatThroughput(ioStats.bytesRead, ioStats.seconds)
+							  + ", wrote " + FormatThroughput(ioStats.bytesWritten, ioStats.seconds)), false, true);
+
+	MessageOut(log_file_path, ("\n Memory budget: " + to_string(ctx.memory.Limit() >> 20) + " MB, peak " + to_string(ctx.memory.Peak() >> 20)
+							  + " MB reserved, " + to_string(ctx.memory.Waits()) + " textures waited for memory, " + to_string(lowMemoryJobs)
+							  + " converted in strip mode."), false, true);
+
+	SWriteStats writeStats = GetWriteStats();
+	MessageOut(log_file_path, ("\n Output writer: " + to_string(writeStats.files) + " files, " + FormatThroughput(writeStats.bytes, writeStats.seconds)
+							  + ", " + to_string(writeStats.failures) + " failed."), false, true);
+
+	DirectX::ImagePoolStats poolStats;
+	DirectX::GetImagePoolStats(poolStats);
+	size_t poolRequests = poolStats.hits + poolStats.misses;
+	MessageOut(log_file_path, ("\n Image pool: " + to_string(poolStats.hits) + " of " + to_string(poolRequests) + " buffers reused ("
+							  + to_string(poolRequests ? (100 * poolStats.hits) / poolRequests : 0) + "%), peak "
+							  + to_string(poolStats.peakBytesInUse >> 20) + " MB in use, " + to_string(poolStats.peakBytesCached >> 20) + " MB cached."), false, true);
+
+	DirectX::BCBlockStats blockStats;
+	DirectX::GetBCBlockStats(blockStats);
+	MessageOut(log_file_path, ("\n BC blocks: " + to_string(blockStats.blocks) + " compressed, " + to_string(blockStats.cachedBlocks) + " repeats copied ("
+							  + to_string(blockStats.blocks ? (100 * blockStats.cachedBlocks) / blockStats.blocks : 0) + "% hit rate), "
+							  + to_string(blockStats.solidBlocks) + " solid."), false, true);
+
+	if (CStageTimings::Instance().IsEnabled())
+	{
+		SStageTotals stageTotals[STAGE_COUNT];
+		vector<string> lines;
+		CStageTimings::Instance().Totals(stageTotals);
+		FormatStageTotals(stageTotals, lines);
+		LogMessage(log_file_path, msg + "\n Stage timing (all convert threads):", false);
+		for (auto &line : lines) { LogMessage(log_file_path, ("\n   " + line), false); }
+
+		string timing_base = log_file_path.substr(0, log_file_path.rfind('.'));
+		if (!CStageTimings::Instance().Write(timing_base))
+		{
+			MessageOut(log_file_path, msg + "\n ERROR: could not write stage timing files " + timing_base + "_timing.*", false, true);
+		}
+	}
+	CLogSink::Instance().Close();
 	std::cout << "\nLog file created: " << log_file << std::endl;
 #pragma endregion
 